@@ -0,0 +1,175 @@
+/*
+ * AudioConvert.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Streaming converter from any supported WAV layout to the native output format.
+ *
+ * Every clip is converted on the fly to AUDIO_NATIVE_BITS / AUDIO_NATIVE_CHANNELS at
+ * AUDIO_NATIVE_SAMPLE_RATE, so the I2S clock is programmed once and clips of different formats can be
+ * concatenated in the same stream. 8/24/32-bit samples are normalised to 16 bits, stereo is downmixed
+ * to mono by averaging, and the rate is changed with a linear interpolation resampler whose state
+ * (phase and last two samples) is carried from one block to the next. When the clip rate is 1.5 times
+ * the native rate or more, the input first goes through a moving average as long as the rounded rate
+ * ratio. Its first null sits near the native rate, so the band that would fold onto low frequencies
+ * is removed; a cheap anti-alias stage for speech prompts and locator tones, not a hi-fi resampler.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "AudioConvert.h"
+#include "esp_attr.h"
+#include <string.h>
+
+
+
+/* Bir giris frame'ini 16-bit mono ornege cevirir */
+static inline int16_t decode_frame(const uint8_t *p, uint16_t bits, uint16_t channels)
+{
+    int32_t l, r;
+    switch (bits) {
+        case 8:
+            l = ((int32_t)p[0] - 128) << 8;
+            r = (channels == 2) ? ((int32_t)p[1] - 128) << 8 : l;
+            break;
+        case 16:
+            l = (int16_t)((uint16_t)p[0] | (uint16_t)p[1] << 8);
+            r = (channels == 2) ? (int16_t)((uint16_t)p[2] | (uint16_t)p[3] << 8) : l;
+            break;
+        case 24:  // Ust 16 bit
+            l = (int16_t)((uint16_t)p[1] | (uint16_t)p[2] << 8);
+            r = (channels == 2) ? (int16_t)((uint16_t)p[4] | (uint16_t)p[5] << 8) : l;
+            break;
+        default:  // 32
+            l = (int16_t)((uint16_t)p[2] | (uint16_t)p[3] << 8);
+            r = (channels == 2) ? (int16_t)((uint16_t)p[6] | (uint16_t)p[7] << 8) : l;
+            break;
+    }
+    return (int16_t)((l + r) >> 1);
+}
+
+
+
+/* Asagi ornekleme oncesi kayan ortalama: toplam halkayla guncellenir, bolme Q15 carpimla yapilir */
+static inline int16_t box_filter(AudioConvert_t *cv, int16_t x)
+{
+    cv->box_sum += x - cv->box_hist[cv->box_pos];
+    cv->box_hist[cv->box_pos] = x;
+    if (++cv->box_pos == cv->box_len) cv->box_pos = 0;
+    return (int16_t)((cv->box_sum * (int32_t)cv->box_recip_q15) >> 15);
+}
+
+
+
+/**
+ * @brief Prepares a converter for a clip of the given format.
+ *
+ * @param[out] cv          Converter state to initialise.
+ * @param[in]  in_rate     Sample rate of the clip.
+ * @param[in]  in_bits     Sample width of the clip (8, 16, 24 or 32).
+ * @param[in]  in_channels Channel count of the clip (1 or 2).
+ * @return true if the format can be converted, false otherwise.
+ */
+bool AudioConvert_Init(AudioConvert_t *cv, uint32_t in_rate, uint16_t in_bits, uint16_t in_channels)
+{
+    memset(cv, 0, sizeof(*cv));
+    if (in_rate == 0 || (in_channels != 1 && in_channels != 2)) return false;
+    if (in_bits != 8 && in_bits != 16 && in_bits != 24 && in_bits != 32) return false;
+
+    cv->in_rate = in_rate;
+    cv->in_bits = in_bits;
+    cv->in_channels = in_channels;
+    cv->in_frame_bytes = (uint16_t)((in_bits / 8) * in_channels);
+    cv->step_q16 = (uint32_t)(((uint64_t)in_rate * AUDIO_CONVERT_Q16_ONE) / AUDIO_NATIVE_SAMPLE_RATE);
+    cv->passthrough = (in_rate == AUDIO_NATIVE_SAMPLE_RATE && in_bits == AUDIO_NATIVE_BITS &&
+                       in_channels == AUDIO_NATIVE_CHANNELS);
+
+    // Yuvarlanmis oran en az 2 ise kutu suzgeci: 44.1/48 kHz -> 16 kHz icin 3 ornek
+    uint32_t ratio = (in_rate + AUDIO_NATIVE_SAMPLE_RATE / 2) / AUDIO_NATIVE_SAMPLE_RATE;
+    if (ratio > AUDIO_CONVERT_BOX_MAX) ratio = AUDIO_CONVERT_BOX_MAX;
+    if (ratio >= 2) {
+        cv->box_len = (uint8_t)ratio;
+        cv->box_recip_q15 = (uint16_t)(32768u / ratio);
+    }
+    return true;
+}
+
+
+
+/**
+ * @brief Returns how many input bytes can be converted without overflowing an output buffer.
+ *
+ * The result is a whole number of input frames. Because of the resampler phase, feeding this many
+ * bytes to AudioConvert_Process() never produces more than out_bytes of output.
+ *
+ * @param[in] cv        Initialised converter.
+ * @param[in] out_bytes Capacity of the output buffer.
+ * @return Input size in bytes, frame aligned.
+ */
+size_t AudioConvert_InputBytesFor(const AudioConvert_t *cv, size_t out_bytes)
+{
+    size_t out_samples = out_bytes / AUDIO_NATIVE_FRAME_BYTES;
+    if (cv->passthrough) return out_samples * AUDIO_NATIVE_FRAME_BYTES;
+    if (out_samples < 2) return 0;
+
+    // N giris frame'i en fazla N*ONE/step + 1 cikis uretir
+    size_t in_frames = (size_t)(((uint64_t)(out_samples - 1) * cv->step_q16) / AUDIO_CONVERT_Q16_ONE);
+    return in_frames * cv->in_frame_bytes;
+}
+
+
+
+/**
+ * @brief Converts a chunk of input frames to native PCM.
+ *
+ * All whole frames of the input are consumed; the resampler state is kept for the next call so the
+ * output is continuous across blocks. The input size must come from AudioConvert_InputBytesFor().
+ *
+ * @param[in,out] cv       Converter state.
+ * @param[in]     in       Input PCM in the clip format.
+ * @param[in]     in_bytes Number of input bytes.
+ * @param[out]    out      Native 16-bit mono output.
+ * @return Number of output bytes written.
+ */
+size_t IRAM_ATTR AudioConvert_Process(AudioConvert_t *cv, const uint8_t *in, size_t in_bytes, int16_t *out)
+{
+    if (cv->passthrough) {
+        memcpy(out, in, in_bytes);
+        return in_bytes;
+    }
+
+    const uint16_t bits = cv->in_bits;
+    const uint16_t channels = cv->in_channels;
+    const size_t frames = in_bytes / cv->in_frame_bytes;
+    const uint32_t step = cv->step_q16;
+    uint32_t phase = cv->phase_q16;
+    int32_t prev = cv->prev, cur = cv->cur;
+    size_t n = 0;
+
+    for (size_t i = 0; i < frames; i++) {
+        int16_t x = decode_frame(&in[i * cv->in_frame_bytes], bits, channels);
+        if (cv->box_len) x = box_filter(cv, x);
+        if (!cv->primed) {
+            prev = cur = x;
+            cv->primed = true;
+        } else {
+            prev = cur;
+            cur = x;
+        }
+        // prev..cur araligina dusen tum cikis orneklerini uret
+        while (phase < AUDIO_CONVERT_Q16_ONE) {
+            out[n++] = (int16_t)(prev + (((cur - prev) * (int32_t)(phase >> 1)) >> 15));
+            phase += step;
+        }
+        phase -= AUDIO_CONVERT_Q16_ONE;
+    }
+
+    cv->phase_q16 = phase;
+    cv->prev = (int16_t)prev;
+    cv->cur = (int16_t)cur;
+    return n * AUDIO_NATIVE_FRAME_BYTES;
+}
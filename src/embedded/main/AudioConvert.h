@@ -0,0 +1,52 @@
+/*
+ * AudioConvert.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_AUDIOCONVERT_H_
+#define MAIN_AUDIOCONVERT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Cihazin tek cikis bicimi: I2S saati bu degerde sabit kalir. Konusma icin 16 kHz (8 kHz bant) yeterli,
+// klipler 44.1 kHz'e gore ~2.8 kat kucuk; 32 KB'lik onbellek siniri ~1 s PCM ya da ~4 s ADPCM klip alir
+#ifndef AUDIO_NATIVE_SAMPLE_RATE
+#define AUDIO_NATIVE_SAMPLE_RATE    16000
+#endif
+
+#define AUDIO_NATIVE_BITS           16
+#define AUDIO_NATIVE_CHANNELS       1
+#define AUDIO_NATIVE_FRAME_BYTES    ((AUDIO_NATIVE_BITS / 8) * AUDIO_NATIVE_CHANNELS)
+
+#define AUDIO_CONVERT_Q16_ONE       65536u
+
+// Asagi ornekleme oncesi kutu suzgecinin en fazla uzunlugu (giris ornegi)
+#define AUDIO_CONVERT_BOX_MAX       8
+
+typedef struct {
+    uint32_t in_rate;
+    uint16_t in_bits;
+    uint16_t in_channels;
+    uint16_t in_frame_bytes;
+    uint32_t step_q16;      // Cikis ornegi basina ilerlenen giris ornegi (Q16.16)
+    uint32_t phase_q16;     // prev ile cur arasindaki kesirli konum (Q16.16)
+    int16_t  prev;          // Bloklar arasi enterpolasyon icin son iki giris ornegi
+    int16_t  cur;
+    bool     primed;        // Ilk giris ornegi alindi
+    bool     passthrough;   // Giris zaten yerel bicimde, donusum yok
+    uint8_t  box_len;       // Asagi ornekleme suzgeci uzunlugu, 0 = suzgec yok
+    uint8_t  box_pos;
+    uint16_t box_recip_q15; // 1 / box_len (Q15)
+    int32_t  box_sum;
+    int16_t  box_hist[AUDIO_CONVERT_BOX_MAX];
+} AudioConvert_t;
+
+bool AudioConvert_Init(AudioConvert_t *cv, uint32_t in_rate, uint16_t in_bits, uint16_t in_channels);
+size_t AudioConvert_InputBytesFor(const AudioConvert_t *cv, size_t out_bytes);
+size_t AudioConvert_Process(AudioConvert_t *cv, const uint8_t *in, size_t in_bytes, int16_t *out);
+
+#endif /* MAIN_AUDIOCONVERT_H_ */
@@ -0,0 +1,39 @@
+/*
+ * AudioGain.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Converts the float volume factors to the fixed-point (Q15) gain the mixer applies.
+ *
+ * The gain itself is applied in AudioMixer: each voice is scaled and summed into the mix accumulator with
+ * one multiply-accumulate per sample, and gain changes are ramped linearly across the DMA block there.
+ * AudioMixer_GetCyclesPerSample() reports the cost of that loop, logged after every playback session.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "AudioGain.h"
+
+
+
+/**
+ * @brief Converts a float volume factor to a Q15 gain.
+ *
+ * Called when a clip starts and when its volume changes, instead of reading the float for every sample.
+ * The result is clamped to [0, AUDIO_GAIN_Q15_MAX] so that a 16-bit sample times the gain
+ * always fits in a signed 32-bit product.
+ *
+ * @param[in] factor Linear volume factor (1.0 = unity).
+ * @return Gain in Q15 format.
+ */
+int32_t AudioGain_FactorToQ15(float factor)
+{
+    if (!(factor > 0.0f)) return 0;  // NaN ve negatifleri de sifirla
+    float q = factor * (float)AUDIO_GAIN_Q15_ONE + 0.5f;
+    if (q >= (float)AUDIO_GAIN_Q15_MAX) return AUDIO_GAIN_Q15_MAX;
+    return (int32_t)q;
+}
@@ -0,0 +1,18 @@
+/*
+ * AudioGain.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_AUDIOGAIN_H_
+#define MAIN_AUDIOGAIN_H_
+
+#include <stdint.h>
+
+#define AUDIO_GAIN_Q15_ONE      32768   // 1.0 (Q15)
+#define AUDIO_GAIN_Q15_MAX      65535   // ~2.0, carpim int32'ye sigsin diye ust sinir
+
+int32_t AudioGain_FactorToQ15(float factor);
+
+#endif /* MAIN_AUDIOGAIN_H_ */
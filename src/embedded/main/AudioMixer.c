@@ -0,0 +1,442 @@
+/*
+ * AudioMixer.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Fixed-point mixer for up to AUDIO_MIXER_VOICES concurrent clips with ducking.
+ *
+ * Each voice streams one clip (native PCM from SpeakerDriver_ReadClip) through its own staging buffer,
+ * and the voices are summed into a 32-bit accumulator and saturated to 16 bits. Voice order is priority
+ * order: while a higher voice is playing, every lower voice is ducked to AUDIO_MIXER_DUCK_Q15 with a
+ * linear attack ramp, and brought back with a slower release ramp once it ends. So an idle locator tone
+ * keeps running under a request or green announcement instead of being cut and restarted.
+ *
+ * The clip gain of a voice can be changed while it plays (AudioMixer_SetGain); the new gain is reached
+ * with a linear ramp across the next output block, so continuous volume adaptation causes no zipper noise.
+ * Gain and duck envelope are combined into one effective gain per mixing segment and interpolated
+ * linearly inside it, so the cost per output sample stays one multiply-add per active voice (plus one add
+ * while a ramp is in progress) and a block never costs more than AUDIO_MIXER_VOICES times the single voice
+ * cost. The cycles spent in the mixing loops are measured and published like the gain kernels.
+ *
+ * Every voice also has a prefetch slot: AudioMixer_Prefetch() opens the predicted next clip of the voice
+ * and reads its first AUDIO_MIXER_PREFETCH_SAMPLES while the current clip is still playing. When that
+ * clip is started, the open source and the first block are taken over, so an SD-backed clip starts
+ * without waiting for the card. Clips in the RAM cache need no prefetch. SD starts are counted as
+ * prefetch hits or misses.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "AudioMixer.h"
+#include "AudioConvert.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DUCK_ONE_Q23        (1 << 23)
+#define DUCK_LOW_Q23        (AUDIO_MIXER_DUCK_Q15 << 8)
+#define RAMP_STEP(ms)       ((DUCK_ONE_Q23 - DUCK_LOW_Q23) / (((ms) * AUDIO_NATIVE_SAMPLE_RATE) / 1000 + 1))
+
+// On okuma yuvasinin pf_path icin son sonucu; ipucu degismedikce yeniden denenmez
+typedef enum {
+    PF_NONE = 0,    // Ipucu yok ya da henuz denenmedi
+    PF_READY,       // Klip acik, ilk blok pf_stage'de
+    PF_CACHED,      // Klip RAM onbelleginde, on okuma gereksiz
+    PF_MISSING,     // Dosya acilamadi
+} PrefetchState_t;
+
+typedef struct {
+    ClipSource_t src;
+    bool         active;
+    int32_t      gain_q23;      // Anlik klip kazanci (Q15 << 8)
+    int32_t      gain_goal_q23; // Bu blogun sonunda ulasilacak kazanc
+    int32_t      gain_step;     // Bu blokta ornek basina kazanc adimi
+    volatile int32_t gain_target_q15;  // AudioMixer_SetGain ile gelen hedef
+    int32_t      duck_q23;      // Bastirma zarfi (Q23, 1.0 = bastirma yok)
+    void        *tag;           // Cagiranin klip kaydi
+    int16_t      stage[AUDIO_MIXER_STAGE_SAMPLES];
+    size_t       stage_len;     // Ara tampondaki ornek
+    size_t       stage_pos;
+    ClipSource_t pf_src;        // Onceden acilmis siradaki klip (yalniz PF_READY iken)
+    PrefetchState_t pf_state;
+    char         pf_path[AUDIO_MIXER_PATH_LEN];  // pf_state'in ait oldugu ipucu
+    int16_t      pf_stage[AUDIO_MIXER_PREFETCH_SAMPLES];
+    size_t       pf_len;        // Onceden okunan ornek
+} MixerVoice_t;
+
+static MixerVoice_t s_voices[AUDIO_MIXER_VOICES];
+static int32_t s_acc[AUDIO_MIXER_CHUNK_SAMPLES];
+static AudioMixerStats_t s_stats;
+
+static inline int32_t sat16(int32_t x) { return x < INT16_MIN ? INT16_MIN : (x > INT16_MAX ? INT16_MAX : x); }
+
+
+
+/* Ust siradaki bir ses caliyor mu */
+static bool higher_active(int voice)
+{
+    for (int j = voice + 1; j < AUDIO_MIXER_VOICES; j++) {
+        if (s_voices[j].active) return true;
+    }
+    return false;
+}
+
+/* Sesin ara tamponunu klipten doldurur, klip bittiyse false */
+static bool refill(MixerVoice_t *v)
+{
+    size_t n = SpeakerDriver_ReadClip(&v->src, (uint8_t *)v->stage, sizeof(v->stage));
+    v->stage_len = n / AUDIO_NATIVE_FRAME_BYTES;
+    v->stage_pos = 0;
+    return v->stage_len > 0;
+}
+
+/* Klibi kapatir ve cagirana bildirir; cagiran ayni sese yeni klip baslatabilir */
+static void voice_end(int voice, AudioMixerEndCb_t on_end, void *ctx)
+{
+    MixerVoice_t *v = &s_voices[voice];
+    void *tag = v->tag;
+    SpeakerDriver_CloseClip(&v->src);
+    v->active = false;
+    v->tag = NULL;
+    if (on_end != NULL) on_end(voice, tag, ctx);
+}
+
+/* Sesin on okuma yuvasini kapatir ve kayitli sonucu unutur */
+static void drop_prefetch(MixerVoice_t *v)
+{
+    if (v->pf_state == PF_READY) SpeakerDriver_CloseClip(&v->pf_src);
+    v->pf_state = PF_NONE;
+    v->pf_path[0] = '\0';
+    v->pf_len = 0;
+}
+
+/* Deger hedefe dogru n adim ilerler, hedefi gecmez */
+static inline int32_t advance(int32_t value, int32_t step, int32_t target, size_t n)
+{
+    if (value == target) return value;
+    int32_t next = value + step * (int32_t)n;
+    if ((step <= 0 && next <= target) || (step >= 0 && next >= target)) return target;
+    return next;
+}
+
+/* Kazanc ve bastirma zarfinin carpimi (Q15) */
+static inline int32_t effective_q15(int32_t gain_q23, int32_t duck_q23)
+{
+    return ((gain_q23 >> 8) * (duck_q23 >> 8)) >> 15;
+}
+
+/*
+ * n ornegi akumulatore ekler. Kazanc ve bastirma parca sonuna kadar ilerletilir, parca icinde etkin
+ * kazanc dogrusal enterpole edilir: ornek basina bir carpma-toplama ve bir toplama.
+ */
+static void IRAM_ATTR mix_voice(int32_t *acc, const int16_t *in, size_t n, MixerVoice_t *v, int32_t duck_target)
+{
+    const int32_t duck_step = (v->duck_q23 > duck_target) ? -RAMP_STEP(AUDIO_MIXER_ATTACK_MS) : RAMP_STEP(AUDIO_MIXER_RELEASE_MS);
+    const int32_t eff0 = effective_q15(v->gain_q23, v->duck_q23);
+
+    v->gain_q23 = advance(v->gain_q23, v->gain_step, v->gain_goal_q23, n);
+    v->duck_q23 = advance(v->duck_q23, duck_step, duck_target, n);
+    const int32_t eff1 = effective_q15(v->gain_q23, v->duck_q23);
+
+    if (eff0 == eff1) {
+        // Sabit kazanc: ornek basina tek carpma-toplama
+        for (size_t k = 0; k < n; k++) {
+            acc[k] += ((int32_t)in[k] * eff0) >> 15;
+        }
+    } else {
+        int32_t e = eff0 << 8;
+        const int32_t e_step = ((eff1 - eff0) << 8) / (int32_t)n;
+        for (size_t k = 0; k < n; k++) {
+            e += e_step;
+            acc[k] += ((int32_t)in[k] * (e >> 8)) >> 15;
+        }
+    }
+}
+
+/* Her sesin kazanc hedefini bu blok boyunca dogrusal rampaya cevirir */
+static void plan_gain_ramps(size_t samples)
+{
+    for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        MixerVoice_t *v = &s_voices[i];
+        if (!v->active) continue;
+        v->gain_goal_q23 = v->gain_target_q15 << 8;  // Hedef blok basinda bir kez okunur
+        int32_t diff = v->gain_goal_q23 - v->gain_q23;
+        v->gain_step = diff / (int32_t)samples;
+        if (v->gain_step == 0 && diff != 0) v->gain_step = (diff > 0) ? 1 : -1;
+    }
+}
+
+
+
+/**
+ * @brief Stops every voice and clears the mixer state.
+ *
+ * @param[in] on_stop Optional callback invoked for every voice that was still playing (may be NULL).
+ * @param[in] ctx     User argument passed to on_stop.
+ */
+void AudioMixer_Reset(AudioMixerEndCb_t on_stop, void *ctx)
+{
+    for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        if (s_voices[i].active) voice_end(i, on_stop, ctx);
+        s_voices[i].tag = NULL;
+        s_voices[i].duck_q23 = DUCK_ONE_Q23;
+    }
+}
+
+
+
+/**
+ * @brief Starts a clip on a voice.
+ *
+ * A voice that starts while a higher voice is playing begins at the ducked level, so it never pops in
+ * at full volume.
+ *
+ * @param[in] voice     Voice index, 0 (lowest priority) .. AUDIO_MIXER_VOICES-1.
+ * @param[in] file_path Full path of the WAV file.
+ * @param[in] gain_q15  Clip gain from AudioGain_FactorToQ15().
+ * @param[in] tag       Caller data returned in the end callback.
+ * @return true if the clip was opened, false otherwise.
+ */
+bool AudioMixer_Start(int voice, const char *file_path, int32_t gain_q15, void *tag)
+{
+    if (voice < 0 || voice >= AUDIO_MIXER_VOICES) return false;
+    MixerVoice_t *v = &s_voices[voice];
+
+    if (v->active) SpeakerDriver_CloseClip(&v->src);
+    v->active = false;
+
+    if (v->pf_state == PF_READY && strcmp(v->pf_path, file_path) == 0) {
+        // Onceden acilmis kaynak ve ilk blok devralinir, SD beklenmez
+        v->src = v->pf_src;
+        memcpy(v->stage, v->pf_stage, v->pf_len * sizeof(v->stage[0]));
+        v->stage_len = v->pf_len;
+        v->pf_state = PF_NONE;
+        v->pf_path[0] = '\0';
+        v->pf_len = 0;
+        s_stats.prefetch_hits++;
+    } else {
+        // Baska bir acik on okuma kapatilir; onbellek/eksik sonucu kaynak tutmaz, ipucu icin saklanir
+        if (v->pf_state == PF_READY) drop_prefetch(v);
+        if (!SpeakerDriver_OpenClip(file_path, &v->src)) return false;
+        v->stage_len = 0;
+        if (v->src.file != NULL) {
+            s_stats.prefetch_misses++;
+        } else {
+            printf("[CACHE] RAM'den caliniyor: %s\n", file_path);
+        }
+    }
+
+    v->gain_q23 = gain_q15 << 8;
+    v->gain_target_q15 = gain_q15;
+    v->gain_goal_q23 = v->gain_q23;
+    v->gain_step = 0;
+    v->tag = tag;
+    v->stage_pos = 0;
+    v->duck_q23 = higher_active(voice) ? DUCK_LOW_Q23 : DUCK_ONE_Q23;
+    v->active = true;
+    return true;
+}
+
+
+
+/**
+ * @brief Changes the gain of the clip playing on a voice.
+ *
+ * May be called from any task. The mixer ramps linearly to the new gain across the next rendered block;
+ * the gain of a newly started clip is the one given to AudioMixer_Start().
+ *
+ * @param[in] voice    Voice index.
+ * @param[in] gain_q15 New gain from AudioGain_FactorToQ15().
+ */
+void AudioMixer_SetGain(int voice, int32_t gain_q15)
+{
+    if (voice < 0 || voice >= AUDIO_MIXER_VOICES || !s_voices[voice].active) return;
+    s_voices[voice].gain_target_q15 = gain_q15;
+}
+
+
+
+/**
+ * @brief Opens the predicted next clip of a voice and reads its first block.
+ *
+ * Must be called from the task that renders (SpeakerDriver_ReadClip has one reader). The outcome is
+ * remembered per voice together with the path: while the same path is passed again, the call returns at
+ * once, whether the clip is prefetched, served from the RAM cache (it starts without SD access anyway)
+ * or could not be opened. Only a different path closes the old prefetch and tries again, so calling this
+ * every block costs a string compare.
+ *
+ * @param[in] voice     Voice index.
+ * @param[in] file_path Full path of the clip expected next on this voice.
+ * @return true if the clip is prefetched.
+ */
+bool AudioMixer_Prefetch(int voice, const char *file_path)
+{
+    if (voice < 0 || voice >= AUDIO_MIXER_VOICES || file_path == NULL) return false;
+    MixerVoice_t *v = &s_voices[voice];
+    if (v->pf_state != PF_NONE && strcmp(v->pf_path, file_path) == 0) return v->pf_state == PF_READY;
+
+    drop_prefetch(v);
+    if (strlen(file_path) >= sizeof(v->pf_path)) return false;
+    strcpy(v->pf_path, file_path);
+
+    if (!SpeakerDriver_OpenClip(file_path, &v->pf_src)) {
+        v->pf_state = PF_MISSING;
+        return false;
+    }
+    if (v->pf_src.file == NULL) {
+        SpeakerDriver_CloseClip(&v->pf_src);  // RAM onbelleginde, on okuma gereksiz
+        v->pf_state = PF_CACHED;
+        return false;
+    }
+
+    size_t n = SpeakerDriver_ReadClip(&v->pf_src, (uint8_t *)v->pf_stage, sizeof(v->pf_stage));
+    v->pf_len = n / AUDIO_NATIVE_FRAME_BYTES;
+    v->pf_state = PF_READY;
+    return true;
+}
+
+
+
+/**
+ * @brief Closes the prefetched clip of a voice, if any.
+ *
+ * @param[in] voice Voice index.
+ */
+void AudioMixer_DropPrefetch(int voice)
+{
+    if (voice < 0 || voice >= AUDIO_MIXER_VOICES) return;
+    drop_prefetch(&s_voices[voice]);
+}
+
+
+
+/**
+ * @brief Tells whether a voice is playing a clip.
+ *
+ * @param[in] voice Voice index.
+ * @return true if the voice is active.
+ */
+bool AudioMixer_IsActive(int voice)
+{
+    return voice >= 0 && voice < AUDIO_MIXER_VOICES && s_voices[voice].active;
+}
+
+
+
+/**
+ * @brief Tells whether any voice is playing.
+ *
+ * @return true if at least one voice is active.
+ */
+bool AudioMixer_AnyActive(void)
+{
+    for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        if (s_voices[i].active) return true;
+    }
+    return false;
+}
+
+
+
+/**
+ * @brief Mixes the active voices into a block of native PCM.
+ *
+ * When a clip ends inside the block, on_end is called immediately; if it starts a new clip on that voice,
+ * the new clip continues in the same block without a gap. Rendering stops early only when every voice
+ * has ended.
+ *
+ * @param[out] out     Output buffer (native 16-bit mono).
+ * @param[in]  samples Capacity of out in samples.
+ * @param[in]  on_end  Optional end-of-clip callback.
+ * @param[in]  ctx     User argument passed to on_end.
+ * @return Number of samples written, 0 if no voice is active.
+ */
+size_t AudioMixer_Render(int16_t *out, size_t samples, AudioMixerEndCb_t on_end, void *ctx)
+{
+    size_t done = 0;
+    uint32_t cycles = 0;
+    uint32_t voices_used = 0;
+
+    plan_gain_ramps(samples);
+
+    while (done < samples) {
+        size_t chunk = samples - done;
+        if (chunk > AUDIO_MIXER_CHUNK_SAMPLES) chunk = AUDIO_MIXER_CHUNK_SAMPLES;
+        size_t produced = 0;
+        uint32_t active = 0;
+
+        memset(s_acc, 0, chunk * sizeof(s_acc[0]));
+
+        for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+            MixerVoice_t *v = &s_voices[i];
+            if (!v->active) continue;
+            active++;
+
+            int32_t duck_target = higher_active(i) ? DUCK_LOW_Q23 : DUCK_ONE_Q23;
+            size_t pos = 0;
+            while (pos < chunk && v->active) {
+                if (v->stage_pos >= v->stage_len && !refill(v)) {
+                    voice_end(i, on_end, ctx);  // Ayni seste siradaki klip baslayabilir
+                    continue;
+                }
+                size_t n = v->stage_len - v->stage_pos;
+                if (n > chunk - pos) n = chunk - pos;
+
+                uint32_t t0 = esp_cpu_get_cycle_count();
+                mix_voice(&s_acc[pos], &v->stage[v->stage_pos], n, v, duck_target);
+                cycles += esp_cpu_get_cycle_count() - t0;
+
+                pos += n;
+                v->stage_pos += n;
+            }
+            if (pos > produced) produced = pos;
+        }
+        if (active > voices_used) voices_used = active;
+        if (produced == 0) break;
+
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (size_t k = 0; k < produced; k++) {
+            out[done + k] = (int16_t)sat16(s_acc[k]);
+        }
+        cycles += esp_cpu_get_cycle_count() - t0;
+
+        done += produced;
+        if (produced < chunk) break;  // Tum sesler bu parcada bitti
+    }
+
+    s_stats.cycles += cycles;
+    s_stats.samples += done;
+    if (voices_used > s_stats.max_voices) s_stats.max_voices = voices_used;
+    return done;
+}
+
+
+
+/**
+ * @brief Returns the average CPU cycles spent mixing per output sample.
+ *
+ * @return Average cycles per output sample, or 0 if nothing has been mixed yet.
+ */
+float AudioMixer_GetCyclesPerSample(void)
+{
+    if (s_stats.samples == 0) return 0.0f;
+    return (float)s_stats.cycles / (float)s_stats.samples;
+}
+
+
+
+/**
+ * @brief Copies the mixer counters.
+ *
+ * @param[out] out Pointer to a structure receiving the statistics.
+ */
+void AudioMixer_GetStats(AudioMixerStats_t *out)
+{
+    if (out == NULL) return;
+    *out = s_stats;
+}
@@ -0,0 +1,72 @@
+/*
+ * AudioMixer.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_AUDIOMIXER_H_
+#define MAIN_AUDIOMIXER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "SpeakerDriver.h"
+
+// Ses sayisi: 0 arka plan (idle), 1 request, 2 yesil/test. Yuksek indeksli ses dusukleri bastirir.
+#define AUDIO_MIXER_VOICES          3
+
+// Her sesin SD/onbellekten okudugu ara tampon (ornek)
+#ifndef AUDIO_MIXER_STAGE_SAMPLES
+#define AUDIO_MIXER_STAGE_SAMPLES   1024
+#endif
+
+// Siradaki klip icin onceden okunan ilk blok (ornek)
+#ifndef AUDIO_MIXER_PREFETCH_SAMPLES
+#define AUDIO_MIXER_PREFETCH_SAMPLES 512
+#endif
+
+#define AUDIO_MIXER_PATH_LEN        64
+
+// Karistirma alt parcasi (ornek): bastirma hedefi bu aralikla guncellenir
+#define AUDIO_MIXER_CHUNK_SAMPLES   256
+
+// Bastirilan sesin seviyesi (Q15, 8192 = 0.25 = -12 dB)
+#ifndef AUDIO_MIXER_DUCK_Q15
+#define AUDIO_MIXER_DUCK_Q15        8192
+#endif
+
+#ifndef AUDIO_MIXER_ATTACK_MS
+#define AUDIO_MIXER_ATTACK_MS       40      // Bastirmaya inis suresi
+#endif
+
+#ifndef AUDIO_MIXER_RELEASE_MS
+#define AUDIO_MIXER_RELEASE_MS      300     // Tam seviyeye donus suresi
+#endif
+
+/**
+ * Called from AudioMixer_Render() when the clip of a voice has been fully mixed. The callee may start the
+ * next clip on the same voice with AudioMixer_Start(), which is then mixed without any gap.
+ */
+typedef void (*AudioMixerEndCb_t)(int voice, void *tag, void *ctx);
+
+typedef struct {
+    uint64_t cycles;    // Render icinde harcanan toplam CPU cycle
+    uint64_t samples;   // Uretilen toplam cikis ornegi
+    uint32_t max_voices; // Ayni anda karistirilan en fazla ses
+    uint32_t prefetch_hits;   // Onceden acilmis kaynaktan baslayan SD klibi
+    uint32_t prefetch_misses; // Soguk acilan SD klibi
+} AudioMixerStats_t;
+
+void AudioMixer_Reset(AudioMixerEndCb_t on_stop, void *ctx);
+bool AudioMixer_Start(int voice, const char *file_path, int32_t gain_q15, void *tag);
+void AudioMixer_SetGain(int voice, int32_t gain_q15);
+bool AudioMixer_Prefetch(int voice, const char *file_path);
+void AudioMixer_DropPrefetch(int voice);
+bool AudioMixer_IsActive(int voice);
+bool AudioMixer_AnyActive(void);
+size_t AudioMixer_Render(int16_t *out, size_t samples, AudioMixerEndCb_t on_end, void *ctx);
+float AudioMixer_GetCyclesPerSample(void);
+void AudioMixer_GetStats(AudioMixerStats_t *out);
+
+#endif /* MAIN_AUDIOMIXER_H_ */
@@ -0,0 +1,319 @@
+/*
+ * AudioPipeline.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Provides a producer/consumer buffer ring between the SD card reader and the I2S output.
+ *
+ * The reader side (PlayWav_Task via PlayQueue and AudioMixer) fills pre-scaled PCM blocks taken from a free queue
+ * and submits them to a filled queue. A dedicated writer task drains the filled queue into the I2S
+ * DMA, so SD card stalls are absorbed by the ring instead of turning directly into audible gaps.
+ * Underruns (writer starved while a clip is still streaming) are counted for diagnostics.
+ *
+ * Every block is native PCM16 mono, so the writer also measures the mean square of each block it hands
+ * to the DMA and publishes it with the time the sound is expected to have died away. The microphone
+ * loudness estimator reads this envelope to keep the device's own announcements out of the ambient level.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "AudioPipeline.h"
+#include "AudioConvert.h"
+#include "driver/i2s_std.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern i2s_chan_handle_t tx_handle;
+
+TaskHandle_t audio_writer_task_handle = NULL;
+
+static const char *TAG_PIPE = "AUDIO_PIPE";
+
+static AudioBlock_t s_blocks[AUDIO_PIPELINE_DEPTH];
+static QueueHandle_t s_freeQueue = NULL;
+static QueueHandle_t s_filledQueue = NULL;
+static SemaphoreHandle_t s_clipDoneSem = NULL;
+static volatile bool s_streamActive = false;
+static AudioPipelineStats_t s_stats;
+static AudioOutputEnvelope_t s_envelope;
+static portMUX_TYPE s_envelopeMux = portMUX_INITIALIZER_UNLOCKED;
+
+
+
+/* Iki klip arasindaki yazici bekleme suresini istatistige ekler */
+static void RecordClipGap(uint32_t gap_us)
+{
+    s_stats.gap_last_us = gap_us;
+    if (gap_us > s_stats.gap_max_us) s_stats.gap_max_us = gap_us;
+    s_stats.gap_total_us += gap_us;
+    s_stats.clip_gaps++;
+}
+
+/* PCM16 blogun ortalama karesi, Q30 */
+static uint32_t BlockMeanSquare(const int16_t *pcm, size_t n)
+{
+    if (n == 0) return 0;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t s = pcm[i];
+        sum += (uint32_t)(s * s);
+    }
+    return (uint32_t)(sum / n);
+}
+
+/* Yazilan blogun zarfini yayinlar; bir onceki blok DMA'da hala caliyor olabilir, buyuk olan tutulur */
+static void PublishEnvelope(uint32_t ms_q30, uint32_t *prev_ms_q30)
+{
+    uint32_t env = ms_q30 > *prev_ms_q30 ? ms_q30 : *prev_ms_q30;
+    *prev_ms_q30 = ms_q30;
+    int64_t until_us = esp_timer_get_time() + (int64_t)AUDIO_OUTPUT_HANG_MS * 1000;
+
+    portENTER_CRITICAL(&s_envelopeMux);
+    s_envelope.ms_q30 = env;
+    s_envelope.until_us = until_us;
+    s_envelope.streaming = s_streamActive;
+    portEXIT_CRITICAL(&s_envelopeMux);
+}
+
+
+
+/**
+ * @brief Allocates the block ring, creates the queues and starts the I2S writer task.
+ *
+ * All AUDIO_PIPELINE_DEPTH blocks are allocated once here and recycled for the lifetime of the
+ * application, so playback never allocates on the hot path. Calling the function again after a
+ * successful initialization has no effect.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if a queue, semaphore or block could not be allocated,
+ *         ESP_FAIL if the writer task could not be created.
+ */
+esp_err_t AudioPipeline_Init(void)
+{
+    if (s_freeQueue != NULL) return ESP_OK;  // Zaten baslatildi
+
+    s_freeQueue   = xQueueCreate(AUDIO_PIPELINE_DEPTH, sizeof(AudioBlock_t *));
+    s_filledQueue = xQueueCreate(AUDIO_PIPELINE_DEPTH, sizeof(AudioBlock_t *));
+    s_clipDoneSem = xSemaphoreCreateBinary();
+    if (s_freeQueue == NULL || s_filledQueue == NULL || s_clipDoneSem == NULL) {
+        ESP_LOGE(TAG_PIPE, "Kuyruk olusturulamadi");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < AUDIO_PIPELINE_DEPTH; i++) {
+        s_blocks[i].data = (uint8_t *)malloc(AUDIO_PIPELINE_BLOCK_SIZE);
+        if (s_blocks[i].data == NULL) {
+            ESP_LOGE(TAG_PIPE, "Tampon ayrilamadi (%d/%d)", i + 1, AUDIO_PIPELINE_DEPTH);
+            return ESP_ERR_NO_MEM;
+        }
+        s_blocks[i].len = 0;
+        s_blocks[i].end_of_clip = false;
+        s_blocks[i].done_cb = NULL;
+        AudioBlock_t *blk = &s_blocks[i];
+        xQueueSend(s_freeQueue, &blk, 0);
+    }
+
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    if (xTaskCreate(AudioWriter_Task, "AudioWriter_Task", AUDIO_WRITER_TASK_STACK, NULL,
+                    AUDIO_WRITER_TASK_PRIORITY, &audio_writer_task_handle) != pdPASS) {
+        ESP_LOGE(TAG_PIPE, "AudioWriter_Task olusturulamadi");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG_PIPE, "Pipeline hazir: %d x %d byte", AUDIO_PIPELINE_DEPTH, AUDIO_PIPELINE_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Takes an empty block from the ring for the reader to fill.
+ *
+ * @param[in] wait Maximum time to wait for a free block (ticks).
+ * @return Pointer to a free block, or NULL if none became available in time.
+ */
+AudioBlock_t *AudioPipeline_GetFreeBlock(TickType_t wait)
+{
+    AudioBlock_t *blk = NULL;
+    if (s_freeQueue == NULL) return NULL;
+    if (xQueueReceive(s_freeQueue, &blk, wait) != pdTRUE) return NULL;
+    blk->len = 0;
+    blk->end_of_clip = false;
+    blk->done_cb = NULL;
+    blk->done_arg = NULL;
+    return blk;
+}
+
+
+
+/**
+ * @brief Hands a filled block over to the writer task.
+ *
+ * The block must have been obtained with AudioPipeline_GetFreeBlock(). Set end_of_clip on the last
+ * block of a stream; the writer signals AudioPipeline_WaitClipDone() once that block reached the DMA.
+ * A done_cb set on a block is invoked from the writer task right after the block was written, which
+ * lets a queue of clips learn about each clip boundary without closing the stream.
+ *
+ * @param[in] block Filled block to be written to I2S.
+ */
+void AudioPipeline_SubmitBlock(AudioBlock_t *block)
+{
+    if (block == NULL) return;
+    xQueueSend(s_filledQueue, &block, portMAX_DELAY);
+}
+
+
+
+/**
+ * @brief Blocks until the writer has consumed the end-of-clip block.
+ *
+ * @param[in] wait Maximum time to wait (ticks).
+ * @return true if the clip was completely handed to the I2S DMA, false on timeout.
+ */
+bool AudioPipeline_WaitClipDone(TickType_t wait)
+{
+    if (s_clipDoneSem == NULL) return true;
+    return xSemaphoreTake(s_clipDoneSem, wait) == pdTRUE;
+}
+
+
+
+/**
+ * @brief Returns the number of writer underruns since boot.
+ *
+ * An underrun is counted when the writer finds the filled queue empty while a clip is still streaming,
+ * i.e. the SD reader could not keep up and the I2S DMA was about to starve.
+ *
+ * @return Underrun count.
+ */
+uint32_t AudioPipeline_GetUnderrunCount(void)
+{
+    return s_stats.underruns;
+}
+
+
+
+/**
+ * @brief Returns the average clip-to-clip gap measured by the writer.
+ *
+ * The gap is the time the writer waited between the last block of one clip and the first block of the
+ * next clip of the same stream. Audible silence only occurs when it exceeds the audio still buffered in
+ * the I2S DMA; a value near zero means the clips were concatenated seamlessly.
+ *
+ * @return Average gap in microseconds, 0 if no gap has been measured yet.
+ */
+uint32_t AudioPipeline_GetAvgClipGapUs(void)
+{
+    if (s_stats.clip_gaps == 0) return 0;
+    return (uint32_t)(s_stats.gap_total_us / s_stats.clip_gaps);
+}
+
+
+
+/**
+ * @brief Copies the pipeline counters.
+ *
+ * @param[out] out Pointer to a structure receiving the statistics.
+ */
+void AudioPipeline_GetStats(AudioPipelineStats_t *out)
+{
+    if (out == NULL) return;
+    *out = s_stats;
+}
+
+
+
+/**
+ * @brief Copies the envelope of the audio most recently handed to the speaker.
+ *
+ * @param[out] out Receives the envelope.
+ *
+ * @details
+ * ms_q30 is the larger mean square of the last two written blocks, since the previous block may still be
+ * playing from the DMA. The output counts as audible until until_us, which lies AUDIO_OUTPUT_HANG_MS past
+ * the end of the last write and covers the DMA queue plus the decay of the room. Safe from any task.
+ */
+void AudioPipeline_GetOutputEnvelope(AudioOutputEnvelope_t *out)
+{
+    if (out == NULL) return;
+    portENTER_CRITICAL(&s_envelopeMux);
+    *out = s_envelope;
+    portEXIT_CRITICAL(&s_envelopeMux);
+}
+
+
+
+/**
+ * @brief FreeRTOS task that drains filled blocks into the I2S DMA.
+ *
+ * Runs at a higher priority than PlayWav_Task so that the DMA keeps being fed while the reader is
+ * blocked in fread(). Every consumed block is recycled to the free queue. When the filled queue is
+ * found empty in the middle of a clip, an underrun is counted once per starvation episode.
+ * The time between a clip boundary (a block carrying a done hook) and the first data block of the
+ * next clip of the same stream is recorded as the clip-to-clip gap.
+ * After each write the output envelope is updated, see AudioPipeline_GetOutputEnvelope().
+ *
+ * @param[in] pvParameters Pointer to task parameters (unused).
+ */
+void AudioWriter_Task(void *pvParameters)
+{
+    AudioBlock_t *blk = NULL;
+    size_t bytes_written = 0;
+    int64_t gap_start_us = -1;  // Klip siniri yazildigi an, bekleyen olcum yoksa -1
+    uint32_t prev_ms_q30 = 0;
+
+    while (1) {
+        if (xQueueReceive(s_filledQueue, &blk, 0) != pdTRUE) {
+            if (s_streamActive) {
+                s_stats.underruns++;
+                ESP_LOGW(TAG_PIPE, "Underrun (%" PRIu32 ")", s_stats.underruns);
+            }
+            xQueueReceive(s_filledQueue, &blk, portMAX_DELAY);
+        }
+
+        s_streamActive = !blk->end_of_clip;
+
+        if (blk->len > 0 && gap_start_us >= 0) {
+            RecordClipGap((uint32_t)(esp_timer_get_time() - gap_start_us));
+            gap_start_us = -1;
+        }
+
+        if (blk->len > 0) {
+            uint32_t ms_q30 = BlockMeanSquare((const int16_t *)blk->data, blk->len / AUDIO_NATIVE_FRAME_BYTES);
+            esp_err_t ret = i2s_channel_write(tx_handle, blk->data, blk->len, &bytes_written, portMAX_DELAY);
+            if (ret != ESP_OK) {
+                s_stats.write_errors++;
+                ESP_LOGE(TAG_PIPE, "I2S yazma hatasi: %s", esp_err_to_name(ret));
+            } else {
+                s_stats.blocks_written++;
+            }
+            PublishEnvelope(ms_q30, &prev_ms_q30);
+        }
+
+        bool clip_done = blk->end_of_clip;
+        void (*done_cb)(void *arg) = blk->done_cb;
+        void *done_arg = blk->done_arg;
+        xQueueSend(s_freeQueue, &blk, portMAX_DELAY);
+
+        if (done_cb != NULL) {
+            done_cb(done_arg);
+        }
+        if (clip_done) {
+            gap_start_us = -1;  // Akis bitti, sonraki klip yeni oturumda
+        } else if (done_cb != NULL) {
+            gap_start_us = esp_timer_get_time();
+        }
+
+        if (clip_done) {
+            s_stats.clips_played++;
+            xSemaphoreGive(s_clipDoneSem);
+        }
+    }
+}
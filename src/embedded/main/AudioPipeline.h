@@ -0,0 +1,76 @@
+/*
+ * AudioPipeline.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_AUDIOPIPELINE_H_
+#define MAIN_AUDIOPIPELINE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+
+// Ring'deki tampon sayisi (okuyucu ile yazici arasindaki derinlik)
+#ifndef AUDIO_PIPELINE_DEPTH
+#define AUDIO_PIPELINE_DEPTH        4
+#endif
+
+// Her tamponun boyutu (byte): 16 kHz mono 16-bit'te 768 ornek, ~48 ms
+#ifndef AUDIO_PIPELINE_BLOCK_SIZE
+#define AUDIO_PIPELINE_BLOCK_SIZE   1536
+#endif
+
+// Son yazilan bloktan sonra cikisin hala duyuldugu kabul edilen sure: I2S DMA kuyrugu (~90 ms) ve oda yankisi
+#ifndef AUDIO_OUTPUT_HANG_MS
+#define AUDIO_OUTPUT_HANG_MS        200
+#endif
+
+#define AUDIO_WRITER_TASK_STACK     (1024 * 3)
+#define AUDIO_WRITER_TASK_PRIORITY  4   // PlayWav_Task (3) ustunde, DMA beslemesi aksamasin
+
+typedef struct {
+    uint8_t *data;       // Olceklenmis PCM verisi
+    size_t   len;        // Gecerli byte sayisi
+    bool     end_of_clip; // Akisin son blogu, yazici sonrasinda WaitClipDone'u serbest birakir (len 0 olabilir)
+    void   (*done_cb)(void *arg); // Blok DMA'ya verildikten sonra yazici gorevinde cagrilir (NULL olabilir)
+    void    *done_arg;
+} AudioBlock_t;
+
+typedef struct {
+    uint32_t underruns;       // Yazici veri beklerken DMA'nin ac kaldigi durum sayisi
+    uint32_t blocks_written;  // I2S'e yazilan toplam blok
+    uint32_t write_errors;    // i2s_channel_write hatalari
+    uint32_t clips_played;    // Tamamlanan akis sayisi
+    uint32_t clip_gaps;       // Olculen klip-klip gecisi
+    uint32_t gap_last_us;     // Son gecisteki yazici bekleme suresi
+    uint32_t gap_max_us;
+    uint64_t gap_total_us;
+} AudioPipelineStats_t;
+
+// Hoparlore giden sesin zarfi; mikrofon olcumu kendi sesini ayirt etmek icin okur
+typedef struct {
+    bool     streaming;       // Bir akis acik (son blok henuz yazilmadi)
+    uint32_t ms_q30;          // Son iki blogun buyuk olan ortalama karesi, Q30 (1.0 = tam olcek)
+    int64_t  until_us;        // Son yazilan blogun sesinin sonu + AUDIO_OUTPUT_HANG_MS (esp_timer), hic yazilmadiysa 0
+} AudioOutputEnvelope_t;
+
+extern TaskHandle_t audio_writer_task_handle;
+
+esp_err_t AudioPipeline_Init(void);
+AudioBlock_t *AudioPipeline_GetFreeBlock(TickType_t wait);
+void AudioPipeline_SubmitBlock(AudioBlock_t *block);
+bool AudioPipeline_WaitClipDone(TickType_t wait);
+uint32_t AudioPipeline_GetUnderrunCount(void);
+uint32_t AudioPipeline_GetAvgClipGapUs(void);
+void AudioPipeline_GetStats(AudioPipelineStats_t *out);
+void AudioPipeline_GetOutputEnvelope(AudioOutputEnvelope_t *out);
+void AudioWriter_Task(void *pvParameters);
+
+#endif /* MAIN_AUDIOPIPELINE_H_ */
@@ -0,0 +1,489 @@
+/*
+ * ClipCache.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Keeps frequently played clips (countdown numbers, idle locator sound) resident in RAM.
+ *
+ * The cache holds the raw "data" chunk of selected WAV files so the mixer can feed the audio pipeline
+ * without touching the SD card. Memory use is bounded by CLIP_CACHE_BUDGET_BYTES and by a minimum free
+ * heap reserve, because the device has no PSRAM. Whenever the active configuration changes, the clips it
+ * needs are queued to a low priority loader task; those clips are protected from eviction, everything else
+ * is evicted least-recently-used first. A clip that cannot be cached is simply streamed from SD as before.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "ClipCache.h"
+#include "ImaAdpcm.h"
+#include "SD_SPI.h"
+#include "Plan.h"
+#include "DetectTraffic.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+extern struct xCurrentConfiguration CurrentConfiguration;
+
+typedef struct {
+    char     name[WAV_INDEX_NAME_LEN];
+    uint32_t generation;   // 0: calma sirasinda iskalanan klip, >0: plan on yuklemesi
+} ClipLoadRequest_t;
+
+static const char *TAG_CACHE = "CLIP_CACHE";
+
+static ClipCacheEntry_t s_entries[CLIP_CACHE_MAX_ENTRIES];
+static ClipCacheStats_t s_stats;
+static SemaphoreHandle_t s_cacheMutex = NULL;
+static QueueHandle_t s_loadQueue = NULL;
+static uint32_t s_clock = 0;              // LRU zaman damgasi
+static volatile uint32_t s_generation = 0; // Aktif planin istedigi klip nesli
+static uint32_t s_planSignature = 0;      // Son on yuklenen klip listesinin ozeti
+static uint32_t s_missPending[CLIP_CACHE_MISS_PENDING]; // Kuyrukta bekleyen iskalama yuklemelerinin isim ozeti, 0: bos
+
+static void ClipCache_LoaderTask(void *pvParameters);
+
+
+
+static const char *base_name(const char *file_path)
+{
+    const char *p = strrchr(file_path, '/');
+    return p ? p + 1 : file_path;
+}
+
+/* Buyuk/kucuk harf duyarsiz isim ozeti (FNV-1a), hicbir zaman 0 degil */
+static uint32_t name_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char *p = name; *p; p++) {
+        hash ^= (uint8_t)tolower((unsigned char)*p);
+        hash *= 16777619u;
+    }
+    return hash ? hash : 1u;
+}
+
+/* Gecerli (stale olmayan) kaydi bulur. Kilit altinda cagrilmali. */
+static int find_locked(const char *name)
+{
+    for (int i = 0; i < CLIP_CACHE_MAX_ENTRIES; i++) {
+        if (s_entries[i].name[0] != '\0' && !s_entries[i].stale && strcasecmp(s_entries[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Slotu ve bellegini serbest birakir. Kilit altinda cagrilmali. */
+static void free_slot_locked(int i)
+{
+    free(s_entries[i].pcm);
+    s_stats.bytes_used -= s_entries[i].len;
+    s_stats.entries--;
+    memset(&s_entries[i], 0, sizeof(s_entries[i]));
+}
+
+/*
+ * len byte'lik yeni bir klip icin yer acar ve bos slot indeksini doner, yer acilamazsa -1.
+ * Sadece kullanilmayan ve aktif planin istemedigi kayitlar, en eski kullanilandan baslayarak tahliye edilir.
+ * Kilit altinda cagrilmali.
+ */
+static int make_room_locked(uint32_t len)
+{
+    while (1) {
+        int free_slot = -1;
+        for (int i = 0; i < CLIP_CACHE_MAX_ENTRIES; i++) {
+            if (s_entries[i].name[0] == '\0') { free_slot = i; break; }
+        }
+        if (free_slot >= 0 && s_stats.bytes_used + len <= CLIP_CACHE_BUDGET_BYTES) {
+            return free_slot;
+        }
+
+        int victim = -1;
+        for (int i = 0; i < CLIP_CACHE_MAX_ENTRIES; i++) {
+            ClipCacheEntry_t *e = &s_entries[i];
+            if (e->name[0] == '\0' || e->refcount != 0 || e->pcm == NULL) continue;
+            if (e->generation != 0 && e->generation == s_generation) continue;  // Aktif plan bu klibi istiyor
+            if (victim < 0 || e->last_used < s_entries[victim].last_used) victim = i;
+        }
+        if (victim < 0) return -1;
+
+        ESP_LOGI(TAG_CACHE, "Tahliye: %s (%" PRIu32 " byte)", s_entries[victim].name, s_entries[victim].len);
+        free_slot_locked(victim);
+        s_stats.evictions++;
+    }
+}
+
+
+
+/**
+ * @brief Creates the cache lock, the load queue and the loader task.
+ *
+ * Must be called after WavIndex_Build(), since clip locations are taken from the WAV index.
+ * Calling the function again after a successful initialization has no effect.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the mutex or queue could not be created,
+ *         ESP_FAIL if the loader task could not be created.
+ */
+esp_err_t ClipCache_Init(void)
+{
+    if (s_cacheMutex != NULL) return ESP_OK;
+
+    s_cacheMutex = xSemaphoreCreateMutex();
+    s_loadQueue = xQueueCreate(CLIP_CACHE_LOAD_QUEUE_LEN, sizeof(ClipLoadRequest_t));
+    if (s_cacheMutex == NULL || s_loadQueue == NULL) {
+        ESP_LOGE(TAG_CACHE, "Kilit/kuyruk olusturulamadi");
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(s_entries, 0, sizeof(s_entries));
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_missPending, 0, sizeof(s_missPending));
+
+    if (xTaskCreate(ClipCache_LoaderTask, "ClipCache_Task", CLIP_CACHE_TASK_STACK, NULL,
+                    CLIP_CACHE_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG_CACHE, "ClipCache_Task olusturulamadi");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG_CACHE, "Klip onbellegi hazir: butce %d byte, %d kayit", CLIP_CACHE_BUDGET_BYTES, CLIP_CACHE_MAX_ENTRIES);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Looks up a clip and pins it in memory for playback.
+ *
+ * On a hit the entry is pinned until ClipCache_Release() is called, so it cannot be evicted while it is
+ * being played. On a miss a background load is requested, so the next play of the same clip can be served
+ * from RAM, and NULL is returned so the caller streams the clip from SD. No second load is requested while
+ * one for the same clip is queued or being read.
+ *
+ * @param[in] file_path Full path or base name of the clip.
+ * @return Pinned cache entry, or NULL on a miss.
+ */
+const ClipCacheEntry_t *ClipCache_Acquire(const char *file_path)
+{
+    if (s_cacheMutex == NULL || file_path == NULL) return NULL;
+
+    const char *name = base_name(file_path);
+    ClipCacheEntry_t *entry = NULL;
+
+    xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+    int i = find_locked(name);
+    bool loading = i >= 0 && s_entries[i].pcm == NULL;  // Yukleyici su an okuyor
+    if (i >= 0 && s_entries[i].pcm != NULL) {
+        entry = &s_entries[i];
+        entry->refcount++;
+        entry->last_used = ++s_clock;
+        s_stats.hits++;
+    } else {
+        s_stats.misses++;
+    }
+    xSemaphoreGive(s_cacheMutex);
+
+    if (entry == NULL && !loading) {
+        ClipCache_RequestLoad(file_path);
+    }
+    return entry;
+}
+
+
+
+/**
+ * @brief Unpins an entry obtained from ClipCache_Acquire().
+ *
+ * If the file was changed or deleted while the clip was playing, the entry is freed here.
+ *
+ * @param[in] entry Entry returned by ClipCache_Acquire().
+ */
+void ClipCache_Release(const ClipCacheEntry_t *entry)
+{
+    if (entry == NULL || s_cacheMutex == NULL) return;
+
+    xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+    int i = (int)(entry - s_entries);
+    if (i >= 0 && i < CLIP_CACHE_MAX_ENTRIES && s_entries[i].refcount > 0) {
+        s_entries[i].refcount--;
+        if (s_entries[i].refcount == 0 && s_entries[i].stale) {
+            free_slot_locked(i);
+        }
+    }
+    xSemaphoreGive(s_cacheMutex);
+}
+
+
+
+/**
+ * @brief Queues a background load of a clip that is not tied to the active plan.
+ *
+ * Does not block; if the load queue is full the request is dropped and the clip keeps streaming from SD.
+ * A clip that is already waiting in the queue is not queued again, so repeated misses of the same clip
+ * cannot fill the queue; at most CLIP_CACHE_MISS_PENDING such loads wait at a time.
+ *
+ * @param[in] file_path Full path or base name of the clip.
+ * @return true if the request was queued or was already pending, false otherwise.
+ */
+bool ClipCache_RequestLoad(const char *file_path)
+{
+    if (s_loadQueue == NULL || file_path == NULL) return false;
+
+    ClipLoadRequest_t req = { .generation = 0 };
+    snprintf(req.name, sizeof(req.name), "%s", base_name(file_path));
+    uint32_t hash = name_hash(req.name);
+
+    int slot = -1;
+    xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+    for (int i = 0; i < CLIP_CACHE_MISS_PENDING; i++) {
+        if (s_missPending[i] == hash) {
+            xSemaphoreGive(s_cacheMutex);
+            return true;  // Zaten kuyrukta
+        }
+        if (slot < 0 && s_missPending[i] == 0) slot = i;
+    }
+    if (slot >= 0) s_missPending[slot] = hash;
+    xSemaphoreGive(s_cacheMutex);
+    if (slot < 0) return false;
+
+    if (xQueueSend(s_loadQueue, &req, 0) == pdTRUE) return true;
+
+    xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+    s_missPending[slot] = 0;
+    xSemaphoreGive(s_cacheMutex);
+    return false;
+}
+
+
+
+/**
+ * @brief Drops a clip from the cache after its file was replaced or deleted.
+ *
+ * An entry that is currently playing is marked stale and freed when it is released.
+ *
+ * @param[in] file_path Full path or base name of the clip.
+ */
+void ClipCache_Invalidate(const char *file_path)
+{
+    if (s_cacheMutex == NULL || file_path == NULL) return;
+
+    xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+    int i = find_locked(base_name(file_path));
+    if (i >= 0) {
+        if (s_entries[i].refcount == 0) {
+            free_slot_locked(i);
+        } else {
+            s_entries[i].stale = true;
+        }
+    }
+    xSemaphoreGive(s_cacheMutex);
+
+    // Aktif plan bu klibi istiyorsa yeni icerigi yeniden yuklet
+    s_planSignature = 0;
+}
+
+
+
+/* Plan klip listesine bir isim ekler; "-" ve bos isimler atlanir */
+static uint32_t add_wanted(ClipLoadRequest_t *list, int *count, int max, const char *name, uint32_t hash)
+{
+    if (name == NULL || name[0] == '\0' || strcmp(name, "-") == 0 || *count >= max) return hash;
+    snprintf(list[*count].name, sizeof(list[*count].name), "%s", base_name(name));
+    (*count)++;
+    for (const char *p = name; *p; p++) {   // FNV-1a
+        hash ^= (uint8_t)*p;
+        hash *= 16777619u;
+    }
+    return hash * 31u + (uint32_t)*count;
+}
+
+
+
+/**
+ * @brief Queues the clips needed by the active configuration for preloading.
+ *
+ * Called every time GetCurrentConfiguration() runs (once per second from the 1 s timer). The clip list
+ * is summarised in a hash, so nothing happens unless the plan or the audio configuration actually changed.
+ * Clips are queued in priority order: idle sound, green countdown numbers, request sounds, green sounds.
+ * The function never blocks, so it is safe to call from the timer service task.
+ */
+void ClipCache_PreloadConfiguration(void)
+{
+    if (s_loadQueue == NULL) return;
+
+    ClipLoadRequest_t list[CLIP_CACHE_LOAD_QUEUE_LEN];
+    int count = 0;
+    uint32_t hash = 2166136261u;
+
+    if (CurrentConfiguration.isIdleActive) {
+        hash = add_wanted(list, &count, CLIP_CACHE_LOAD_QUEUE_LEN, CurrentConfiguration.idleSound, hash);
+    }
+    if (CurrentConfiguration.isGreenActive) {
+        int from = CurrentConfiguration.greenCountFrom;
+        int to = CurrentConfiguration.greenCountTo < 1 ? 1 : CurrentConfiguration.greenCountTo;
+        if (from > 30) from = 30;
+        for (int n = from; n >= to; n--) {
+            hash = add_wanted(list, &count, CLIP_CACHE_LOAD_QUEUE_LEN, get_audio_file_path((uint32_t)n), hash);
+        }
+    }
+    if (CurrentConfiguration.isReqActive) {
+        hash = add_wanted(list, &count, CLIP_CACHE_LOAD_QUEUE_LEN, CurrentConfiguration.reqSound1, hash);
+        hash = add_wanted(list, &count, CLIP_CACHE_LOAD_QUEUE_LEN, CurrentConfiguration.reqSound2, hash);
+    }
+    if (CurrentConfiguration.isGreenActive) {
+        hash = add_wanted(list, &count, CLIP_CACHE_LOAD_QUEUE_LEN, CurrentConfiguration.greenSound, hash);
+        hash = add_wanted(list, &count, CLIP_CACHE_LOAD_QUEUE_LEN, CurrentConfiguration.greenAction, hash);
+    }
+
+    if (hash == s_planSignature) return;
+
+    uint32_t generation = s_generation + 1;
+    s_generation = generation;  // Onceki planin klipleri artik tahliye edilebilir
+    s_planSignature = hash;
+
+    for (int i = 0; i < count; i++) {
+        list[i].generation = generation;
+        if (xQueueSend(s_loadQueue, &list[i], 0) != pdTRUE) {
+            s_planSignature = 0;  // Kuyruk dolu, bir sonraki cagrida tekrar dene
+            break;
+        }
+    }
+    ESP_LOGI(TAG_CACHE, "Plan klipleri on yukleme kuyrugunda: %d", count);
+}
+
+
+
+/**
+ * @brief Copies the cache counters.
+ *
+ * @param[out] out Pointer to a structure receiving the statistics.
+ */
+void ClipCache_GetStats(ClipCacheStats_t *out)
+{
+    if (out == NULL || s_cacheMutex == NULL) return;
+    xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_cacheMutex);
+}
+
+
+
+/**
+ * @brief Low priority task that reads queued clips from SD into RAM.
+ *
+ * A slot is reserved under the lock first (pinned with refcount 1 and no data, so it is neither played nor
+ * evicted), then the data chunk is read without holding the lock so playback is never blocked by SD I/O.
+ * IMA-ADPCM clips are kept compressed, so they take a quarter of the budget of the same clip in PCM.
+ * Loads fail cleanly, leaving the clip to be streamed, when the clip is neither PCM nor IMA-ADPCM, exceeds
+ * CLIP_CACHE_MAX_CLIP_BYTES, does not fit in the budget, or would leave less than CLIP_CACHE_MIN_FREE_HEAP.
+ *
+ * @param[in] pvParameters Pointer to task parameters (unused).
+ */
+static void ClipCache_LoaderTask(void *pvParameters)
+{
+    ClipLoadRequest_t req;
+    WavInfo_t info;
+    char path[WAV_INDEX_NAME_LEN + sizeof(MOUNT_POINT) + 1];
+
+    while (1) {
+        xQueueReceive(s_loadQueue, &req, portMAX_DELAY);
+
+        // Plan bu arada degistiyse eski planin on yuklemesini atla
+        if (req.generation != 0 && req.generation != s_generation) continue;
+
+        xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+        if (req.generation == 0) {
+            // Kuyruktan cikti; bundan sonra rezerve slot (pcm == NULL) tekrar istegi engeller
+            uint32_t hash = name_hash(req.name);
+            for (int i = 0; i < CLIP_CACHE_MISS_PENDING; i++) {
+                if (s_missPending[i] == hash) { s_missPending[i] = 0; break; }
+            }
+        }
+        int existing = find_locked(req.name);
+        if (existing >= 0) {
+            if (req.generation != 0) s_entries[existing].generation = req.generation;
+            xSemaphoreGive(s_cacheMutex);
+            continue;
+        }
+        xSemaphoreGive(s_cacheMutex);
+
+        if (!WavIndex_Lookup(req.name, &info) || (info.audio_format != WAV_FORMAT_PCM && info.audio_format != WAV_FORMAT_IMA_ADPCM) ||
+            info.data_length == 0 || info.data_length > CLIP_CACHE_MAX_CLIP_BYTES) {
+            continue;  // Onbelleklenemez, SD'den akitilir
+        }
+
+        xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+        int slot = make_room_locked(info.data_length);
+        if (slot >= 0) {
+            ClipCacheEntry_t *e = &s_entries[slot];
+            snprintf(e->name, sizeof(e->name), "%s", req.name);
+            e->len = info.data_length;
+            e->sample_rate = info.sample_rate;
+            e->bits_per_sample = info.bits_per_sample;
+            e->num_channels = info.num_channels;
+            e->audio_format = info.audio_format;
+            e->block_align = info.block_align;
+            e->generation = req.generation;
+            e->refcount = 1;  // Yukleme suresince rezerve
+            s_stats.bytes_used += e->len;
+            s_stats.entries++;
+        } else {
+            s_stats.load_failures++;
+        }
+        xSemaphoreGive(s_cacheMutex);
+
+        if (slot < 0) {
+            ESP_LOGW(TAG_CACHE, "Butce dolu, %s SD'den calinacak", req.name);
+            continue;
+        }
+
+        uint8_t *pcm = NULL;
+        if (heap_caps_get_free_size(MALLOC_CAP_8BIT) >= (size_t)info.data_length + CLIP_CACHE_MIN_FREE_HEAP) {
+            pcm = (uint8_t *)malloc(info.data_length);
+        }
+        if (pcm != NULL) {
+            snprintf(path, sizeof(path), "%s/%s", MOUNT_POINT, req.name);
+            FILE *f = fopen(path, "rb");
+            bool ok = f != NULL && fseek(f, (long)info.data_offset, SEEK_SET) == 0 &&
+                      fread(pcm, 1, info.data_length, f) == info.data_length;
+            if (f) fclose(f);
+            if (!ok) {
+                free(pcm);
+                pcm = NULL;
+            }
+        }
+
+        xSemaphoreTake(s_cacheMutex, portMAX_DELAY);
+        ClipCacheEntry_t *e = &s_entries[slot];
+        e->pcm = pcm;
+        e->refcount = 0;
+        e->last_used = ++s_clock;
+        bool kept = pcm != NULL && !e->stale;
+        if (kept) {
+            s_stats.loads++;
+        } else {
+            free_slot_locked(slot);
+            s_stats.load_failures++;
+        }
+        xSemaphoreGive(s_cacheMutex);
+
+        if (!kept) {
+            ESP_LOGW(TAG_CACHE, "Yuklenemedi (heap/okuma): %s", req.name);
+        } else {
+            ESP_LOGI(TAG_CACHE, "Yuklendi: %s (%" PRIu32 " byte, toplam %" PRIu32 ")",
+                     req.name, info.data_length, s_stats.bytes_used);
+        }
+    }
+}
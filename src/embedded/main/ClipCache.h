@@ -0,0 +1,75 @@
+/*
+ * ClipCache.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_CLIPCACHE_H_
+#define MAIN_CLIPCACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "WavIndex.h"
+
+// Onbellekte ayni anda tutulabilecek klip sayisi
+#ifndef CLIP_CACHE_MAX_ENTRIES
+#define CLIP_CACHE_MAX_ENTRIES      16
+#endif
+
+// Onbellegin kullanabilecegi toplam heap (byte). PSRAM yok, bu tavan asilmaz.
+#ifndef CLIP_CACHE_BUDGET_BYTES
+#define CLIP_CACHE_BUDGET_BYTES     (64 * 1024)
+#endif
+
+// Tek bir klip bu boyuttan buyukse onbelleklenmez, SD'den akitilir
+#ifndef CLIP_CACHE_MAX_CLIP_BYTES
+#define CLIP_CACHE_MAX_CLIP_BYTES   (32 * 1024)
+#endif
+
+// Yukleme sonrasi en az bu kadar bos heap kalmali (WiFi/mongoose icin)
+#ifndef CLIP_CACHE_MIN_FREE_HEAP
+#define CLIP_CACHE_MIN_FREE_HEAP    (64 * 1024)
+#endif
+
+#define CLIP_CACHE_LOAD_QUEUE_LEN   40
+#define CLIP_CACHE_MISS_PENDING     8   // Kuyrukta ayni anda bekleyebilecek, iskalamadan gelen yukleme sayisi
+#define CLIP_CACHE_TASK_STACK       (1024 * 3)
+#define CLIP_CACHE_TASK_PRIORITY    2   // PlayWav_Task (3) altinda, Process_Thread (1) ustunde
+
+typedef struct {
+    char      name[WAV_INDEX_NAME_LEN]; // Dosya adi (yol olmadan), bos ise slot kullanilmiyor
+    uint8_t  *pcm;              // "data" chunk icerigi, olceklenmemis (PCM veya IMA-ADPCM)
+    uint32_t  len;              // pcm boyutu (byte)
+    uint32_t  sample_rate;
+    uint16_t  bits_per_sample;
+    uint16_t  num_channels;
+    uint16_t  audio_format;     // WAV_FORMAT_PCM veya WAV_FORMAT_IMA_ADPCM
+    uint16_t  block_align;
+    uint32_t  last_used;        // LRU sayaci
+    uint32_t  generation;       // Aktif planin istedigi nesil ile esitse tahliye edilmez
+    uint16_t  refcount;         // Calan okuyucu sayisi, 0 degilse serbest birakilmaz
+    bool      stale;            // Dosya degisti/silindi, son okuyucu birakinca silinir
+} ClipCacheEntry_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t loads;
+    uint32_t load_failures;   // Butce/heap yetersiz veya okuma hatasi (klip SD'den akitilir)
+    uint32_t evictions;
+    uint32_t bytes_used;
+    uint32_t entries;
+} ClipCacheStats_t;
+
+esp_err_t ClipCache_Init(void);
+const ClipCacheEntry_t *ClipCache_Acquire(const char *file_path);
+void ClipCache_Release(const ClipCacheEntry_t *entry);
+bool ClipCache_RequestLoad(const char *file_path);
+void ClipCache_Invalidate(const char *file_path);
+void ClipCache_PreloadConfiguration(void);
+void ClipCache_GetStats(ClipCacheStats_t *out);
+
+#endif /* MAIN_CLIPCACHE_H_ */
@@ -0,0 +1,219 @@
+/*
+ * CycleModel.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Learns the green and red durations of the signal per plan slot and predicts the countdown.
+ *
+ * Every completed green or red measurement of TrackInputRequest is recorded in the 15 minute slot it ended
+ * in, the same 96 slot key as the day plans of Plan.c. Each slot keeps an EWMA of the duration and of its
+ * absolute deviation, so a slot follows a plan change within a few cycles. The prediction for a slot comes
+ * with a confidence (0-100) built from the sample count and the spread; a slot without data borrows the
+ * nearest neighbour slot at a lower confidence. This lets the countdown start on the first cycle after boot
+ * instead of waiting for two measurements. The model is kept in NVS and written from FlashWrite_task only
+ * after CYCLE_MODEL_SAVE_EVERY new observations or CYCLE_MODEL_SAVE_MS, to limit flash wear.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "CycleModel.h"
+#include "FlashConfig.h"
+#include "SystemTime.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+#define CYCLE_MODEL_VERSION     1
+#define CYCLE_MODEL_FULL_COUNT  (1u << CYCLE_MODEL_EWMA_SHIFT)  // Bu kadar ornekte sayi katkisi tamdir
+#define CYCLE_MODEL_MAX_COUNT   0xFFFF
+
+typedef struct {
+    uint16_t version;
+    uint16_t slots;
+    CycleSlot_t slot[CYCLE_LAMP_COUNT][CYCLE_MODEL_SLOTS];
+} CycleModelBlob_t;
+
+static const char *TAG_CYCLE = "CYCLE_MODEL";
+
+static CycleModelBlob_t s_model;
+static volatile uint16_t s_dirty;       // Son kayittan beri yeni gozlem sayisi
+static int64_t s_lastSaveUs;
+
+
+
+/* Bos modeli hazirlar */
+static void reset_model(void)
+{
+    memset(&s_model, 0, sizeof(s_model));
+    s_model.version = CYCLE_MODEL_VERSION;
+    s_model.slots = CYCLE_MODEL_SLOTS;
+}
+
+/* Sayi ve sapmadan guven degeri (0-100) */
+static uint8_t slot_confidence(const CycleSlot_t *s)
+{
+    if (s->count == 0 || s->mean_ms == 0) return 0;
+    uint32_t count_part = (s->count >= CYCLE_MODEL_FULL_COUNT) ? 100 : (s->count * 100u) / CYCLE_MODEL_FULL_COUNT;
+    uint32_t spread = (uint32_t)(((uint64_t)s->dev_ms * 200u) / s->mean_ms);  // Sapma yuzdesinin iki kati
+    uint32_t consistency = (spread >= 100) ? 0 : 100 - spread;
+    return (uint8_t)((count_part * consistency) / 100);
+}
+
+
+
+/**
+ * @brief      Loads the learned cycle model from flash.
+ *
+ * @return     ESP_OK when a stored model was loaded, otherwise the readFlash error; the model then starts empty.
+ *
+ * @details
+ * A blob with another version or slot count is ignored. Must be called after FlashInit().
+ */
+esp_err_t CycleModel_Init(void)
+{
+    size_t length = sizeof(s_model);
+    esp_err_t err = readFlash(FLASH_CYCLE_MODEL_KEY, &s_model, &length);
+
+    if (err != ESP_OK || length != sizeof(s_model) ||
+        s_model.version != CYCLE_MODEL_VERSION || s_model.slots != CYCLE_MODEL_SLOTS) {
+        reset_model();
+        ESP_LOGI(TAG_CYCLE, "Kayitli model yok, bos baslatildi");
+        if (err == ESP_OK) err = ESP_ERR_INVALID_VERSION;
+    } else {
+        ESP_LOGI(TAG_CYCLE, "Model yuklendi");
+    }
+
+    s_dirty = 0;
+    s_lastSaveUs = esp_timer_get_time();
+    return err;
+}
+
+
+
+/**
+ * @brief      Returns the plan slot of the current device time.
+ *
+ * @return     Slot index 0-95, computed as in GetCurrentPlan().
+ */
+uint8_t CycleModel_CurrentSlot(void)
+{
+    uint32_t index = ((uint32_t)DeviceTime.hours * 60 + DeviceTime.minutes) / CYCLE_MODEL_SLOT_MIN;
+    return (index < CYCLE_MODEL_SLOTS) ? (uint8_t)index : 0;
+}
+
+
+
+/**
+ * @brief      Records a measured green or red duration in a plan slot.
+ *
+ * @param[in]  lamp         Lamp the duration belongs to.
+ * @param[in]  slot         Plan slot of the measurement (0-95).
+ * @param[in]  duration_ms  Measured duration in milliseconds; 0 is ignored.
+ *
+ * @details
+ * The first CYCLE_MODEL_FULL_COUNT samples are averaged arithmetically so a new slot converges fast;
+ * after that the mean and the absolute deviation follow an EWMA of weight 1/2^CYCLE_MODEL_EWMA_SHIFT.
+ * Called from IO_Task.
+ */
+void CycleModel_Observe(CycleLamp_t lamp, uint8_t slot, uint32_t duration_ms)
+{
+    if (lamp >= CYCLE_LAMP_COUNT || slot >= CYCLE_MODEL_SLOTS || duration_ms == 0) return;
+
+    CycleSlot_t *s = &s_model.slot[lamp][slot];
+    if (s->count == 0) {
+        s->mean_ms = duration_ms;
+        s->dev_ms = 0;
+    } else {
+        uint32_t n = (s->count < CYCLE_MODEL_FULL_COUNT) ? (uint32_t)s->count + 1 : CYCLE_MODEL_FULL_COUNT;
+        int64_t err = (int64_t)duration_ms - s->mean_ms;
+        uint32_t abs_err = (uint32_t)(err < 0 ? -err : err);
+        s->mean_ms = (uint32_t)((int64_t)s->mean_ms + err / (int64_t)n);
+        s->dev_ms = (uint32_t)((int64_t)s->dev_ms + ((int64_t)abs_err - s->dev_ms) / (int64_t)n);
+    }
+    if (s->count < CYCLE_MODEL_MAX_COUNT) s->count++;
+    s_dirty++;
+
+    ESP_LOGI(TAG_CYCLE, "%s dilim %u: %lu ms -> ort %lu ms, sapma %lu ms, guven %u",
+             lamp == CYCLE_LAMP_GREEN ? "Yesil" : "Kirmizi", slot, (unsigned long)duration_ms,
+             (unsigned long)s->mean_ms, (unsigned long)s->dev_ms, slot_confidence(s));
+}
+
+
+
+/**
+ * @brief      Predicts the countdown of a lamp for a plan slot.
+ *
+ * @param[in]  lamp         Lamp to predict.
+ * @param[in]  slot         Plan slot (0-95).
+ * @param[out] countdown_s  Predicted duration in seconds, truncated like the measured countdown.
+ * @param[out] confidence   Confidence of the prediction, 0-100.
+ * @return     true if the slot or one of its neighbours has data, false otherwise.
+ *
+ * @details
+ * When the slot itself is empty, the nearest slot within CYCLE_MODEL_NEIGHBOUR_SLOTS (wrapping around
+ * midnight) is used and the confidence drops by 10 per slot of distance.
+ */
+bool CycleModel_Predict(CycleLamp_t lamp, uint8_t slot, uint32_t *countdown_s, uint8_t *confidence)
+{
+    if (lamp >= CYCLE_LAMP_COUNT || slot >= CYCLE_MODEL_SLOTS) return false;
+
+    for (int dist = 0; dist <= CYCLE_MODEL_NEIGHBOUR_SLOTS; dist++) {
+        for (int dir = -1; dir <= 1; dir += 2) {
+            int idx = ((int)slot + dir * dist + CYCLE_MODEL_SLOTS) % CYCLE_MODEL_SLOTS;
+            const CycleSlot_t *s = &s_model.slot[lamp][idx];
+            if (s->count == 0) {
+                if (dist == 0) break;  // Ayni dilim iki kez denenmesin
+                continue;
+            }
+            int conf = (int)slot_confidence(s) - 10 * dist;
+            *countdown_s = s->mean_ms / 1000;
+            *confidence = (uint8_t)(conf < 0 ? 0 : conf);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+/**
+ * @brief      Tells whether the model has unsaved observations worth a flash write.
+ *
+ * @return     true after CYCLE_MODEL_SAVE_EVERY new observations, or after CYCLE_MODEL_SAVE_MS with any.
+ */
+bool CycleModel_SaveDue(void)
+{
+    if (s_dirty == 0) return false;
+    if (s_dirty >= CYCLE_MODEL_SAVE_EVERY) return true;
+    return (esp_timer_get_time() - s_lastSaveUs) >= (int64_t)CYCLE_MODEL_SAVE_MS * 1000;
+}
+
+
+
+/**
+ * @brief      Writes the model to flash.
+ *
+ * @return     Result of writeFlash().
+ *
+ * @details
+ * Called from FlashWrite_task. A record updated by IO_Task during the write is at worst stored half old,
+ * which the next observation of that slot corrects.
+ */
+esp_err_t CycleModel_Save(void)
+{
+    uint16_t saved = s_dirty;
+    esp_err_t err = writeFlash(FLASH_CYCLE_MODEL_KEY, &s_model, sizeof(s_model));
+
+    s_lastSaveUs = esp_timer_get_time();
+    if (err == ESP_OK) {
+        s_dirty -= saved;
+        ESP_LOGI(TAG_CYCLE, "Model kaydedildi (%u yeni gozlem)", saved);
+    } else {
+        ESP_LOGE(TAG_CYCLE, "Model kaydedilemedi: %s", esp_err_to_name(err));
+    }
+    return err;
+}
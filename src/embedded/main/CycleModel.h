@@ -0,0 +1,64 @@
+/*
+ * CycleModel.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_CYCLEMODEL_H_
+#define MAIN_CYCLEMODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Gun planlariyla ayni anahtar: 15 dakikalik 96 dilim
+#define CYCLE_MODEL_SLOTS           96
+#define CYCLE_MODEL_SLOT_MIN        15
+
+// Ortalama ve sapma icin EWMA agirligi 1/2^SHIFT; ilk orneklerde aritmetik ortalama kullanilir
+#ifndef CYCLE_MODEL_EWMA_SHIFT
+#define CYCLE_MODEL_EWMA_SHIFT      2
+#endif
+
+// Tahmin bu guvenin altindaysa geri sayim ilk olcumu bekler (0-100)
+#ifndef CYCLE_MODEL_MIN_CONFIDENCE
+#define CYCLE_MODEL_MIN_CONFIDENCE  60
+#endif
+
+// Dilimde veri yoksa bakilan komsu dilim sayisi (her yone)
+#ifndef CYCLE_MODEL_NEIGHBOUR_SLOTS
+#define CYCLE_MODEL_NEIGHBOUR_SLOTS 2
+#endif
+
+// Flash yazma sikligi: bu kadar yeni gozlem ya da bu sure (kirli modelde)
+#ifndef CYCLE_MODEL_SAVE_EVERY
+#define CYCLE_MODEL_SAVE_EVERY      16
+#endif
+#ifndef CYCLE_MODEL_SAVE_MS
+#define CYCLE_MODEL_SAVE_MS         (30 * 60 * 1000)
+#endif
+
+#define FLASH_CYCLE_MODEL_KEY       "cycle_model"
+
+typedef enum {
+    CYCLE_LAMP_GREEN = 0,
+    CYCLE_LAMP_RED,
+    CYCLE_LAMP_COUNT
+} CycleLamp_t;
+
+typedef struct {
+    uint32_t mean_ms;       // Olculen surenin EWMA ortalamasi
+    uint32_t dev_ms;        // Ortalamadan mutlak sapmanin EWMA'si
+    uint16_t count;         // Dilimdeki gozlem sayisi (doygun)
+    uint16_t reserved;
+} CycleSlot_t;
+
+esp_err_t CycleModel_Init(void);
+uint8_t CycleModel_CurrentSlot(void);
+void CycleModel_Observe(CycleLamp_t lamp, uint8_t slot, uint32_t duration_ms);
+bool CycleModel_Predict(CycleLamp_t lamp, uint8_t slot, uint32_t *countdown_s, uint8_t *confidence);
+bool CycleModel_SaveDue(void);
+esp_err_t CycleModel_Save(void);
+
+#endif /* MAIN_CYCLEMODEL_H_ */
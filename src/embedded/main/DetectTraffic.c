@@ -7,7 +7,8 @@
  * @brief Provides API functions to detect, debounce, and track traffic signal inputs and pedestrian requests.
  *
  * This module manages the detection and debouncing of various traffic-related inputs (signal feedback, pedestrian demand, etc.).
- * It provides safe input sampling with majority voting, state tracking, timing analysis, and specialized event handling for traffic systems.
+ * Input edges are captured by GPIO interrupts with microsecond timestamps (GpioEdge) and debounced in task context,
+ * followed by state tracking, timing analysis, and specialized event handling for traffic systems.
  * All key operations for interacting with traffic input data are implemented here.
  *
  * @company    INTETRA
@@ -19,17 +20,24 @@
 #include "main.h"
 #include "DetectTraffic.h"
 #include "Alarms.h"
+#include "CycleModel.h"
+#include "GpioEdge.h"
+#include "TraceLog.h"
+#include "esp_timer.h"
+#include "hal/gpio_ll.h"
 
 
 uint32_t PedestrianFeedback_StuckLowTimeout_min = 1; //14400;  // hiç basılmazsa
 uint32_t PedestrianFeedback_StuckHighTimeout_min = 1;  // sürekli basılıysa
 extern bool hasRequestPlayedOnce;
 
+// TrackInputRequest gunlugu; tekrar oynatmada (replay) UART'a yazilmaz
+#define TRACK_LOG(input, ...) do { if (!(input)->replay) printf(__VA_ARGS__); } while (0)
+
 
 
 InputDebounce_t green_input = {
     .pin = Green_FB_Input_Pin,
-    .level_flags = {false, false, false},
     .confirmed_flag = false,
     .timestamp = 0,
     .label = "Green",
@@ -44,7 +52,6 @@ InputDebounce_t green_input = {
 
 InputDebounce_t red_input = {
     .pin = Red_FB_Input_Pin,
-    .level_flags = {false, false, false},
     .confirmed_flag = false,
     .timestamp = 0,
     .label = "Red",
@@ -79,23 +86,85 @@ InputDebounce_t User_button_input = {
     .label = "user_input"
 };
 
+// Titresim motorunun kanal tablosu. Yeni giris: bir InputDebounce_t ve buraya bir satir.
+static const InputChannel_t s_channels[] = {
+    { &green_input,       Green_FB_Input_Pin,  false, INPUT_LAMP_DEBOUNCE_US },
+    { &red_input,         Red_FB_Input_Pin,    false, INPUT_LAMP_DEBOUNCE_US },
+    { &Demand_input,      Demand_Input_Pin,    false, INPUT_DEBOUNCE_US },
+    { &No_demand_input,   No_Demand_Input_Pin, false, INPUT_DEBOUNCE_US },
+    { &User_button_input, Button_Input_Pin,    false, INPUT_DEBOUNCE_US },
+};
+
+#define CHANNEL_COUNT (sizeof(s_channels) / sizeof(s_channels[0]))
+
+
+
+/* Girisin dongu modelindeki lambasi */
+static inline CycleLamp_t input_lamp(const InputDebounce_t *input)
+{
+    return (input == &red_input) ? CYCLE_LAMP_RED : CYCLE_LAMP_GREEN;
+}
+
+/* Tablodaki tum kanallarin pin maskesi */
+static uint64_t channel_pin_mask(void)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < CHANNEL_COUNT; i++) {
+        mask |= 1ULL << s_channels[i].pin;
+    }
+    return mask;
+}
+
+/* GPIO0-39 seviyelerini tek seferde okur (GPIO.in ve GPIO.in1) */
+static inline uint64_t read_all_levels(void)
+{
+    return (uint64_t)GPIO.in | ((uint64_t)GPIO.in1.data << 32);
+}
+
+/* Kanalin aktif seviyesi: polarite uygulanmis pin degeri */
+static inline bool channel_level(const InputChannel_t *ch, uint64_t levels)
+{
+    return (((levels >> ch->pin) & 1ULL) != 0) != ch->active_low;
+}
+
+/* Aktif seviyeyi girise isler; seviye degistiyse sabit kalma suresi yeniden baslar */
+static void feed_level(InputDebounce_t *input, bool level, int64_t time_us)
+{
+    if (level == input->raw_level) return;  // Sicrama sonrasi ayni seviye, yeni kenar degil
+    input->raw_level = level;
+    input->raw_edge_us = time_us;
+}
+
+/* Kanal penceresi boyunca sabit kalan seviyeyi onaylar; onay bekleniyorsa kalan sureyi (us) doner */
+static int64_t settle_level(const InputChannel_t *ch, int64_t now_us)
+{
+    InputDebounce_t *input = ch->input;
+    if (input->raw_level == input->debounced_level) return INT64_MAX;
+    int64_t left = input->raw_edge_us + (int64_t)ch->debounce_us - now_us;
+    if (left > 0) return left;
+    input->debounced_level = input->raw_level;
+    input->timestamp = input->raw_edge_us;  // Gecis zamani ilk kenarin zamanidir
+    return INT64_MAX;
+}
+
 
 
 /**
  * @brief      Initializes the GPIO pins for input usage.
  *
  * @details
- * Configures the specified GPIO pins as inputs without pull-up or pull-down resistors and disables interrupts.
- * The pins are set using a bit mask for Red_FB_Input_Pin, Green_FB_Input_Pin, Demand_Input_Pin, No_Demand_Input_Pin, and Button_Input_Pin.
+ * Configures the specified GPIO pins as inputs without pull-up or pull-down resistors. Interrupts stay disabled here;
+ * GPIO_EdgeCaptureInit() enables both-edge interrupts once the input state is initialised.
+ * The pins are taken from the debounce channel table.
  * Modify the pull-up or pull-down settings as needed for your hardware requirements.
  */
 void GPIO_Init(void)
 {
 	 // GPIO konfigürasyonu
     gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_DISABLE,         // Interrupt kullanılmıyor
+        .intr_type = GPIO_INTR_DISABLE,         // Kesmeler GPIO_EdgeCaptureInit ile acilir
         .mode = GPIO_MODE_INPUT,                // Sadece giriş modu
-        .pin_bit_mask = (1ULL << Red_FB_Input_Pin) | (1ULL << Green_FB_Input_Pin) | (1ULL << Demand_Input_Pin)  | (1ULL << No_Demand_Input_Pin)| (1ULL << Button_Input_Pin),
+        .pin_bit_mask = channel_pin_mask(),
         .pull_down_en = GPIO_PULLDOWN_DISABLE,  // Pull-down yok
         .pull_up_en = GPIO_PULLUP_DISABLE       // Pull-up yok (gerekiyorsa ENABLE yap)
     };
@@ -103,49 +172,84 @@ void GPIO_Init(void)
 }
 
 
+
+/**
+ * @brief      Starts interrupt-driven edge capture on the input pins.
+ *
+ * @details
+ * Takes the current pin levels as the initial debounced state and enables both-edge interrupts on every
+ * channel of the table. Must be called after GPIO_Init() and ResetAllTrafficVariables().
+ */
+void GPIO_EdgeCaptureInit(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint64_t levels = read_all_levels();
+    for (size_t i = 0; i < CHANNEL_COUNT; i++) {
+        InputDebounce_t *input = s_channels[i].input;
+        input->raw_level = input->debounced_level = channel_level(&s_channels[i], levels);
+        input->raw_edge_us = input->timestamp = now_us;
+    }
+    GpioEdge_Init(channel_pin_mask());
+}
+
+
+
+/**
+ * @brief      Runs the debounce engine over every channel of the table.
+ *
+ * @details
+ * Captured edges are applied first, with their interrupt timestamps. Then all pins are read in one register
+ * access and any level the interrupts missed (ring overflow, edge while the ring was drained) is applied at
+ * the current time. A channel level is confirmed once it has been stable for the debounce window of the
+ * channel; the confirmed transition keeps the timestamp of its first edge. The cost per call is one
+ * register read and one pass over the table. Called from IO_Task only.
+ *
+ * @return     Milliseconds until the next pending confirmation, UINT32_MAX if none is pending.
+ */
+uint32_t ProcessInputEdges(void)
+{
+    GpioEdge_t edge;
+
+    while (GpioEdge_Pop(&edge)) {
+        for (size_t i = 0; i < CHANNEL_COUNT; i++) {
+            if (s_channels[i].pin == edge.pin) {
+                feed_level(s_channels[i].input, (edge.level != 0) != s_channels[i].active_low, edge.time_us);
+                break;
+            }
+        }
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    uint64_t levels = read_all_levels();
+    int64_t next_us = INT64_MAX;
+    for (size_t i = 0; i < CHANNEL_COUNT; i++) {
+        const InputChannel_t *ch = &s_channels[i];
+        feed_level(ch->input, channel_level(ch, levels), now_us);
+        int64_t left = settle_level(ch, now_us);
+        if (left < next_us) next_us = left;
+    }
+    return (next_us == INT64_MAX) ? UINT32_MAX : (uint32_t)((next_us + 999) / 1000);
+}
+
+
  
  /**
- * @brief      Detects and debounces the feedback signal from a GPIO input.
+ * @brief      Publishes the debounced level of an input as its confirmed state.
  *
- * @param[in,out] input Pointer to an InputDebounce_t structure containing pin information, label, and sample flags.
+ * @param[in,out] input Pointer to an InputDebounce_t structure updated by ProcessInputEdges().
  *
  * @details
- * This function reads the raw state of the specified GPIO pin and updates a rolling window of the last three sampled states
- * in the input structure. It prints debug information showing previous and new samples, as well as the majority decision.
- * The majority logic (2 out of 3 samples high) is used to determine the debounced level.
+ * Copies the level confirmed by the debounce engine into confirmed_flag and prints one line when it changes.
+ * Shared by every feedback input, so a new input needs no function of its own.
  */
 void DetectFeedBack(InputDebounce_t* input) 
 {
-    // Ham GPIO değerini oku
-    int raw_level = gpio_get_level(input->pin);
-    
-    // Debug: Ham değeri yazdır
-    printf("[%s] RAW GPIO VALUE: %d\n", input->label, raw_level);
-    
-    // Örnekleme dizisini kaydır
-    bool prev_samples[3] = {
-        input->level_flags[0],
-        input->level_flags[1], 
-        input->level_flags[2]
-    };
-    
-    input->level_flags[0] = input->level_flags[1];
-    input->level_flags[1] = input->level_flags[2];
-    input->level_flags[2] = (raw_level == 1);
-
-    // Debug: Önceki ve yeni örnekleri yazdır
-    printf("[%s] ONCEKI ORNEKLER: %d-%d-%d\n", 
-           input->label, prev_samples[0], prev_samples[1], prev_samples[2]);
-    printf("[%s] YENI ORNEKLER: %d-%d-%d\n", 
-           input->label, input->level_flags[0], input->level_flags[1], input->level_flags[2]);
-
-    // Çoğunluk seviyesini hesapla
-    int high_count = input->level_flags[0] + input->level_flags[1] + input->level_flags[2];
-    bool majority_level = (high_count >= 2);
-    
-    // Debug: Son kararı yazdır
-    printf("[%s] COGUNLUK KARARI: %d (High count: %d)\n", 
-           input->label, majority_level, high_count);
+    if (input->debounced_level != input->confirmed_flag) {
+        input->confirmed_flag = input->debounced_level;
+        printf("[%s] Yeni durum: %s\n", input->label, input->confirmed_flag ? "HIGH" : "LOW");
+        TraceLog_Add(TRACE_EVT_EDGE, input->pin, input->confirmed_flag, input->light_mode,
+                     input->flash_period_ms, input->timestamp);
+    }
 }
 
 
@@ -159,43 +263,69 @@ void DetectFeedBack(InputDebounce_t* input)
  *
  * @details
  * This function detects LOW→HIGH and HIGH→LOW transitions of an input, tracks durations of light and dark periods,
- * recognizes flash patterns, and manages measurement cycles. It supports steady and flash light detection, calculation
+ * using the interrupt timestamp of each confirmed transition (millisecond resolution instead of the IO_Task period).
+ * Whether a pulse belongs to a flash sequence comes from the hardware pulse counter classification (LampPcnt).
+ * It accumulates flash patterns and manages measurement cycles. It supports steady and flash light detection, calculation
  * of countdown timers, and synchronization with device status variables. Debug information is printed for each significant event.
  *
  * - On LOW→HIGH transition, begins measurement after a valid dark period (≥2000ms), updates state, and manages countdown flags.
- * - On HIGH→LOW transition, calculates last light duration, detects flash patterns, accumulates flash/steady times, and updates state.
- * - Ends measurement if the light is off and no transition for >2000ms, then updates countdown values and device status.
+ *   The countdown starts from the CycleModel prediction of the current plan slot when its confidence is at least
+ *   CYCLE_MODEL_MIN_CONFIDENCE, otherwise from the previous measurement once two measurements exist.
+ * - On HIGH→LOW transition, calculates last light duration, applies the PCNT flash classification, accumulates flash/steady times, and updates state.
+ * - Ends measurement if the light is off and no transition for >2000ms, records the duration in CycleModel, then updates countdown values and device status.
+ *
+ * An input marked as replay (TraceReplay) neither prints, nor consults or trains CycleModel, nor writes the trace.
+ *
+ * @param[in]     now   Current time in milliseconds on the esp_timer time base.
  */
-void TrackInputRequest(InputDebounce_t *input) {
-    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+void TrackInputRequestAt(InputDebounce_t *input, uint32_t now) {
+    uint32_t edge = (uint32_t)(input->timestamp / 1000);  // Onaylanan son gecisin kesme zamani
 
     // LOW -> HIGH transition (Light ON)
     if (input->confirmed_flag && !input->last_state) {
-        uint32_t current_dark_duration = now - input->dark_start_time;
+        uint32_t current_dark_duration = edge - input->dark_start_time;
         input->last_dark_duration = current_dark_duration;
 
-        input->light_start_time = now;
-        input->light_mode = LIGHT_ON;
+        input->light_start_time = edge;
 
         // Start measurement only after proper dark period (2000ms)
         if (input->waiting_for_dark && current_dark_duration >= 2000) {
             input->counting = true;
-            input->request_start_time = now;
+            input->request_start_time = edge;
             input->waiting_for_dark = false;
             input->total_flash_time = 0;
             input->total_steady_time = 0;
+            input->pending_flash_time = 0;
+            input->pending_flash_pulses = 0;
 
-            input->measurement_count++;
+            if (input->measurement_count < UINT8_MAX) input->measurement_count++;  // Sarmasin, yoksa geri sayim iki cevrim susar
 
-            if (input->measurement_count >= 2) {
+            // Dilim modeli guvenliyse geri sayim ilk cevrimde de baslar
+            uint32_t predicted_s = 0;
+            uint8_t confidence = 0;
+            bool predicted = !input->replay && CycleModel_Predict(input_lamp(input), CycleModel_CurrentSlot(), &predicted_s, &confidence);
+            input->countdown_confidence = predicted ? confidence : 0;
+
+            uint8_t source;
+            if (predicted && predicted_s > 0 && confidence >= CYCLE_MODEL_MIN_CONFIDENCE) {
+                input->countdown_start = predicted_s;
+                input->countdown_current = predicted_s;
+                input->isCountdown_active = true;
+                source = TRACE_CD_MODEL;
+                TRACK_LOG(input, "[%s] Countdown ACTIVE (model: %"PRIu32"s, guven %u)\n", input->label, predicted_s, confidence);
+            } else if (input->measurement_count >= 2) {
                 input->isCountdown_active = true;
-                printf("[%s] Countdown ACTIVE (since measurement #%u)\n", input->label, input->measurement_count);
+                source = TRACE_CD_MEASURED;
+                TRACK_LOG(input, "[%s] Countdown ACTIVE (since measurement #%u)\n", input->label, input->measurement_count);
             } else {
                 input->isCountdown_active = false;
-                printf("[%s] First measurement, countdown NOT active\n", input->label);
+                source = TRACE_CD_NONE;
+                TRACK_LOG(input, "[%s] First measurement, countdown NOT active\n", input->label);
             }
+            if (!input->replay) TraceLog_Add(TRACE_EVT_COUNTDOWN, input->pin, input->countdown_confidence, source,
+                         input->isCountdown_active ? input->countdown_start : 0, input->timestamp);
 
-            printf("[%s] Measurement STARTED\n", input->label);
+            TRACK_LOG(input, "[%s] Measurement STARTED\n", input->label);
         }
 
         input->last_state = true;
@@ -203,36 +333,51 @@ void TrackInputRequest(InputDebounce_t *input) {
 
     // HIGH -> LOW transition (Light OFF)
     else if (!input->confirmed_flag && input->last_state) {
-        input->last_light_duration = now - input->light_start_time;
-        input->last_light_off_time = now;
-        input->dark_start_time = now;
-
-        input->light_mode = LIGHT_OFF;
+        input->last_light_duration = edge - input->light_start_time;
+        input->last_light_off_time = edge;
+        input->dark_start_time = edge;
 
-        // Flash detection
-        bool is_flash = (input->last_light_duration >= 400 && input->last_light_duration <= 800) &&
-                        (input->last_dark_duration >= 400 && input->last_dark_duration <= 800);
+        // Flash detection: PCNT donanim sayacinin siniflandirmasi (LampPcnt)
+        bool is_flash = (input->light_mode == LIGHT_FLASH);
+        uint32_t pulse = input->last_light_duration + input->last_dark_duration;
 
         if (is_flash) {
             if (!input->flash_mode) {
                 input->flash_mode = true;
-                input->light_mode = LIGHT_FLASH;
-                printf("[%s] Flash sequence STARTED\n", input->label);
+                TRACK_LOG(input, "[%s] Flash sequence STARTED\n", input->label);
             }
 
-            input->total_flash_time += input->last_light_duration + input->last_dark_duration;
-            printf("[%s] Flash added: %"PRIu32"ms (ON) + %"PRIu32"ms (OFF) = %"PRIu32"ms\n",
-                   input->label, input->last_light_duration, input->last_dark_duration,
-                   input->last_light_duration + input->last_dark_duration);
+            // PCNT onayindan once gelen darbeler de flasin parcasi
+            if (input->pending_flash_pulses > 0) {
+                input->total_flash_time += input->pending_flash_time;
+                TRACK_LOG(input, "[%s] Flash confirmed: %u pending pulses = %"PRIu32"ms\n",
+                       input->label, input->pending_flash_pulses, input->pending_flash_time);
+                input->pending_flash_time = 0;
+                input->pending_flash_pulses = 0;
+            }
+            input->total_flash_time += pulse;
+            TRACK_LOG(input, "[%s] Flash added: %"PRIu32"ms (ON) + %"PRIu32"ms (OFF) = %"PRIu32"ms\n",
+                   input->label, input->last_light_duration, input->last_dark_duration, pulse);
+        } else if (input->counting && input->last_light_duration <= 800) {
+            // PCNT penceresi (2-6 s) dolmadan gelen kisa darbe: onay gelene kadar bekletilir
+            input->pending_flash_time += pulse;
+            if (input->pending_flash_pulses < UINT8_MAX) input->pending_flash_pulses++;
+            TRACK_LOG(input, "[%s] Flash pending: %"PRIu32"ms (%u pulses)\n",
+                   input->label, pulse, input->pending_flash_pulses);
         } else {
             if (input->flash_mode) {
-                printf("[%s] Flash sequence ENDED\n", input->label);
+                TRACK_LOG(input, "[%s] Flash sequence ENDED\n", input->label);
                 input->flash_mode = false;
             }
+            if (input->pending_flash_pulses > 0) {
+                TRACK_LOG(input, "[%s] %u pending pulses dropped, no flash\n", input->label, input->pending_flash_pulses);
+                input->pending_flash_time = 0;
+                input->pending_flash_pulses = 0;
+            }
 
             if (input->counting && input->last_light_duration > 800) {
                 input->total_steady_time += input->last_light_duration;
-                printf("[%s] Steady light added: %"PRIu32"ms\n",
+                TRACK_LOG(input, "[%s] Steady light added: %"PRIu32"ms\n",
                        input->label, input->last_light_duration);
             }
         }
@@ -242,11 +387,25 @@ void TrackInputRequest(InputDebounce_t *input) {
 
     // Measurement end condition
     if (input->counting && !input->confirmed_flag && (now - input->last_light_off_time > 2000)) {
+        // PCNT'nin onaylayamayacagi kadar kisa flas: kesme zamanlarindan en az iki kisa darbe yeterli
+        if (input->pending_flash_pulses >= 2) {
+            input->total_flash_time += input->pending_flash_time;
+            TRACK_LOG(input, "[%s] Unconfirmed flash kept: %u pulses = %"PRIu32"ms\n",
+                   input->label, input->pending_flash_pulses, input->pending_flash_time);
+        }
+        input->pending_flash_time = 0;
+        input->pending_flash_pulses = 0;
+
         uint32_t total_duration = input->total_steady_time + input->total_flash_time;
 
-        printf("[%s] Measurement ENDED | Steady: %"PRIu32"ms | Flash: %"PRIu32"ms | Total: %"PRIu32"ms\n",
+        TRACK_LOG(input, "[%s] Measurement ENDED | Steady: %"PRIu32"ms | Flash: %"PRIu32"ms | Total: %"PRIu32"ms\n",
                input->label, input->total_steady_time, input->total_flash_time, total_duration);
 
+        if (!input->replay) {
+            CycleModel_Observe(input_lamp(input), CycleModel_CurrentSlot(), total_duration);
+            TraceLog_Add(TRACE_EVT_MEASURE, input->pin, 0, input->measurement_count, total_duration, 0);
+        }
+
         input->countdown_start = total_duration / 1000;
         input->countdown_current = input->countdown_start;
         
@@ -268,6 +427,58 @@ void TrackInputRequest(InputDebounce_t *input) {
 
 
 
+/**
+ * @brief      Runs TrackInputRequestAt() at the current esp_timer time.
+ *
+ * @param[in,out] input Pointer to the input to track.
+ */
+void TrackInputRequest(InputDebounce_t *input)
+{
+    TrackInputRequestAt(input, (uint32_t)(esp_timer_get_time() / 1000));
+}
+
+
+
+/**
+ * @brief      Advances a green countdown by one second.
+ *
+ * @param[in,out] input Input whose countdown is running (isCountdown_active set).
+ * @param[in,out] cd    Countdown state owned by the caller; zero-initialised before the first tick.
+ * @param[in]     from  First number to announce (greenCountFrom).
+ * @param[in]     to    Number the countdown stops at (greenCountTo).
+ * @return        Number to announce on this tick, 0 while silent or when the countdown ends.
+ *
+ * @details
+ * Starts from countdown_current on the first tick, counts down silently above @p from and announces every
+ * number from @p from down to @p to. When @p to is reached isCountdown_active is cleared and @p cd is reset.
+ * Does no I/O, so the 1 s timer and TraceReplay share it.
+ */
+uint32_t Countdown_Tick(InputDebounce_t *input, Countdown_t *cd, uint32_t from, uint32_t to)
+{
+    // İlk çalışmada başlangıç değerlerini ayarla
+    if (cd->current == 0) {
+        cd->current = input->countdown_current;
+        cd->silent = (cd->current > from);
+    }
+
+    if (cd->current <= to) {
+        // Sayım tamamlandı
+        input->isCountdown_active = false;
+        cd->current = 0;
+        return 0;
+    }
+
+    cd->current--;
+    // Sessiz fazdan konuşma fazına geçiş kontrolü
+    if (cd->silent && cd->current <= from) {
+        cd->silent = false;
+    }
+    input->countdown_current = cd->current;
+    return cd->silent ? 0 : cd->current;
+}
+
+
+
 /**
  * @brief      Initializes the InputDebounce_t structure for an input signal.
  *
@@ -277,19 +488,24 @@ void TrackInputRequest(InputDebounce_t *input) {
  * @details
  * This function clears the entire input structure, assigns the label, resets flags,
  * and configures the system to start in "waiting for dark" mode. All timing and state variables
- * are set to their default values. Debug output is printed to indicate initialization.
+ * are set to their default values. The pin and the replay mark are kept. Debug output is printed
+ * to indicate initialization, except for replay copies.
  */
 void InputDebounce_Init(InputDebounce_t *input, const char* label)
 {
-    // Bütün yapıyı temizle
+    // Bütün yapıyı temizle; pin kanal tanimidir, replay isareti de kopyanin kimligidir, korunur
+    gpio_num_t pin = input->pin;
+    bool replay = input->replay;
     memset(input, 0, sizeof(InputDebounce_t));
     // Başlangıç değerlerini ata
+    input->pin = pin;
+    input->replay = replay;
     input->label = label;
     input->confirmed_flag = false;
     
     // ⭐ ANAHTAR DEĞİŞİKLİK: Sistemin "karanlıkta bekleme" modunda başlamasını sağlıyoruz.
     input->waiting_for_dark = true; 
-    printf("[%s] Init -> dark_start_time = %lu ms\n", input->label, (unsigned long)input->dark_start_time);
+    if (!input->replay) printf("[%s] Init -> dark_start_time = %lu ms\n", input->label, (unsigned long)input->dark_start_time);
 
     // Diğer değişkenleri de sıfırla
     input->request_start_time = 0;
@@ -321,31 +537,12 @@ void ResetAllTrafficVariables(void)
  * @brief      Debounces and detects state changes for the green feedback input signal.
  *
  * @details
- * Reads the raw GPIO level for the green feedback pin, updates the rolling sample buffer for debouncing,
- * uses majority voting (2 out of 3 samples) to determine the new debounced state, and prints a message
- * if the confirmed state changes.
+ * Takes the debounced level of the green feedback pin from the edge capture state machine
+ * (ProcessInputEdges) and prints a message if the confirmed state changes.
  */
 void DetectGreenFeedback(void)
 {
-    // 1. Seviye okuma ve debounce
-    int raw_level = gpio_get_level(Green_FB_Input_Pin);
-    
-    // Örnekleme dizisini güncelle
-    green_input.level_flags[0] = green_input.level_flags[1];
-    green_input.level_flags[1] = green_input.level_flags[2];
-    green_input.level_flags[2] = (raw_level == 1);
-
-    // 2. Çoğunluk kararı
-    int high_count = green_input.level_flags[0] + 
-                    green_input.level_flags[1] + 
-                    green_input.level_flags[2];
-    bool new_state = (high_count >= 2);
-    
-    // 3. Durum değişikliği kontrolü
-    if(new_state != green_input.confirmed_flag) {
-        green_input.confirmed_flag = new_state;
-        printf("[GREEN] Yeni durum: %s\n", new_state ? "HIGH" : "LOW");
-    }
+    DetectFeedBack(&green_input);
 }
 
 
@@ -355,31 +552,12 @@ void DetectGreenFeedback(void)
  * @brief      Debounces and detects state changes for the red feedback input signal.
  *
  * @details
- * Reads the raw GPIO level for the red feedback pin, updates the rolling sample buffer for debouncing,
- * uses majority voting (2 out of 3 samples) to determine the new debounced state, and prints a message
- * if the confirmed state changes.
+ * Takes the debounced level of the red feedback pin from the edge capture state machine
+ * (ProcessInputEdges) and prints a message if the confirmed state changes.
  */
-void DetectRedFeedback(void) 
+void DetectRedFeedback(void)
 {
-    // 1. Seviye okuma ve debounce
-    int raw_level = gpio_get_level(Red_FB_Input_Pin);
-    
-    // Örnekleme dizisini güncelle
-    red_input.level_flags[0] = red_input.level_flags[1];
-    red_input.level_flags[1] = red_input.level_flags[2];
-    red_input.level_flags[2] = (raw_level == 1);
-
-    // 2. Çoğunluk kararı
-    int high_count = red_input.level_flags[0] + 
-                    red_input.level_flags[1] + 
-                    red_input.level_flags[2];
-    bool new_state = (high_count >= 2);
-    
-    // 3. Durum değişikliği kontrolü
-    if(new_state != red_input.confirmed_flag) {
-        red_input.confirmed_flag = new_state;
-        printf("[RED] Yeni durum: %s\n", new_state ? "HIGH" : "LOW");
-    }
+    DetectFeedBack(&red_input);
 }
 
 
@@ -389,53 +567,60 @@ void DetectRedFeedback(void)
  * @brief      Debounces and monitors the pedestrian demand feedback input signal.
  *
  * @details
- * Reads the raw GPIO level for the pedestrian demand pin, updates the rolling sample buffer for debouncing,
- * uses majority voting (2 out of 3 samples) to determine the new debounced state, and initializes or updates the state and timing.
- * Tracks state changes, handles feedback for button requests, and checks for stuck states (HIGH or LOW for too long), logging an alarm if necessary.
- * Updates the device status with the current button state.
+ * Runs DetectPedestrianDemandFeedbackAt() for Demand_input at the current esp_timer time.
  */
 void DetectPedestrianDemandFeedback(void) 
 {
-    // 1. Seviye okuma ve debounce
-    int raw_level = gpio_get_level(Demand_Input_Pin);
+    static DemandTrack_t s_demandTrack;
 
-    // Örnekleme dizisini güncelle
-    Demand_input.level_flags[0] = Demand_input.level_flags[1];
-    Demand_input.level_flags[1] = Demand_input.level_flags[2];
-    Demand_input.level_flags[2] = (raw_level == 1);
+    DetectPedestrianDemandFeedbackAt(&Demand_input, &s_demandTrack, esp_timer_get_time() / 1000);
+}
 
-    // 2. Çoğunluk kararı
-    int high_count = Demand_input.level_flags[0] +
-                     Demand_input.level_flags[1] +
-                     Demand_input.level_flags[2];
-    bool new_state = (high_count >= 2);
 
-    uint64_t now_ms = esp_timer_get_time() / 1000;
 
-    static uint64_t state_start_ms = 0;
-    static bool state_initialized = false;
-    
 
-    if (!state_initialized) {
-        Demand_input.confirmed_flag = new_state;
-        state_start_ms = now_ms;
-        state_initialized = true;
-        printf("[Buton] Baslangic durumu: %s\n", new_state ? "HIGH" : "LOW");
+/**
+ * @brief      Tracks a pedestrian demand input at an explicit time.
+ *
+ * @param[in,out] input  Demand input; debounced_level is the level from the edge capture state machine.
+ * @param[in,out] track  State timer of the input, zero-initialised before the first call.
+ * @param[in]     now_ms Current time in milliseconds on the esp_timer time base.
+ *
+ * @details
+ * The first call takes the current level as the initial state.
+ * Tracks state changes, handles feedback for button requests, and checks for stuck states (HIGH or LOW for too long), logging an alarm if necessary.
+ * Updates the device status with the current button state.
+ * An input marked as replay (TraceReplay) only updates confirmed_flag and @p track: it does not print, write the
+ * trace or the alarm log, touch hasRequestPlayedOnce or the device status.
+ */
+void DetectPedestrianDemandFeedbackAt(InputDebounce_t *input, DemandTrack_t *track, uint64_t now_ms)
+{
+    // 1. Kenar yakalamadan gelen titresimsiz seviye (ProcessInputEdges)
+    bool new_state = input->debounced_level;
+
+    if (!track->initialized) {
+        input->confirmed_flag = new_state;
+        track->state_start_ms = now_ms;
+        track->initialized = true;
+        if (!input->replay) printf("[Buton] Baslangic durumu: %s\n", new_state ? "HIGH" : "LOW");
         return;
     }
     
        // Talep yokken (LOW), yeni bir HIGH durumu tespit edildiğinde
     // hasRequestPlayedOnce'ı false yap.
-    if (!Demand_input.confirmed_flag && new_state) {
+    if (!input->confirmed_flag && new_state && !input->replay) {
         hasRequestPlayedOnce = false;
     }
     
-    if (new_state != Demand_input.confirmed_flag) {
-        Demand_input.confirmed_flag = new_state;
-        state_start_ms = now_ms;
-        printf("[Buton] Yeni durum: %s (timer sifirlandi)\n", new_state ? "HIGH" : "LOW");
+    if (new_state != input->confirmed_flag) {
+        input->confirmed_flag = new_state;
+        track->state_start_ms = now_ms;
+        if (!input->replay) {
+            printf("[Buton] Yeni durum: %s (timer sifirlandi)\n", new_state ? "HIGH" : "LOW");
+            TraceLog_Add(TRACE_EVT_EDGE, input->pin, new_state, input->isDemandActive, 0, input->timestamp);
+        }
     } else {
-        uint64_t elapsed_ms = now_ms - state_start_ms;
+        uint64_t elapsed_ms = now_ms - track->state_start_ms;
 
         uint64_t low_threshold_ms  = (uint64_t)PedestrianFeedback_StuckLowTimeout_min * 60 * 1000;
         uint64_t high_threshold_ms = (uint64_t)PedestrianFeedback_StuckHighTimeout_min * 60 * 1000;
@@ -451,12 +636,13 @@ void DetectPedestrianDemandFeedback(void)
         }
 
         if (should_log_alarm) {
-            Alarm_Log("Pedestrian feedback stuck for too long", &DeviceTime);
-            state_start_ms = now_ms;  // tekrar alarm atmasını önle
+            if (!input->replay) Alarm_Log("Pedestrian feedback stuck for too long", &DeviceTime);
+            track->alarms++;
+            track->state_start_ms = now_ms;  // tekrar alarm atmasını önle
         }
     }
     
-    s_deviceStatus.buttonStatus = Demand_input.confirmed_flag;
+    if (!input->replay) s_deviceStatus.buttonStatus = input->confirmed_flag;
 }
 
 
@@ -20,6 +20,16 @@
 #define FLASH_MIN_DURATION 300 // 400ms
 #define FLASH_MAX_DURATION 700 // 600ms
 
+// Kenar yakalamada seviyenin onaylanmasi icin sabit kalma suresi (buton/talep girisleri)
+#ifndef INPUT_DEBOUNCE_US
+#define INPUT_DEBOUNCE_US 20000
+#endif
+
+// Lamba geri beslemeleri icin daha uzun pencere (sebeke dalgalanmasi)
+#ifndef INPUT_LAMP_DEBOUNCE_US
+#define INPUT_LAMP_DEBOUNCE_US 40000
+#endif
+
 
 typedef enum {
     LIGHT_OFF,
@@ -29,7 +39,6 @@ typedef enum {
 
 typedef struct {
     gpio_num_t pin;
-    bool level_flags[3];   // 3 ardışık ölçüm için
     bool confirmed_flag;
     int64_t timestamp;
     const char* label;
@@ -43,6 +52,7 @@ typedef struct {
     uint32_t countdown_current;   // Geri sayım süresi (saniye)
     uint32_t countdown_start;     // Başlangıç değeri (saniye)
     bool isCountdown_active;
+    uint8_t countdown_confidence;   // Geri sayimin CycleModel tahmin guveni (0-100), 0: tahmin yok
     uint32_t learned_durations[2];  // Son 2 öğrenilen süre (ms)
     uint8_t learning_phase;         // 0: başlangıç, 1: ilk öğrenme, 2: ikinci öğrenme
     uint8_t countdown_phase;        // 0: bekleme, 1: ilk sayım, 2: ikinci sayım
@@ -58,17 +68,48 @@ typedef struct {
     // Süre hesaplamaları
     uint32_t total_flash_time;    // Toplam flaş süresi
     uint32_t total_steady_time;   // Toplam sabit ışık süresi
+    uint32_t pending_flash_time;  // PCNT flas onayi gelmeden gelen kisa darbelerin (<=800 ms) suresi
+    uint8_t pending_flash_pulses; // pending_flash_time'daki darbe sayisi
 
     // Modlar ve durumlar
     bool flash_mode;              // Flaş modu aktif mi?
     bool counting;                // Ölçüm yapılıyor mu?
-    LightMode light_mode;         // Mevcut ışık modu
+    LightMode light_mode;         // Mevcut ışık modu (LampPcnt donanim sayacindan)
+    uint16_t flash_period_ms;     // PCNT ile olculen flas periyodu, 0: flas yok
     uint8_t measurement_count; // Ölçüm sayacı
     
     bool isDemandActive;
+
+    // Kesme tabanli kenar yakalama (GpioEdge)
+    bool raw_level;               // Son ham kenarin seviyesi
+    bool debounced_level;         // INPUT_DEBOUNCE_US boyunca sabit kalmis seviye
+    int64_t raw_edge_us;          // Son ham kenarin zamani (us); timestamp onaylanan gecisin zamanidir
+
+    bool replay;                  // TraceReplay kopyasi: gunluk, model ve iz yan etkisi yok
     
 } InputDebounce_t;
 
+// Geri sayim adiminin durumu (Countdown_Tick)
+typedef struct {
+    uint32_t current;             // Son sayilan deger, 0: baslamadi
+    bool silent;                  // greenCountFrom ustunde sessiz sayim
+} Countdown_t;
+
+// Talep girisinin durum takibi (DetectPedestrianDemandFeedbackAt)
+typedef struct {
+    uint64_t state_start_ms;      // Onayli seviyenin basladigi zaman
+    bool initialized;             // Ilk cagri baslangic seviyesini alir
+    uint32_t alarms;              // Takili giris alarmi sayisi
+} DemandTrack_t;
+
+// Titresim motoru kanal tanimi: durum, pin, polarite ve pencere
+typedef struct {
+    InputDebounce_t *input;
+    uint8_t pin;
+    bool active_low;              // true: pin LOW iken giris aktif
+    uint32_t debounce_us;         // Seviyenin onay icin sabit kalma suresi
+} InputChannel_t;
+
 
 
 // Sadece bildirimi burada yap
@@ -82,12 +123,17 @@ extern uint32_t Counter;
 
 void DetectFeedBack(InputDebounce_t* input);
 void GPIO_Init(void);
+void GPIO_EdgeCaptureInit(void);
+uint32_t ProcessInputEdges(void);
 void TrackInputRequest(InputDebounce_t *input);
+void TrackInputRequestAt(InputDebounce_t *input, uint32_t now);
+uint32_t Countdown_Tick(InputDebounce_t *input, Countdown_t *cd, uint32_t from, uint32_t to);
 void InputDebounce_Init(InputDebounce_t *input, const char* label);
 void ResetAllTrafficVariables(void);
 void DetectGreenFeedback(void);
 void DetectButtonFeedback(void); 
 void DetectRedFeedback(void);
 void DetectPedestrianDemandFeedback(void);
+void DetectPedestrianDemandFeedbackAt(InputDebounce_t *input, DemandTrack_t *track, uint64_t now_ms);
 const char* get_audio_file_path(uint32_t count);
 #endif /* MAIN_DETECTTRAFFIC_H_ */
@@ -0,0 +1,137 @@
+/*
+ * GpioEdge.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Interrupt-driven GPIO edge capture into a lock-free single-producer/single-consumer ring.
+ *
+ * Every configured pin raises an interrupt on both edges (GPIO_INTR_ANYEDGE). The handler reads the pin
+ * level and esp_timer_get_time() and pushes {pin, level, time} into a ring; the consumer task (IO_Task)
+ * is woken with a task notification and runs the debounce state machines on the recorded edges. The GPIO
+ * ISR service calls the per-pin handlers one after another from a single interrupt, so there is only one
+ * producer: head is written only by the ISR and tail only by the consumer, and no lock is needed. A full
+ * ring drops the new edge and counts it; the consumer resynchronises from the pin level.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "GpioEdge.h"
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define RING_MASK   (GPIO_EDGE_RING_LEN - 1)
+
+static const char *TAG_EDGE = "GPIO_EDGE";
+
+static GpioEdge_t s_ring[GPIO_EDGE_RING_LEN];
+static volatile uint32_t s_head = 0;    // Yalniz ISR yazar
+static volatile uint32_t s_tail = 0;    // Yalniz tuketici yazar
+static volatile TaskHandle_t s_consumer = NULL;
+static GpioEdgeStats_t s_stats;
+
+
+
+/* Pin kesmesi: seviye ve zamani halkaya yazar, tuketiciyi uyandirir */
+static void IRAM_ATTR edge_isr(void *arg)
+{
+    uint32_t pin = (uint32_t)(uintptr_t)arg;
+    uint32_t head = s_head;
+
+    if (head - __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE) >= GPIO_EDGE_RING_LEN) {
+        s_stats.overflows++;
+    } else {
+        GpioEdge_t *e = &s_ring[head & RING_MASK];
+        e->time_us = esp_timer_get_time();
+        e->pin = (uint8_t)pin;
+        e->level = (uint8_t)gpio_ll_get_level(&GPIO, pin);
+        __atomic_store_n(&s_head, head + 1, __ATOMIC_RELEASE);  // Kayit, head'den once gorunur olmali
+        s_stats.edges++;
+    }
+
+    if (s_consumer != NULL) {
+        BaseType_t must_yield = pdFALSE;
+        vTaskNotifyGiveFromISR(s_consumer, &must_yield);
+        portYIELD_FROM_ISR(must_yield);
+    }
+}
+
+
+
+/**
+ * @brief Enables both-edge interrupts on the given input pins.
+ *
+ * The pins must already be configured as inputs (GPIO_Init).
+ *
+ * @param[in] pin_mask Bit mask of GPIO numbers.
+ * @return ESP_OK on success, or the error of the GPIO driver.
+ */
+esp_err_t GpioEdge_Init(uint64_t pin_mask)
+{
+    esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {  // Servis zaten kuruluysa devam
+        ESP_LOGE(TAG_EDGE, "ISR servisi kurulamadi: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for (uint32_t pin = 0; pin < 64; pin++) {
+        if (!(pin_mask & (1ULL << pin))) continue;
+        gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_ANYEDGE);
+        err = gpio_isr_handler_add((gpio_num_t)pin, edge_isr, (void *)(uintptr_t)pin);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG_EDGE, "GPIO%" PRIu32 " kesmesi eklenemedi: %s", pin, esp_err_to_name(err));
+            return err;
+        }
+        gpio_intr_enable((gpio_num_t)pin);
+    }
+    ESP_LOGI(TAG_EDGE, "Kenar yakalama hazir (%d kayitlik halka)", GPIO_EDGE_RING_LEN);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Sets the task that is notified on every captured edge.
+ *
+ * @param[in] task Consumer task, the only caller of GpioEdge_Pop().
+ */
+void GpioEdge_SetConsumer(TaskHandle_t task)
+{
+    s_consumer = task;
+}
+
+
+
+/**
+ * @brief Takes the oldest captured edge from the ring.
+ *
+ * @param[out] out Edge record.
+ * @return true if an edge was returned, false if the ring is empty.
+ */
+bool GpioEdge_Pop(GpioEdge_t *out)
+{
+    uint32_t tail = s_tail;
+    if (tail == __atomic_load_n(&s_head, __ATOMIC_ACQUIRE)) return false;
+    *out = s_ring[tail & RING_MASK];
+    __atomic_store_n(&s_tail, tail + 1, __ATOMIC_RELEASE);  // Kayit okunmadan yer serbest birakilmamali
+    return true;
+}
+
+
+
+/**
+ * @brief Copies the capture counters.
+ *
+ * @param[out] out Pointer to a structure receiving the statistics.
+ */
+void GpioEdge_GetStats(GpioEdgeStats_t *out)
+{
+    if (out == NULL) return;
+    *out = s_stats;
+}
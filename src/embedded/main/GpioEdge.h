@@ -0,0 +1,39 @@
+/*
+ * GpioEdge.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_GPIOEDGE_H_
+#define MAIN_GPIOEDGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+
+// Kenar halkasinin uzunlugu (2'nin kuvveti olmali)
+#ifndef GPIO_EDGE_RING_LEN
+#define GPIO_EDGE_RING_LEN      64
+#endif
+
+// ISR'den gelen ham kenar
+typedef struct {
+    int64_t  time_us;   // esp_timer_get_time() zamani
+    uint8_t  pin;
+    uint8_t  level;     // Kenardan hemen sonra okunan seviye
+} GpioEdge_t;
+
+typedef struct {
+    uint32_t edges;     // Halkaya yazilan kenar
+    uint32_t overflows; // Halka dolu oldugu icin atilan kenar
+} GpioEdgeStats_t;
+
+esp_err_t GpioEdge_Init(uint64_t pin_mask);
+void GpioEdge_SetConsumer(TaskHandle_t task);
+bool GpioEdge_Pop(GpioEdge_t *out);
+void GpioEdge_GetStats(GpioEdgeStats_t *out);
+
+#endif /* MAIN_GPIOEDGE_H_ */
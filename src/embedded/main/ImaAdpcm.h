@@ -0,0 +1,42 @@
+/*
+ * ImaAdpcm.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_IMAADPCM_H_
+#define MAIN_IMAADPCM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define WAV_FORMAT_IMA_ADPCM        0x0011
+
+// Desteklenen en buyuk blok (byte); yaygin degerler 256/512/1024
+#define IMA_ADPCM_MAX_BLOCK_ALIGN   2048
+
+// Akan IMA-ADPCM cozucu durumu. Girdi tam birimler halinde verilir (baslik, mono 1 byte, stereo 8 byte).
+typedef struct {
+    uint16_t block_align;       // Blok boyu (byte)
+    uint16_t channels;          // 1 veya 2
+    uint16_t samples_per_block; // Kanal basina blok ornegi (baslik ornegi dahil)
+    uint16_t block_left;        // Gecerli blokta kalan byte, 0: siradaki byte yeni blok basligi
+    int32_t  predictor[2];
+    int32_t  index[2];
+} ImaAdpcm_t;
+
+typedef struct {
+    uint64_t cycles;    // Cozucude harcanan toplam CPU cycle
+    uint32_t blocks;    // Basligi cozulen blok sayisi
+    uint64_t frames;    // Uretilen toplam frame
+} ImaAdpcmStats_t;
+
+bool ImaAdpcm_Init(ImaAdpcm_t *dec, uint16_t channels, uint16_t block_align);
+size_t ImaAdpcm_InputBytesFor(const ImaAdpcm_t *dec, size_t frames, size_t avail);
+size_t ImaAdpcm_Decode(ImaAdpcm_t *dec, const uint8_t *in, size_t in_bytes, int16_t *out);
+float ImaAdpcm_GetCyclesPerBlock(void);
+void ImaAdpcm_GetStats(ImaAdpcmStats_t *out);
+
+#endif /* MAIN_IMAADPCM_H_ */
@@ -0,0 +1,177 @@
+/*
+ * LampPcnt.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Flash/steady classification of the lamp feedback inputs with the PCNT peripheral.
+ *
+ * The green and red feedback pins are routed through the GPIO matrix to one pulse counter unit each, in
+ * parallel with the edge interrupts. The unit counts rising edges in hardware, behind a glitch filter, so
+ * the count is exact no matter how busy the CPU is with web or audio work. Once per LAMP_PCNT_WINDOW_MS
+ * the count is read (one register read per lamp, no pin polling) and the lamp is classified:
+ * consecutive windows with edges form a run, whose period is the run time divided by the edges counted in
+ * it; a run period between LAMP_FLASH_MIN_PERIOD_MS and LAMP_FLASH_MAX_PERIOD_MS is a flash. A window
+ * without edges ends the run and the lamp is steady on or off by its debounced level. The result is
+ * published in the light_mode and flash_period_ms fields of the input. A flash is only recognised after
+ * two or three windows, so TrackInputRequestAt() holds the short pulses seen before that and adds them to
+ * the flash time once light_mode turns to LIGHT_FLASH.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "LampPcnt.h"
+#include "driver/pulse_cnt.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+#define PCNT_HIGH_LIMIT     32767   // Ulasilinca sayac sifirlanir, fark hesabi sarmayi dikkate alir
+
+typedef struct {
+    InputDebounce_t     *input;
+    int                  pin;
+    pcnt_unit_handle_t   unit;
+    int                  last_count;
+    int64_t              window_start_us;
+    int64_t              run_start_us;      // Kenarli pencere dizisinin basi, 0: dizi yok
+    uint32_t             run_edges;
+} LampCounter_t;
+
+static const char *TAG_PCNT = "LAMP_PCNT";
+
+static LampCounter_t s_lamps[] = {
+    { .input = &green_input, .pin = Green_FB_Input_Pin },
+    { .input = &red_input,   .pin = Red_FB_Input_Pin },
+};
+
+#define LAMP_COUNT (sizeof(s_lamps) / sizeof(s_lamps[0]))
+
+
+
+/* Lamba icin yukselen kenar sayan PCNT birimini kurar */
+static esp_err_t open_unit(LampCounter_t *lamp)
+{
+    pcnt_unit_config_t unit_cfg = {
+        .low_limit = -1,
+        .high_limit = PCNT_HIGH_LIMIT,
+    };
+    ESP_RETURN_ON_ERROR(pcnt_new_unit(&unit_cfg, &lamp->unit), TAG_PCNT, "PCNT birimi olusturulamadi");
+
+    pcnt_glitch_filter_config_t filter_cfg = { .max_glitch_ns = LAMP_PCNT_GLITCH_NS };
+    ESP_RETURN_ON_ERROR(pcnt_unit_set_glitch_filter(lamp->unit, &filter_cfg), TAG_PCNT, "PCNT filtresi ayarlanamadi");
+
+    pcnt_chan_config_t chan_cfg = {
+        .edge_gpio_num = lamp->pin,
+        .level_gpio_num = -1,
+    };
+    pcnt_channel_handle_t chan = NULL;
+    ESP_RETURN_ON_ERROR(pcnt_new_channel(lamp->unit, &chan_cfg, &chan), TAG_PCNT, "PCNT kanali olusturulamadi");
+    ESP_RETURN_ON_ERROR(pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD),
+                        TAG_PCNT, "PCNT kenar ayari yapilamadi");
+
+    ESP_RETURN_ON_ERROR(pcnt_unit_enable(lamp->unit), TAG_PCNT, "PCNT birimi acilamadi");
+    ESP_RETURN_ON_ERROR(pcnt_unit_clear_count(lamp->unit), TAG_PCNT, "PCNT sayaci silinemedi");
+    return pcnt_unit_start(lamp->unit);
+}
+
+/* Bir pencerenin kenar sayisiyla lambayi siniflandirir */
+static void classify(LampCounter_t *lamp, uint32_t edges, int64_t now_us)
+{
+    InputDebounce_t *input = lamp->input;
+
+    if (edges == 0) {
+        lamp->run_start_us = 0;
+        lamp->run_edges = 0;
+        input->flash_period_ms = 0;
+        input->light_mode = input->debounced_level ? LIGHT_ON : LIGHT_OFF;
+        return;
+    }
+
+    if (lamp->run_start_us == 0) {
+        lamp->run_start_us = lamp->window_start_us;
+    }
+    lamp->run_edges += edges;
+    if (lamp->run_edges < 2) return;  // Periyot icin en az iki kenar
+
+    uint32_t period_ms = (uint32_t)((now_us - lamp->run_start_us) / 1000 / lamp->run_edges);
+    bool flash = period_ms >= LAMP_FLASH_MIN_PERIOD_MS && period_ms <= LAMP_FLASH_MAX_PERIOD_MS;
+    if (flash && input->light_mode != LIGHT_FLASH) {
+        printf("[%s] PCNT: flas (%" PRIu32 " ms periyot)\n", input->label, period_ms);
+    }
+    input->flash_period_ms = (uint16_t)(period_ms > UINT16_MAX ? UINT16_MAX : period_ms);
+    input->light_mode = flash ? LIGHT_FLASH : LIGHT_ON;
+}
+
+
+
+/**
+ * @brief Starts one pulse counter unit per lamp feedback input.
+ *
+ * Must be called after GPIO_Init(); the pins stay usable for the edge interrupts.
+ *
+ * @return ESP_OK on success, or the error of the PCNT driver.
+ */
+esp_err_t LampPcnt_Init(void)
+{
+    for (size_t i = 0; i < LAMP_COUNT; i++) {
+        esp_err_t err = open_unit(&s_lamps[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG_PCNT, "GPIO%d icin PCNT acilamadi: %s", s_lamps[i].pin, esp_err_to_name(err));
+            return err;
+        }
+        s_lamps[i].last_count = 0;
+        s_lamps[i].window_start_us = 0;
+    }
+    ESP_LOGI(TAG_PCNT, "Lamba sayaclari hazir (%u lamba)", (unsigned)LAMP_COUNT);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Reads the lamp counters once per LAMP_PCNT_WINDOW_MS and updates the classification.
+ *
+ * Called from IO_Task; between windows it returns without touching the hardware.
+ *
+ * @param[in] now_us Current esp_timer_get_time() value.
+ */
+void LampPcnt_Update(int64_t now_us)
+{
+    for (size_t i = 0; i < LAMP_COUNT; i++) {
+        LampCounter_t *lamp = &s_lamps[i];
+        if (lamp->unit == NULL) continue;
+        if (lamp->window_start_us == 0) {
+            lamp->window_start_us = now_us;
+            continue;
+        }
+        if (now_us - lamp->window_start_us < (int64_t)LAMP_PCNT_WINDOW_MS * 1000) continue;
+
+        int count = 0;
+        pcnt_unit_get_count(lamp->unit, &count);
+        uint32_t edges = (count >= lamp->last_count) ? (uint32_t)(count - lamp->last_count)
+                                                     : (uint32_t)(count + PCNT_HIGH_LIMIT - lamp->last_count);
+        lamp->last_count = count;
+
+        classify(lamp, edges, now_us);
+        lamp->window_start_us = now_us;
+    }
+}
+
+
+
+/**
+ * @brief Returns the flash frequency measured for a lamp input.
+ *
+ * @param[in] input green_input or red_input.
+ * @return Flash frequency in Hz, 0 if the lamp is not flashing.
+ */
+float LampPcnt_GetFlashHz(const InputDebounce_t *input)
+{
+    if (input->light_mode != LIGHT_FLASH || input->flash_period_ms == 0) return 0.0f;
+    return 1000.0f / (float)input->flash_period_ms;
+}
@@ -0,0 +1,32 @@
+/*
+ * LampPcnt.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_LAMPPCNT_H_
+#define MAIN_LAMPPCNT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "DetectTraffic.h"
+
+// Sayac okuma penceresi; en uzun flas periyodundan uzun olmali ki flas eden lambanin her penceresinde kenar olsun
+#ifndef LAMP_PCNT_WINDOW_MS
+#define LAMP_PCNT_WINDOW_MS         2000
+#endif
+
+// Flas kabul edilen periyot araligi (400-800 ms yanik + 400-800 ms sonuk)
+#define LAMP_FLASH_MIN_PERIOD_MS    800
+#define LAMP_FLASH_MAX_PERIOD_MS    1600
+
+// Bu sureden kisa darbeler donanim filtresiyle atilir
+#define LAMP_PCNT_GLITCH_NS         10000
+
+esp_err_t LampPcnt_Init(void);
+void LampPcnt_Update(int64_t now_us);
+float LampPcnt_GetFlashHz(const InputDebounce_t *input);
+
+#endif /* MAIN_LAMPPCNT_H_ */
@@ -0,0 +1,438 @@
+/*
+ * Loudness.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Streaming fixed-point loudness estimator for the microphone: DC block, A-weighting and RMS in dB.
+ *
+ * Each decimated DMA frame from MicADC_Task passes through a one-pole DC tracker that removes the
+ * microphone bias (the plain mean of the raw counts measured mostly that bias), an optional A-weighting
+ * IIR and a squarer that sums the frame energy. The signal is kept in Q23 (1.0 = ADC full scale) and the
+ * energy in Q30, so the per-sample path is integer only: a few adds and shifts without weighting, two
+ * Q28 biquads with it. Once per frame the mean square feeds two exponential averages with the Fast and
+ * Slow time constants, and a fixed-point log2 turns them into dB SPL (x10) through a calibration offset.
+ *
+ * The A-weighting biquads map the analog IEC 61672 high-pass poles with the matched-z transform at the
+ * actual sample rate (z = e^(-p/fs), double zero at z = 1) and are normalised to 0 dB at 1 kHz; the
+ * bilinear transform misplaces these poles by about 1 dB at 5 kHz. The 12.2 kHz low-pass pair lies above
+ * the 2.5 kHz Nyquist edge and is left out. The curve stays within 0.2 dB of IEC 61672 from 31.5 Hz to
+ * 2.4 kHz; the decimation average of MichADCRead rolls both weightings off a few dB towards 2.5 kHz.
+ *
+ * The microphone also hears the device's own announcements, which would raise the ambient level and with it
+ * the volume of the next announcement. Each frame is therefore checked against the output envelope that
+ * AudioPipeline publishes. Frames taken while the output was silent are clean and feed the ambient averages.
+ * While the speaker plays, frames where the output clearly dominates teach an output-to-microphone coupling
+ * ratio; once it is learned, frames where the predicted self-noise is at most half the measured energy have
+ * that share subtracted and are used too. All other playback frames are gated and the ambient level holds.
+ * The share of frames that reached the ambient averages is published as a confidence figure.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "Loudness.h"
+#include "AudioPipeline.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <string.h>
+
+#define COEF_SHIFT      28                  // Biquad katsayilari Q28
+#define SIGNAL_SHIFT    23                  // Sinyal Q23, 1.0 = ADC tam olcegi
+#define ENERGY_SHIFT    8                   // Ortalama karelerin ek kesir biti
+#define ALPHA_SHIFT     16
+#define A_SECTIONS      2
+#define COUPLING_SHIFT  24                  // Kuplaj orani Q24
+#define COUPLING_MAX    (1ull << 32)        // +24 dB; kendi ses tahmini 64 bitte kalsin
+#define COUPLING_ALPHA  (1u << (ALPHA_SHIFT - 4))  // Ogrenme cercevesi basina 1/16
+
+// A agirliklamasinin analog kutuplari (Hz), IEC 61672; 12194 Hz cift kutbu 2.5 kHz altinda < 0.2 dB etkiler, alinmadi
+#define A_POLE_1        20.598997
+#define A_POLE_2        107.65265
+#define A_POLE_3        737.86223
+
+typedef struct {
+    int32_t b0, b1, b2, a1, a2;             // Q28
+} Biquad_t;
+
+typedef struct {
+    int32_t x1, x2, y1, y2;                 // Q23
+} BiquadState_t;
+
+typedef enum {
+    FRAME_CLEAN,                            // Cikis sessiz
+    FRAME_COMPENSATED,                      // Calma var, kendi sesi cikarildi
+    FRAME_GATED,                            // Calma var, ortama katilmadi
+} FrameClass_t;
+
+static const char *TAG_LOUD = "LOUDNESS";
+
+static Biquad_t s_aCoef[A_SECTIONS];
+static BiquadState_t s_aState[A_SECTIONS];
+static bool s_aWeighting = LOUDNESS_A_WEIGHTING;
+static int32_t s_dc = 0;                    // Ham sayim << 16
+static bool s_dcPrimed = false;
+static uint32_t s_alphaFast = 0;            // Q16, cerceve basina
+static uint32_t s_alphaSlow = 0;
+static uint64_t s_msFast = 0;               // Ortalama kare, Q30 << ENERGY_SHIFT
+static uint64_t s_msSlow = 0;
+static uint64_t s_msRaw = 0;                // Tum cercevelerin Slow ortalamasi
+static uint64_t s_coupling = 0;             // Q24, mikrofon ortalama karesi / cikis ortalama karesi
+static uint32_t s_couplingFrames = 0;
+static uint32_t s_alphaConfidence = 0;
+static uint64_t s_confidence = 0;           // Ortama katilan cerceve payi, Q16
+static int64_t s_frameUs = 0;
+static int16_t s_fullScaleDb10 = LOUDNESS_FULL_SCALE_DB10;
+
+static LoudnessLevel_t s_level;
+static portMUX_TYPE s_levelMux = portMUX_INITIALIZER_UNLOCKED;
+
+
+
+/* s^2 / ((s + p1)(s + p2)) yuksek geciren bolumunu eslenik-z donusumuyle biquad'a cevirir; p rad/s */
+static void design_section(double *b, double *a, double p1, double p2, double fs)
+{
+    double r1 = exp(-p1 / fs);
+    double r2 = exp(-p2 / fs);
+    double g = 1.0;  // Toplam kazanc 1 kHz'de ayarlanir
+    b[0] = g;
+    b[1] = -2.0 * g;
+    b[2] = g;
+    a[0] = -(r1 + r2);
+    a[1] = r1 * r2;
+}
+
+/* Biquad genliginin w (rad/ornek) frekansindaki degeri */
+static double section_gain(const double *b, const double *a, double w)
+{
+    double c1 = cos(w), s1 = sin(w), c2 = cos(2.0 * w), s2 = sin(2.0 * w);
+    double nr = b[0] + b[1] * c1 + b[2] * c2, ni = -(b[1] * s1 + b[2] * s2);
+    double dr = 1.0 + a[0] * c1 + a[1] * c2, di = -(a[0] * s1 + a[1] * s2);
+    return sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+}
+
+/* 1 - exp(-cerceve/tau), Q16 */
+static uint32_t frame_alpha(uint32_t sample_rate_hz, uint32_t frame_samples, uint32_t tau_ms)
+{
+    double frame_ms = 1000.0 * frame_samples / sample_rate_hz;
+    return (uint32_t)((1.0 - exp(-frame_ms / tau_ms)) * (1u << ALPHA_SHIFT) + 0.5);
+}
+
+static inline int32_t biquad(const Biquad_t *c, BiquadState_t *s, int32_t x)
+{
+    int64_t acc = (int64_t)c->b0 * x + (int64_t)c->b1 * s->x1 + (int64_t)c->b2 * s->x2
+                - (int64_t)c->a1 * s->y1 - (int64_t)c->a2 * s->y2;
+    int32_t y = (int32_t)((acc + (1 << (COEF_SHIFT - 1))) >> COEF_SHIFT);
+    s->x2 = s->x1;
+    s->x1 = x;
+    s->y2 = s->y1;
+    s->y1 = y;
+    return y;
+}
+
+/* Ornek dongusu: DC izleyici, istege bagli A agirligi ve kare toplami (Q30) */
+static uint64_t IRAM_ATTR frame_energy(const uint16_t *pcm, uint32_t n, bool weighting)
+{
+    int32_t dc = s_dc;
+    uint64_t energy = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t x = (int32_t)pcm[i] << 16;
+        dc += (x - dc) >> LOUDNESS_DC_SHIFT;
+        int32_t y = (x - dc) >> (16 + 11 - SIGNAL_SHIFT);  // 2048 sayim = 1.0 (Q23)
+        if (weighting) {
+            y = biquad(&s_aCoef[0], &s_aState[0], y);
+            y = biquad(&s_aCoef[1], &s_aState[1], y);
+        }
+        int32_t y15 = y >> (SIGNAL_SHIFT - 15);
+        energy += (uint64_t)((int64_t)y15 * y15);  // Bias sicramasinda y15 16 biti asabilir
+    }
+    s_dc = dc;
+    return energy;
+}
+
+/* log2(x), Q8; x > 0 */
+static int32_t log2_q8(uint64_t x)
+{
+    int e = 63 - __builtin_clzll(x);
+    uint32_t m = (e >= 30) ? (uint32_t)(x >> (e - 30)) : (uint32_t)(x << (30 - e));  // [1, 2), Q30
+    int32_t r = e << 8;
+    for (int bit = 128; bit > 0; bit >>= 1) {
+        m = (uint32_t)(((uint64_t)m * m) >> 30);
+        if (m >= (2u << 30)) {
+            m >>= 1;
+            r += bit;
+        }
+    }
+    return r;
+}
+
+/* 10*log10(x / 2^frac_bits) x10; x > 0 */
+static int32_t ratio_db10(uint64_t x, int frac_bits)
+{
+    // (log2 - frac_bits) * 3.0103; Q8'den x10 dB'e: * 30.103 / 256 = 7706 / 2^16
+    return (int32_t)(((int64_t)(log2_q8(x) - (frac_bits << 8)) * 7706 + 32768) >> 16);
+}
+
+/* Ortalama kareyi (Q30 << ENERGY_SHIFT) kalibre dB x10'a cevirir */
+static int16_t energy_to_db10(uint64_t ms)
+{
+    if (ms == 0) return LOUDNESS_FLOOR_DB10;
+    int32_t db10 = ratio_db10(ms, 30 + ENERGY_SHIFT) + s_fullScaleDb10;
+    if (db10 < LOUDNESS_FLOOR_DB10) db10 = LOUDNESS_FLOOR_DB10;
+    if (db10 > INT16_MAX) db10 = INT16_MAX;
+    return (int16_t)db10;
+}
+
+/* Ustel ortalama: state += (x - state) * alpha */
+static inline void ewma(uint64_t *state, uint64_t x, uint32_t alpha)
+{
+    int64_t diff = (int64_t)x - (int64_t)*state;
+    *state = (uint64_t)((int64_t)*state + ((diff * (int64_t)alpha) >> ALPHA_SHIFT));
+}
+
+/* Cercevenin ortama katkisini cikis zarfina gore belirler, calma sirasinda kuplaji ogrenir; *ambient kullanilacak ortalama kare */
+static FrameClass_t classify_frame(uint64_t ms, uint64_t *ambient, bool *playback)
+{
+    AudioOutputEnvelope_t env;
+    AudioPipeline_GetOutputEnvelope(&env);
+    int64_t start_us = esp_timer_get_time() - s_frameUs;  // Cercevenin ilk ornegi yaklasik bu anda alindi
+    *playback = (env.streaming || env.until_us > start_us) && env.ms_q30 >= LOUDNESS_OUTPUT_SILENT_Q30;
+    *ambient = ms;
+    if (!*playback) return FRAME_CLEAN;
+
+    // Kendi sesi ortamin en az 6 dB ustundeyse fazlalik cikisa oranlanir
+    if (s_msSlow > 0 && ms >= 4 * s_msSlow) {
+        uint64_t ratio = ((ms - s_msSlow) << (COUPLING_SHIFT - ENERGY_SHIFT)) / env.ms_q30;
+        if (ratio > COUPLING_MAX) ratio = COUPLING_MAX;
+        // Ogrenilmis orandan 9 dB'den fazla sapma ortamin yukselmesidir, kuplaja yazilmaz
+        bool outlier = s_couplingFrames >= LOUDNESS_COUPLING_MIN_FRAMES &&
+                       (ratio > s_coupling * 8 || ratio * 8 < s_coupling);
+        if (!outlier) {
+            if (s_couplingFrames == 0) s_coupling = ratio;
+            else ewma(&s_coupling, ratio, COUPLING_ALPHA);
+            s_couplingFrames++;
+            return FRAME_GATED;
+        }
+    }
+#if LOUDNESS_SELF_NOISE_SUBTRACT
+    if (s_couplingFrames >= LOUDNESS_COUPLING_MIN_FRAMES) {
+        uint64_t self = (s_coupling * env.ms_q30) >> (COUPLING_SHIFT - ENERGY_SHIFT);
+        // Tahmini kendi sesi olcumun yarisini gecmiyorsa kuplaj hatasi ortama sinirli yansir
+        if (2 * self <= ms) {
+            *ambient = ms - self;
+            return FRAME_COMPENSATED;
+        }
+    }
+#endif
+    return FRAME_GATED;
+}
+
+
+
+/**
+ * @brief Designs the A-weighting filter and the RMS time constants for the microphone stream.
+ *
+ * @param[in] sample_rate_hz Rate of the samples passed to Loudness_ProcessFrame().
+ * @param[in] frame_samples  Nominal samples per frame; the Fast/Slow averages step once per frame.
+ *
+ * @details
+ * Uses double precision once at boot; the per-frame path is fixed point. Must be called before the
+ * first frame arrives.
+ */
+void Loudness_Init(uint32_t sample_rate_hz, uint32_t frame_samples)
+{
+    const double two_pi = 2.0 * M_PI;
+    double w1k = two_pi * 1000.0 / sample_rate_hz;
+    double fs = (double)sample_rate_hz;
+    double b[A_SECTIONS][3], a[A_SECTIONS][2];
+
+    design_section(b[0], a[0], two_pi * A_POLE_1, two_pi * A_POLE_1, fs);
+    design_section(b[1], a[1], two_pi * A_POLE_2, two_pi * A_POLE_3, fs);
+
+    double gain = 1.0;
+    for (int i = 0; i < A_SECTIONS; i++) gain *= section_gain(b[i], a[i], w1k);
+    for (int j = 0; j < 3; j++) b[A_SECTIONS - 1][j] /= gain;  // 1 kHz'de 0 dB
+
+    for (int i = 0; i < A_SECTIONS; i++) {
+        const double q = (double)(1 << COEF_SHIFT);
+        s_aCoef[i].b0 = (int32_t)lround(b[i][0] * q);
+        s_aCoef[i].b1 = (int32_t)lround(b[i][1] * q);
+        s_aCoef[i].b2 = (int32_t)lround(b[i][2] * q);
+        s_aCoef[i].a1 = (int32_t)lround(a[i][0] * q);
+        s_aCoef[i].a2 = (int32_t)lround(a[i][1] * q);
+    }
+    memset(s_aState, 0, sizeof(s_aState));
+
+    s_alphaFast = frame_alpha(sample_rate_hz, frame_samples, LOUDNESS_FAST_MS);
+    s_alphaSlow = frame_alpha(sample_rate_hz, frame_samples, LOUDNESS_SLOW_MS);
+    s_alphaConfidence = frame_alpha(sample_rate_hz, frame_samples, LOUDNESS_CONFIDENCE_MS);
+    s_frameUs = (int64_t)frame_samples * 1000000 / sample_rate_hz;
+    s_dcPrimed = false;
+    s_msFast = s_msSlow = s_msRaw = 0;
+    s_coupling = 0;
+    s_couplingFrames = 0;
+    s_confidence = 0;
+
+    ESP_LOGI(TAG_LOUD, "%lu Hz, cerceve %lu ornek, A agirlik %s, 0 dBFS = %d.%d dB",
+             (unsigned long)sample_rate_hz, (unsigned long)frame_samples, s_aWeighting ? "acik" : "kapali",
+             s_fullScaleDb10 / 10, s_fullScaleDb10 % 10);
+}
+
+
+
+/**
+ * @brief Turns the A-weighting filter on or off.
+ *
+ * @param[in] enable true for dB(A), false for the flat (Z) response above the DC block.
+ *
+ * @details
+ * The filter state is cleared, so the first frames after a switch settle like after boot.
+ */
+void Loudness_SetAWeighting(bool enable)
+{
+    s_aWeighting = enable;
+    memset(s_aState, 0, sizeof(s_aState));
+}
+
+
+
+/**
+ * @brief Sets the calibration offset.
+ *
+ * @param[in] full_scale_db10 Level in dB SPL x10 that a 0 dBFS (full-scale square wave) input represents.
+ */
+void Loudness_SetCalibration(int16_t full_scale_db10)
+{
+    s_fullScaleDb10 = full_scale_db10;
+}
+
+
+
+/**
+ * @brief Processes one frame of microphone samples and updates the published levels.
+ *
+ * @param[in] pcm 12-bit ADC samples after decimation.
+ * @param[in] n   Number of samples in the frame.
+ *
+ * @details
+ * Called from MicADC_Task only. The sample loop is timed with the CPU cycle counter, see
+ * Loudness_GetCyclesPerSample(). Frames taken while the speaker plays are compensated for the learned
+ * coupling or gated, so the Fast and Slow levels follow the ambient noise only.
+ */
+void Loudness_ProcessFrame(const uint16_t *pcm, uint32_t n)
+{
+    if (n == 0) return;
+    if (!s_dcPrimed) {
+        s_dc = (int32_t)pcm[0] << 16;  // Ilk cercevede bias'a oturma suresini atla
+        s_dcPrimed = true;
+    }
+
+    bool weighting = s_aWeighting;
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint64_t energy = frame_energy(pcm, n, weighting);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+    uint64_t ms = (energy << ENERGY_SHIFT) / n;
+    ewma(&s_msRaw, ms, s_alphaSlow);
+
+    uint64_t ambient;
+    bool playback;
+    FrameClass_t cls = classify_frame(ms, &ambient, &playback);
+    if (cls != FRAME_GATED) {
+        ewma(&s_msFast, ambient, s_alphaFast);
+        ewma(&s_msSlow, ambient, s_alphaSlow);
+    }
+    ewma(&s_confidence, cls != FRAME_GATED ? (1u << ALPHA_SHIFT) : 0, s_alphaConfidence);
+
+    int16_t frame_db10 = energy_to_db10(ms);
+    int16_t fast_db10 = energy_to_db10(s_msFast);
+    int16_t slow_db10 = energy_to_db10(s_msSlow);
+    int16_t raw_slow_db10 = energy_to_db10(s_msRaw);
+    bool coupling_valid = s_couplingFrames >= LOUDNESS_COUPLING_MIN_FRAMES && s_coupling > 0;
+    int16_t coupling_db10 = coupling_valid ? (int16_t)ratio_db10(s_coupling, COUPLING_SHIFT) : 0;
+    uint8_t confidence_pct = (uint8_t)((s_confidence * 100 + (1u << (ALPHA_SHIFT - 1))) >> ALPHA_SHIFT);
+
+    portENTER_CRITICAL(&s_levelMux);
+    s_level.frame_db10 = frame_db10;
+    s_level.fast_db10 = fast_db10;
+    s_level.slow_db10 = slow_db10;
+    s_level.raw_slow_db10 = raw_slow_db10;
+    s_level.coupling_db10 = coupling_db10;
+    s_level.coupling_valid = coupling_valid;
+    s_level.a_weighted = weighting;
+    s_level.playback = playback;
+    s_level.confidence_pct = confidence_pct;
+    s_level.frames++;
+    if (cls == FRAME_CLEAN) s_level.clean_frames++;
+    else if (cls == FRAME_COMPENSATED) s_level.compensated_frames++;
+    else s_level.gated_frames++;
+    s_level.cycles += cycles;
+    s_level.samples += n;
+    portEXIT_CRITICAL(&s_levelMux);
+}
+
+
+
+/**
+ * @brief Copies the latest levels and counters.
+ *
+ * @param[out] out Receives the levels.
+ */
+void Loudness_GetLevel(LoudnessLevel_t *out)
+{
+    portENTER_CRITICAL(&s_levelMux);
+    *out = s_level;
+    portEXIT_CRITICAL(&s_levelMux);
+}
+
+
+
+/**
+ * @brief Returns the Slow-weighted ambient level.
+ *
+ * @return Level in dB SPL x10 without the device's own output, LOUDNESS_FLOOR_DB10 before the first frame.
+ *         Holds its last value while playback frames are gated; see confidence_pct in Loudness_GetLevel().
+ */
+int16_t Loudness_GetDb10(void)
+{
+    portENTER_CRITICAL(&s_levelMux);
+    int16_t db10 = s_level.slow_db10;
+    portEXIT_CRITICAL(&s_levelMux);
+    return db10;
+}
+
+
+
+/**
+ * @brief Returns the share of recent frames that reached the ambient level.
+ *
+ * @return 0-100, averaged over about LOUDNESS_CONFIDENCE_MS; low values mean the ambient level is mostly
+ *         held from before a long announcement.
+ */
+uint8_t Loudness_GetConfidence(void)
+{
+    portENTER_CRITICAL(&s_levelMux);
+    uint8_t pct = s_level.confidence_pct;
+    portEXIT_CRITICAL(&s_levelMux);
+    return pct;
+}
+
+
+
+/**
+ * @brief Returns the average CPU cycles spent per sample in the sample loop.
+ *
+ * @return Cycles per sample, or 0 before the first frame.
+ */
+float Loudness_GetCyclesPerSample(void)
+{
+    LoudnessLevel_t level;
+    Loudness_GetLevel(&level);
+    return level.samples ? (float)level.cycles / (float)level.samples : 0.0f;
+}
@@ -0,0 +1,79 @@
+/*
+ * Loudness.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_LOUDNESS_H_
+#define MAIN_LOUDNESS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// DC izleyicinin kaydirmasi: 5 kHz'de 2^6 ornek zaman sabiti, ~12 Hz yuksek geciren kose
+#ifndef LOUDNESS_DC_SHIFT
+#define LOUDNESS_DC_SHIFT       6
+#endif
+
+// Acilista A agirliklamasi acik mi (Loudness_SetAWeighting ile degistirilebilir)
+#ifndef LOUDNESS_A_WEIGHTING
+#define LOUDNESS_A_WEIGHTING    1
+#endif
+
+// RMS zaman sabitleri (IEC 61672 Fast / Slow)
+#define LOUDNESS_FAST_MS        125
+#define LOUDNESS_SLOW_MS        1000
+
+// 0 dBFS (tam olcek kare dalga RMS'i) icin okunan dB SPL x10; mikrofon ve on yukselteca gore kalibre edilir
+#ifndef LOUDNESS_FULL_SCALE_DB10
+#define LOUDNESS_FULL_SCALE_DB10 1200
+#endif
+
+// Sessizlikte log(0) yerine donen alt sinir
+#define LOUDNESS_FLOOR_DB10     0
+
+// Bu ortalama karenin (Q30) altindaki cikis sessiz sayilir: -60 dBFS
+#ifndef LOUDNESS_OUTPUT_SILENT_Q30
+#define LOUDNESS_OUTPUT_SILENT_Q30 1074
+#endif
+
+// Calma sirasinda ogrenilen cikis->mikrofon kuplajiyla kendi sesi cikarilsin mi; 0 ise calma cerceveleri yalnizca atlanir
+#ifndef LOUDNESS_SELF_NOISE_SUBTRACT
+#define LOUDNESS_SELF_NOISE_SUBTRACT 1
+#endif
+
+// Kuplaj tahmini bu kadar ogrenme cercevesinden sonra cikarmada kullanilir
+#define LOUDNESS_COUPLING_MIN_FRAMES 32
+
+// Guven orani (temiz cerceve payi) zaman sabiti
+#define LOUDNESS_CONFIDENCE_MS  10000
+
+typedef struct {
+    int16_t frame_db10;         // Son DMA cercevesinin seviyesi (dB x10), kendi sesi dahil
+    int16_t fast_db10;          // Ortam seviyesi, LOUDNESS_FAST_MS zaman sabitli; yalnizca temiz/arindirilmis cerceveler
+    int16_t slow_db10;          // Ortam seviyesi, LOUDNESS_SLOW_MS zaman sabitli
+    int16_t raw_slow_db10;      // Tum cercevelerin Slow seviyesi (kendi sesi dahil), tani icin
+    int16_t coupling_db10;      // Ogrenilen kuplaj: 0 dBFS cikisin mikrofonda okunan seviyesi (dBFS x10)
+    bool coupling_valid;
+    bool a_weighted;
+    bool playback;              // Son cerceve cikis calarken alindi
+    uint8_t confidence_pct;     // Son ~LOUDNESS_CONFIDENCE_MS icinde ortama katilan cerceve payi
+    uint32_t frames;            // Islenen cerceve
+    uint32_t clean_frames;      // Cikis sessizken alinan cerceve
+    uint32_t compensated_frames; // Calma sirasinda kuplaj cikarilarak kullanilan cerceve
+    uint32_t gated_frames;      // Calma sirasinda atlanan cerceve
+    uint64_t cycles;            // Ornek dongusunde harcanan toplam CPU cycle
+    uint64_t samples;
+} LoudnessLevel_t;
+
+void Loudness_Init(uint32_t sample_rate_hz, uint32_t frame_samples);
+void Loudness_SetAWeighting(bool enable);
+void Loudness_SetCalibration(int16_t full_scale_db10);
+void Loudness_ProcessFrame(const uint16_t *pcm, uint32_t n);
+void Loudness_GetLevel(LoudnessLevel_t *out);
+int16_t Loudness_GetDb10(void);
+uint8_t Loudness_GetConfidence(void);
+float Loudness_GetCyclesPerSample(void);
+
+#endif /* MAIN_LOUDNESS_H_ */
@@ -6,8 +6,13 @@
  * @file
  * @brief Provides API functions to initialize, read, and deinitialize the ADC (Analog-to-Digital Converter) for ESP32.
  *
- * This module manages ADC operations including continuous and single conversion modes, configuration, sample reading,
- * averaging for noise reduction, and safe resource management. All key routines for interacting with ADC hardware are implemented here.
+ * The microphone is sampled in continuous (DMA) mode. Every completed DMA frame wakes MicADC_Task through
+ * s_conv_done_cb; the task drains all frames the driver holds, so a late wake-up costs latency but no samples,
+ * and a pool overflow is counted instead of passing silently. Each frame is decimated by MIC_ADC_DECIMATION to
+ * MIC_SAMPLE_RATE_HZ and handed to the Loudness estimator, which publishes the calibrated ambient level.
+ * The frames are also folded into 50 ms block means of the raw counts; adc_samples and g_adcAverage keep
+ * the form IO_Task used to produce with blocking adc1_get_raw loops and now show the microphone bias. DeInitADC/InitADC stop and restart the stream
+ * around flash writes; the task and these calls share s_adcLock, so the handle never changes under a read.
  *
  * @company    INTETRA
  * @version    v.0.0.0.1
@@ -17,21 +22,30 @@
 
 
 #include "MichADCRead.h"
+#include "Loudness.h"
+#include "esp_timer.h"
+#include <stdlib.h>
 
 volatile uint32_t g_movingRMS;
 const char *TAGADC = "ADCEXAMPLE";
 TaskHandle_t s_task_handle;
 adc_channel_t channel[1] = {ADC1_CHANNEL_6}; //IO 34
 adc_continuous_handle_t adc_handle = NULL;
-uint32_t adc_samples[ADC_SAMPLE_COUNT] = {0};
+RING_STATS_DEFINE(, adc_samples, ADC_AVERAGE_COUNT, 0, 0, 1);  // Son 10 blok ortalamasi
 uint8_t adc_sample_index = 0;
 uint32_t g_adcAverage = 0;
 
-#define ADC_CHANNEL     ADC1_CHANNEL_6   // GPIO34
-#define ADC_WIDTH_CFG   ADC_WIDTH_BIT_12
-#define ADC_ATTEN_CFG   ADC_ATTEN_DB_12
 static const char *TAG_ADC = "ADC_DRIVER";
 
+static SemaphoreHandle_t s_adcLock = NULL;
+static MicADCStats_t s_stats;
+static uint8_t s_dmaFrame[MIC_ADC_FRAME_BYTES];
+static uint16_t s_pcm[MIC_ADC_FRAME_SAMPLES];   // Desimasyon artigi s_decimSum'da kalir, cerceve basina en fazla bu kadar
+static uint32_t s_decimSum = 0;
+static uint8_t s_decimCount = 0;
+static uint32_t s_blockSum = 0;
+static uint32_t s_blockCount = 0;
+
  
  /**
  * @brief ADC continuous conversion done callback.
@@ -54,6 +68,14 @@ bool s_conv_done_cb(adc_continuous_handle_t handle, const adc_continuous_evt_dat
     vTaskNotifyGiveFromISR(s_task_handle, &mustYield);
     return (mustYield == pdTRUE);
 }
+
+
+/* Surucu havuzu doldu, eski sonuclar atildi; kayip sayilir */
+static bool s_pool_ovf_cb(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    s_stats.overflows++;
+    return false;
+}
  
  
  /**
@@ -73,12 +95,12 @@ void continuous_adc_init(adc_channel_t *channel, uint8_t channel_num, adc_contin
 {
     adc_continuous_handle_t handle = NULL;
     adc_continuous_handle_cfg_t adc_config = {
-        .max_store_buf_size = 1024,
-        .conv_frame_size = EXAMPLE_READ_LEN,
+        .max_store_buf_size = MIC_ADC_POOL_BYTES,
+        .conv_frame_size = MIC_ADC_FRAME_BYTES,
     };
     ESP_ERROR_CHECK(adc_continuous_new_handle(&adc_config, &handle));
     adc_continuous_config_t dig_cfg = {
-        .sample_freq_hz = 20000,  // 20 kHz örnekleme
+        .sample_freq_hz = MIC_ADC_DMA_HZ,
         .conv_mode = EXAMPLE_ADC_CONV_MODE,
         .format = EXAMPLE_ADC_OUTPUT_TYPE,
     };
@@ -102,23 +124,31 @@ void continuous_adc_init(adc_channel_t *channel, uint8_t channel_num, adc_contin
  *
  * This function sets up the ADC hardware and driver for continuous sampling.
  * If the ADC has already been initialized, the function will exit immediately.
- * It configures the conversion channels, registers event callbacks (here, not used),
- * and starts continuous ADC sampling using the ESP-IDF ADC driver.
+ * It configures the conversion channels, registers the frame-done and pool-overflow callbacks
+ * that drive MicADC_Task, and starts continuous ADC sampling using the ESP-IDF ADC driver.
  *
- * @note Uses ESP_ERROR_CHECK for error handling; will abort on failure.
+ * @note Uses ESP_ERROR_CHECK for error handling; will abort on failure. Call MicADC_Init() first.
  */
 void InitADC(void) 
 {
-    if (adc_handle != NULL) return;  // Zaten başlatıldıysa tekrar başlatma
+    if (s_adcLock == NULL) return;  // MicADC_Init cagrilmadi veya basarisiz
+    xSemaphoreTake(s_adcLock, portMAX_DELAY);
+    if (adc_handle != NULL) {  // Zaten başlatıldıysa tekrar başlatma
+        xSemaphoreGive(s_adcLock);
+        return;
+    }
 
-    //continuous_adc_init(channel, sizeof(channel) / sizeof(adc_channel_t), &adc_handle);
     continuous_adc_init(channel, 1, &adc_handle);
     adc_continuous_evt_cbs_t cbs = {
-        .on_conv_done = NULL, // callback kullanılmayacak
+        .on_conv_done = s_conv_done_cb,
+        .on_pool_ovf = s_pool_ovf_cb,
     };
 
     ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(adc_handle, &cbs, NULL));
+    s_decimSum = 0;  // Durdurulmus akistan kalan yarim ornek yeni akisa karismasin
+    s_decimCount = 0;
     ESP_ERROR_CHECK(adc_continuous_start(adc_handle));
+    xSemaphoreGive(s_adcLock);
 }
  
  
@@ -133,7 +163,12 @@ void InitADC(void)
  */
 void DeInitADC(void)
 {
-    if (adc_handle == NULL) return;  // Zaten durdurulmuşsa işlem yapma
+    if (s_adcLock == NULL) return;
+    xSemaphoreTake(s_adcLock, portMAX_DELAY);
+    if (adc_handle == NULL) {  // Zaten durdurulmuşsa işlem yapma
+        xSemaphoreGive(s_adcLock);
+        return;
+    }
 
     // ADC sürekli okumayı durdur
     esp_err_t err = adc_continuous_stop(adc_handle);
@@ -149,106 +184,136 @@ void DeInitADC(void)
 
     // Handle'ı temizle
     adc_handle = NULL;
+    xSemaphoreGive(s_adcLock);
 
     ESP_LOGI("ADC", "ADC deinit tamamlandi");
 }
 
 
-/**
- * @brief Reads a single sample from the ADC in continuous mode.
- *
- * Attempts to read one conversion frame from the ADC driver. Checks for read errors and ensures
- * the returned data is valid. If successful, extracts and returns the ADC data using the
- * EXAMPLE_ADC_GET_DATA macro. Returns 0 in case of error or invalid data.
- *
- * @return The ADC sample value read from the hardware, or 0 on failure.
- */
-uint32_t ReadADC_Sample(void) {
-    uint8_t result[EXAMPLE_READ_LEN] = {0};
-    uint32_t ret_num = 0;
-
-    esp_err_t ret = adc_continuous_read(adc_handle, result, EXAMPLE_READ_LEN, &ret_num, 0);
-    if (ret != ESP_OK || ret_num < sizeof(adc_digi_output_data_t)) {
-        return 0;
-    }
-    if (ret == ESP_OK && ret_num >= sizeof(adc_digi_output_data_t)) {
-        adc_digi_output_data_t *p = (adc_digi_output_data_t*)&result[0];
-        uint32_t data = EXAMPLE_ADC_GET_DATA(p);
-        return data;
-        //int32_t value = (int32_t)data - 2048;
-        //return (uint32_t)sqrt((float)(data * data));
-         // Basit RMS hesap
+/* Cercevedeki 12 bit sonuclari desimasyonla s_pcm'e yazar, ornek sayisini doner */
+static uint32_t decimate_frame(const uint8_t *buf, uint32_t len)
+{
+    uint32_t n = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&buf[i];
+        if (EXAMPLE_ADC_GET_CHANNEL(p) != (channel[0] & 0x7)) {
+            s_stats.invalid++;
+            continue;
+        }
+        s_decimSum += EXAMPLE_ADC_GET_DATA(p);
+        if (++s_decimCount == MIC_ADC_DECIMATION) {
+            s_pcm[n++] = (uint16_t)(s_decimSum / MIC_ADC_DECIMATION);
+            s_decimSum = 0;
+            s_decimCount = 0;
+        }
     }
-
-    return 0; // Hata durumu
+    return n;
 }
 
-
-/**
- * @brief Initializes the ADC in single conversion mode.
- *
- * Configures the ADC width and channel attenuation for single sample readings.
- * If configuration fails, logs an error and triggers an alarm event.
- *
- * @note Uses global configuration macros for width and attenuation.
- *
- * @return None.
- */
-void ADC_Read_Init(void)
+/* 50 ms blok ortalamalarini adc_samples penceresine ekler, g_adcAverage'i gunceller */
+static void update_average(const uint16_t *pcm, uint32_t n)
 {
-    esp_err_t ret;
+    for (uint32_t i = 0; i < n; i++) {
+        s_blockSum += pcm[i];
+        if (++s_blockCount < MIC_ADC_BLOCK_SAMPLES) continue;
 
-    // ADC çözünürlüğü
-    ret = adc1_config_width(ADC_WIDTH_CFG);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG_ADC, "adc1_config_width failed");
-        Alarm_Log("ADC width configuration failed", &DeviceTime);
-        return;
+        RingStats_Push(&adc_samples, (int32_t)(s_blockSum / MIC_ADC_BLOCK_SAMPLES));
+        s_blockSum = 0;
+        s_blockCount = 0;
+        g_adcAverage = (uint32_t)RingStats_Mean(&adc_samples);
     }
+}
 
-    // ADC giriş kanalını ayarla
-    ret = adc1_config_channel_atten(ADC_CHANNEL, ADC_ATTEN_CFG);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG_ADC, "adc1_config_channel_atten failed");
-        Alarm_Log("ADC channel attenuation configuration failed", &DeviceTime);
-        return;
+/* Surucudeki tum cerceveleri beklemeden okur */
+static void drain_frames(void)
+{
+    uint32_t ret_num = 0;
+    while (adc_continuous_read(adc_handle, s_dmaFrame, MIC_ADC_FRAME_BYTES, &ret_num, 0) == ESP_OK) {
+        uint32_t n = decimate_frame(s_dmaFrame, ret_num);
+        s_stats.frames++;
+        s_stats.samples += n;
+        update_average(s_pcm, n);
+        Loudness_ProcessFrame(s_pcm, n);
     }
+}
+
+/* Olcum gorevi: cerceve bildirimiyle uyanir, birikenleri bosaltir */
+static void MicADC_Task(void *pvParameters)
+{
+    uint32_t last_overflows = 0;
+    int64_t last_stats_us = esp_timer_get_time();
+
+    for (;;) {
+        // ADC flash yazimi icin durdurulduysa zaman asimiyla beklemeye devam eder
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MIC_ADC_STATS_MS));
 
-    ESP_LOGI(TAG_ADC, "ADC Initialized: channel=%d, width=%d, atten=%d", 
-             ADC_CHANNEL, ADC_WIDTH_CFG, ADC_ATTEN_CFG);
+        xSemaphoreTake(s_adcLock, portMAX_DELAY);
+        if (adc_handle != NULL) {
+            drain_frames();
+        }
+        xSemaphoreGive(s_adcLock);
 
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - last_stats_us >= (int64_t)MIC_ADC_STATS_MS * 1000) {
+            last_stats_us = now_us;
+            uint32_t overflows = s_stats.overflows;
+            LoudnessLevel_t level;
+            Loudness_GetLevel(&level);
+            ESP_LOGI(TAG_ADC, "%lu cerceve, %lu ornek, %lu gecersiz, %lu tasma (+%lu); %d.%d dB, %.1f cycle/ornek",
+                     (unsigned long)s_stats.frames, (unsigned long)s_stats.samples, (unsigned long)s_stats.invalid,
+                     (unsigned long)overflows, (unsigned long)(overflows - last_overflows),
+                     level.slow_db10 / 10, level.slow_db10 % 10, Loudness_GetCyclesPerSample());
+            ESP_LOGI(TAG_ADC, "Ortam guveni %%%u: %lu temiz, %lu arindirilmis, %lu atlanan cerceve; ham %d.%d dB, kuplaj %d.%d dB%s",
+                     (unsigned)level.confidence_pct, (unsigned long)level.clean_frames,
+                     (unsigned long)level.compensated_frames, (unsigned long)level.gated_frames,
+                     level.raw_slow_db10 / 10, level.raw_slow_db10 % 10,
+                     level.coupling_db10 / 10, abs(level.coupling_db10 % 10), level.coupling_valid ? "" : " (ogreniliyor)");
+            last_overflows = overflows;
+        }
+    }
 }
 
 
+
 /**
- * @brief Reads a single raw sample from the ADC channel.
+ * @brief Starts the microphone acquisition: the measurement task and the continuous ADC stream.
  *
- * Retrieves one raw conversion value from the configured ADC channel using single mode.
+ * Prepares the loudness estimator, creates MicADC_Task, then starts DMA sampling at MIC_ADC_DMA_HZ through InitADC(). Replaces the
+ * single-conversion setup; nothing has to poll the ADC afterwards. Calling the function again has no effect.
  *
- * @return The raw ADC sample value.
+ * @return ESP_OK on success, ESP_FAIL if the lock or the task could not be created.
  */
-uint32_t ADC_Read_Sample(void)
+esp_err_t MicADC_Init(void)
 {
-    return adc1_get_raw(ADC_CHANNEL);
+    if (s_task_handle != NULL) return ESP_OK;
+
+    s_adcLock = xSemaphoreCreateMutex();
+    if (s_adcLock == NULL) {
+        ESP_LOGE(TAG_ADC, "ADC kilidi olusturulamadi");
+        return ESP_FAIL;
+    }
+    if (xTaskCreate(MicADC_Task, "MicADC_Task", MIC_ADC_TASK_STACK, NULL,
+                    MIC_ADC_TASK_PRIORITY, &s_task_handle) != pdPASS) {
+        ESP_LOGE(TAG_ADC, "MicADC_Task olusturulamadi");
+        Alarm_Log("ADC task creation failed", &DeviceTime);
+        return ESP_FAIL;
+    }
+
+    Loudness_Init(MIC_SAMPLE_RATE_HZ, MIC_ADC_FRAME_SAMPLES);
+    InitADC();
+    ESP_LOGI(TAG_ADC, "Mikrofon: DMA %d Hz, /%d -> %d Hz, cerceve %d ornek",
+             MIC_ADC_DMA_HZ, MIC_ADC_DECIMATION, MIC_SAMPLE_RATE_HZ, MIC_ADC_FRAME_SAMPLES);
+    return ESP_OK;
 }
 
 
 
 /**
- * @brief Reads and returns the average value of multiple ADC samples.
+ * @brief Copies the acquisition counters.
  *
- * Obtains a specified number of raw ADC samples from the configured channel and computes their average.
- * This method helps reduce noise (e.g., microphone input) by averaging.
- *
- * @param[in] samples Number of samples to read and average.
- * @return Averaged ADC value, or 0 if samples is zero.
- */uint32_t ADC_Read_Average(uint16_t samples)
+ * @param[out] stats Receives the counters; overflows above zero mean samples were lost.
+ */
+void MicADC_GetStats(MicADCStats_t *stats)
 {
-    uint64_t sum = 0;
-    for (uint16_t i = 0; i < samples; i++) {
-        sum += adc1_get_raw(ADC_CHANNEL);
-    }
-    return (uint32_t)(sum / samples);
+    *stats = s_stats;
 }
-
-
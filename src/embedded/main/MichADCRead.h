@@ -12,8 +12,8 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/event_groups.h"
-#include "driver/adc.h"
 #include "Alarms.h"
+#include "RingStats.h"
 
 #ifndef MAIN_MICHADCREAD_H_
 #define MAIN_MICHADCREAD_H_
@@ -24,27 +24,57 @@
 #define EXAMPLE_ADC_ATTEN                   ADC_ATTEN_DB_12
 #define EXAMPLE_ADC_BIT_WIDTH               ADC_BITWIDTH_12
 #define EXAMPLE_ADC_OUTPUT_TYPE             ADC_DIGI_OUTPUT_FORMAT_TYPE1
-#define EXAMPLE_READ_LEN                    64   
 #define EXAMPLE_ADC_GET_CHANNEL(p_data)     ((p_data)->type1.channel)
 #define EXAMPLE_ADC_GET_DATA(p_data)        ((p_data)->type1.data)
 #define MOVING_SIZE 5
 #define ADC_SAMPLE_COUNT 10
 #define ADC_AVERAGE_COUNT 10 
 
+// DMA ornekleme hizi; ESP32 dijital denetleyicisi 20 kHz altina inemez (SOC_ADC_SAMPLE_FREQ_THRES_LOW)
+#ifndef MIC_ADC_DMA_HZ
+#define MIC_ADC_DMA_HZ              20000
+#endif
+// Ardisik bu kadar sonucun ortalamasi bir mikrofon ornegi olur: 20 kHz / 4 = 5 kHz
+#ifndef MIC_ADC_DECIMATION
+#define MIC_ADC_DECIMATION          4
+#endif
+#define MIC_SAMPLE_RATE_HZ          (MIC_ADC_DMA_HZ / MIC_ADC_DECIMATION)
+
+// Bir DMA cercevesi (byte); her cerceve sonu olcum gorevini uyandirir. 1024 byte = 512 sonuc = 25.6 ms
+#ifndef MIC_ADC_FRAME_BYTES
+#define MIC_ADC_FRAME_BYTES         1024
+#endif
+#define MIC_ADC_FRAME_RESULTS       (MIC_ADC_FRAME_BYTES / SOC_ADC_DIGI_RESULT_BYTES)
+#define MIC_ADC_FRAME_SAMPLES       (MIC_ADC_FRAME_RESULTS / MIC_ADC_DECIMATION)
+// Surucu havuzu: gorev bu kadar cerceve gecikse de ornek kaybolmaz (~100 ms)
+#define MIC_ADC_POOL_BYTES          (MIC_ADC_FRAME_BYTES * 4)
+
+// adc_samples'a giren blok: ornekleme saatine gore 50 ms, onceki IO_Task periyodu
+#define MIC_ADC_BLOCK_SAMPLES       (MIC_SAMPLE_RATE_HZ / 20)
+
+#define MIC_ADC_TASK_STACK          (1024 * 3)
+#define MIC_ADC_TASK_PRIORITY       5   // IO_Task (10) altinda; havuz 100 ms gecikmeyi karsilar
+#define MIC_ADC_STATS_MS            60000
+
+typedef struct {
+    uint32_t frames;            // Islenen DMA cercevesi
+    uint32_t samples;           // Desimasyon sonrasi mikrofon ornegi
+    uint32_t overflows;         // Havuz tasmasi; sifirdan farkliysa ornek kaybedildi
+    uint32_t invalid;           // Kanali uyusmayan sonuc
+} MicADCStats_t;
+
 extern const char *TAGADC;
 extern TaskHandle_t s_task_handle;
 extern adc_channel_t channel[1];
 extern uint8_t adc_sample_index;
-extern uint32_t adc_samples[ADC_SAMPLE_COUNT];
+extern RingStats_t adc_samples;
 extern uint32_t g_adcAverage;
  
 bool s_conv_done_cb(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data);
 void continuous_adc_init(adc_channel_t *channel, uint8_t channel_num, adc_continuous_handle_t *out_handle);
-void ADC_TASK(void *pvParameters);
 void InitADC(void);
-uint32_t ReadADC_Sample(void);
 extern adc_continuous_handle_t adc_handle;
 void DeInitADC(void);
-void ADC_Read_Init(void);
-uint32_t ADC_Read_Average(uint16_t samples);
+esp_err_t MicADC_Init(void);
+void MicADC_GetStats(MicADCStats_t *stats);
 #endif /* MAIN_MICHADCREAD_H_ */
@@ -0,0 +1,553 @@
+/*
+ * NoiseHistory.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Multi-resolution history of the ambient noise level: 1 s, 1 min and 1 h tiers in compact rings.
+ *
+ * IO_Task pushes the Slow-weighted ambient level once per second. Levels are stored as 8-bit codes in
+ * NOISE_HISTORY_STEP_DB10 steps, code 0 marking a slot without data (device off, ADC stopped). The seconds
+ * tier keeps one code per second. Every minute the seconds of that minute are folded into a 3-byte
+ * min/avg/max record of the minutes tier, and every hour the minutes into a record of the hours tier, so a
+ * month of history fits in about 7 KB of RAM. Each tier is a ring addressed by its time slot (epoch divided
+ * by the tier period), which lets a query jump straight to the slots it needs.
+ *
+ * NoiseHistory_Query() picks the coarsest tier whose period still fits the requested resolution and that
+ * reaches back to the start of the range, and merges neighbouring records when the range holds more of them
+ * than requested points. A day at 24 points therefore reads 24 hour records, not 86400 seconds; the minute
+ * and hour being collected are served from their accumulators.
+ *
+ * The rings are written to NOISE_HISTORY_FILE_PATH on the SD card every NOISE_HISTORY_CHECKPOINT_MS from
+ * FlashWrite_task, through a temporary file that is synced before it replaces the previous checkpoint. FATFS
+ * cannot rename over an existing file, so there is a moment with only the temporary file on the card; at boot
+ * it is loaded and moved into place when NOISE_HISTORY_FILE_PATH is missing or invalid, so a power cut at any
+ * point of the checkpoint leaves a complete one behind. The SD card is used instead of NVS because a checkpoint
+ * rewrites the whole store. The time the device was off shows up as empty slots after the load. Timestamps run on the RTC epoch read at boot plus the
+ * uptime, so a clock change takes effect in the history after the next restart.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "NoiseHistory.h"
+#include "SystemTime.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NOISE_HISTORY_MAGIC     0x5453484Eu     // "NHST"
+#define NOISE_HISTORY_VERSION   1
+#define NO_SLOT                 UINT32_MAX
+
+typedef struct {
+    uint8_t *rec;
+    uint16_t rec_size;          // 1 (kod) ya da sizeof(NoiseAggregate_t)
+    uint16_t len;
+    uint16_t head;              // Siradaki yazma yuvasi
+    uint16_t count;
+    uint32_t period_s;
+    uint32_t last_slot;         // En yeni kaydin zaman dilimi (epoch / period_s)
+} Tier_t;
+
+// Toplanmakta olan dakika ya da saat
+typedef struct {
+    uint32_t slot;              // NO_SLOT ise henuz baslamadi
+    uint32_t sum;               // Ortalama kodlarinin toplami
+    uint16_t n;                 // Verili alt kayit sayisi
+    uint8_t min;
+    uint8_t max;
+} Acc_t;
+
+// Kontrol noktasi dosyasinin basi; ardindan katman dizileri sirayla gelir
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t len[NOISE_TIER_COUNT];
+    uint16_t head[NOISE_TIER_COUNT];
+    uint16_t count[NOISE_TIER_COUNT];
+    uint32_t last_slot[NOISE_TIER_COUNT];
+    Acc_t acc_min;
+    Acc_t acc_hour;
+    uint32_t saved_at;          // Epoch
+} Checkpoint_t;
+
+static const char *TAG_NOISE = "NOISE_HISTORY";
+
+static uint8_t s_secRec[NOISE_HISTORY_SEC_LEN];
+static NoiseAggregate_t s_minRec[NOISE_HISTORY_MIN_LEN];
+static NoiseAggregate_t s_hourRec[NOISE_HISTORY_HOUR_LEN];
+
+static Tier_t s_tier[NOISE_TIER_COUNT] = {
+    [NOISE_TIER_SEC]  = { s_secRec, 1, NOISE_HISTORY_SEC_LEN, 0, 0, 1, 0 },
+    [NOISE_TIER_MIN]  = { (uint8_t *)s_minRec, sizeof(NoiseAggregate_t), NOISE_HISTORY_MIN_LEN, 0, 0, 60, 0 },
+    [NOISE_TIER_HOUR] = { (uint8_t *)s_hourRec, sizeof(NoiseAggregate_t), NOISE_HISTORY_HOUR_LEN, 0, 0, 3600, 0 },
+};
+static Acc_t s_accMin = { .slot = NO_SLOT };
+static Acc_t s_accHour = { .slot = NO_SLOT };
+
+static SemaphoreHandle_t s_lock = NULL;
+static uint32_t s_bootEpoch = 0;
+static uint32_t s_dirty = 0;                // Son kontrol noktasindan beri eklenen saniye
+static int64_t s_lastCheckpointUs = 0;
+static bool s_pending = false;              // Kontrol noktasi sirasinda gelen deger (yalniz IO_Task)
+static uint8_t s_pendingCode;
+static uint32_t s_pendingTime;
+
+
+
+/* dB x10 -> seviye kodu (1-255) */
+static inline uint8_t db10_to_code(int16_t db10)
+{
+    int32_t code = (db10 + NOISE_HISTORY_STEP_DB10 / 2) / NOISE_HISTORY_STEP_DB10;
+    return (uint8_t)(code < 1 ? 1 : (code > 255 ? 255 : code));
+}
+
+static inline int16_t code_to_db10(uint8_t code)
+{
+    return (int16_t)(code * NOISE_HISTORY_STEP_DB10);
+}
+
+/* Yasa gore kayit: 0 en yeni */
+static inline uint8_t *tier_at(const Tier_t *t, uint32_t age)
+{
+    uint32_t idx = (uint32_t)t->head + t->len - 1 - age;
+    if (idx >= t->len) idx -= t->len;
+    return &t->rec[idx * t->rec_size];
+}
+
+/* Halkaya bir kayit ekler, doluysa en eskinin ustune yazar */
+static void tier_write(Tier_t *t, const uint8_t *rec)
+{
+    memcpy(&t->rec[t->head * t->rec_size], rec, t->rec_size);
+    t->head = (uint16_t)(t->head + 1 == t->len ? 0 : t->head + 1);
+    if (t->count < t->len) t->count++;
+}
+
+/* Kaydi dilimine yazar; atlanan dilimlere fill, ayni dilime gelen ikinci kayit en yeninin ustune yazilir */
+static void tier_append(Tier_t *t, uint32_t slot, const uint8_t *rec, const uint8_t *fill)
+{
+    if (t->count > 0 && slot <= t->last_slot) {
+        if (slot == t->last_slot) memcpy(tier_at(t, 0), rec, t->rec_size);
+        return;  // Geriye giden saat yok sayilir
+    }
+    uint32_t gap = (t->count > 0) ? slot - t->last_slot - 1 : 0;
+    if (gap > t->len) gap = t->len;
+    for (uint32_t i = 0; i < gap; i++) tier_write(t, fill);
+    tier_write(t, rec);
+    t->last_slot = slot;
+}
+
+/* Toplayiciya bir kayit ekler; verisiz kayitlar sayilmaz */
+static void acc_add(Acc_t *a, uint8_t min, uint8_t avg, uint8_t max)
+{
+    if (avg == NOISE_HISTORY_NO_DATA) return;
+    if (a->n == 0 || min < a->min) a->min = min;
+    if (a->n == 0 || max > a->max) a->max = max;
+    a->sum += avg;
+    a->n++;
+}
+
+/* Toplayicinin ozeti; veri yoksa NO_DATA kaydi */
+static NoiseAggregate_t acc_result(const Acc_t *a)
+{
+    NoiseAggregate_t r = { NOISE_HISTORY_NO_DATA, NOISE_HISTORY_NO_DATA, NOISE_HISTORY_NO_DATA };
+    if (a->n > 0) {
+        r.min = a->min;
+        r.avg = (uint8_t)((a->sum + a->n / 2) / a->n);
+        r.max = a->max;
+    }
+    return r;
+}
+
+/* Toplayiciyi yeni dilime baslatir */
+static void acc_start(Acc_t *a, uint32_t slot)
+{
+    memset(a, 0, sizeof(*a));
+    a->slot = slot;
+}
+
+/* Biten saati saat katmanina yazar */
+static void close_hour(void)
+{
+    static const NoiseAggregate_t empty = { 0 };
+    NoiseAggregate_t agg = acc_result(&s_accHour);
+    tier_append(&s_tier[NOISE_TIER_HOUR], s_accHour.slot, (const uint8_t *)&agg, (const uint8_t *)&empty);
+}
+
+/* Biten dakikayi dakika katmanina yazar ve saatin toplayicisina ekler */
+static void close_minute(void)
+{
+    static const NoiseAggregate_t empty = { 0 };
+    NoiseAggregate_t agg = acc_result(&s_accMin);
+    tier_append(&s_tier[NOISE_TIER_MIN], s_accMin.slot, (const uint8_t *)&agg, (const uint8_t *)&empty);
+
+    uint32_t hour = s_accMin.slot / 60;
+    if (hour != s_accHour.slot) {
+        if (s_accHour.slot != NO_SLOT) close_hour();
+        acc_start(&s_accHour, hour);
+    }
+    acc_add(&s_accHour, agg.min, agg.avg, agg.max);
+}
+
+/* Bir saniyelik olcumu katmanlara isler; ayni saniyenin ikinci olcumu atlanir */
+static void add_sample(uint32_t now, uint8_t code)
+{
+    Tier_t *sec = &s_tier[NOISE_TIER_SEC];
+    if (sec->count > 0 && now == sec->last_slot) return;  // Dakika ortalamasi ve s_dirty saniyede bir artar
+    uint8_t fill = NOISE_HISTORY_NO_DATA;
+    if (sec->count > 0 && now > sec->last_slot && now - sec->last_slot <= NOISE_HISTORY_HOLD_S) {
+        fill = *tier_at(sec, 0);
+    }
+    tier_append(sec, now, &code, &fill);
+
+    uint32_t minute = now / 60;
+    if (minute != s_accMin.slot) {
+        if (s_accMin.slot != NO_SLOT) {
+            if (minute < s_accMin.slot) return;  // Saat geri gitti
+            close_minute();
+        }
+        acc_start(&s_accMin, minute);
+    }
+    acc_add(&s_accMin, code, code, code);
+    s_dirty++;
+}
+
+/* Dilimdeki kayit, toplanmakta olan dakika/saat dahil; veri yoksa false */
+static bool tier_get(NoiseTier_t tier, uint32_t slot, NoiseAggregate_t *out)
+{
+    const Acc_t *acc = (tier == NOISE_TIER_MIN) ? &s_accMin : (tier == NOISE_TIER_HOUR) ? &s_accHour : NULL;
+    if (acc != NULL && acc->n > 0 && slot == acc->slot) {
+        *out = acc_result(acc);
+        return true;
+    }
+    const Tier_t *t = &s_tier[tier];
+    if (t->count == 0 || slot > t->last_slot || t->last_slot - slot >= t->count) return false;
+    const uint8_t *rec = tier_at(t, t->last_slot - slot);
+    if (t->rec_size == 1) {
+        out->min = out->avg = out->max = rec[0];
+    } else {
+        memcpy(out, rec, sizeof(*out));
+    }
+    return out->avg != NOISE_HISTORY_NO_DATA;
+}
+
+/* Katmanin en eski dilimi; bos katmanda NO_SLOT */
+static uint32_t tier_oldest(NoiseTier_t tier)
+{
+    const Tier_t *t = &s_tier[tier];
+    if (t->count > 0) return t->last_slot - (t->count - 1);
+    if (tier == NOISE_TIER_MIN && s_accMin.n > 0) return s_accMin.slot;
+    if (tier == NOISE_TIER_HOUR && s_accHour.n > 0) return s_accHour.slot;
+    return NO_SLOT;
+}
+
+/* Katmanin en yeni dilimi; bos katmanda 0 */
+static uint32_t tier_newest(NoiseTier_t tier)
+{
+    const Tier_t *t = &s_tier[tier];
+    uint32_t newest = t->count > 0 ? t->last_slot : 0;
+    const Acc_t *acc = (tier == NOISE_TIER_MIN) ? &s_accMin : (tier == NOISE_TIER_HOUR) ? &s_accHour : NULL;
+    if (acc != NULL && acc->n > 0 && acc->slot > newest) newest = acc->slot;
+    return newest;
+}
+
+/* Katmanin en eski kaydinin zamani; bos katmanda UINT32_MAX */
+static uint32_t tier_oldest_time(NoiseTier_t tier)
+{
+    uint32_t slot = tier_oldest(tier);
+    return slot == NO_SLOT ? UINT32_MAX : slot * s_tier[tier].period_s;
+}
+
+/* Kontrol noktasi dosyasini okur ve dogrular; kayitlar halkalara okunur, basliklar cp'ye.
+   ESP_ERR_NOT_FOUND: dosya yok, ESP_ERR_INVALID_STATE: bicim uymuyor ya da saat geri gitmis */
+static esp_err_t load_checkpoint(const char *path, uint32_t now, Checkpoint_t *cp)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return ESP_ERR_NOT_FOUND;
+
+    bool ok = fread(cp, sizeof(*cp), 1, fp) == 1 && cp->magic == NOISE_HISTORY_MAGIC &&
+              cp->version == NOISE_HISTORY_VERSION;
+    for (int i = 0; ok && i < NOISE_TIER_COUNT; i++) {
+        ok = cp->len[i] == s_tier[i].len && cp->head[i] < cp->len[i] && cp->count[i] <= cp->len[i];
+    }
+    if (ok && cp->saved_at > now) {
+        ESP_LOGW(TAG_NOISE, "%s gelecekte (%lu > %lu), yok sayildi", path,
+                 (unsigned long)cp->saved_at, (unsigned long)now);
+        ok = false;
+    }
+    for (int i = 0; ok && i < NOISE_TIER_COUNT; i++) {
+        ok = fread(s_tier[i].rec, s_tier[i].rec_size, s_tier[i].len, fp) == s_tier[i].len;
+    }
+    fclose(fp);
+    return ok ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+/* Kontrol noktasini yukler; ana dosya yoksa ya da bozuksa yarim kalan degisimin gecici dosyasi denenir,
+   ikisi de uymuyorsa bos baslanir */
+static void restore_checkpoint(uint32_t now)
+{
+    Checkpoint_t cp;
+    esp_err_t err = load_checkpoint(NOISE_HISTORY_FILE_PATH, now, &cp);
+    if (err != ESP_OK && load_checkpoint(NOISE_HISTORY_TMP_PATH, now, &cp) == ESP_OK) {
+        // Kontrol noktasi remove ile rename arasinda kesilmis; gecici dosya tamdir, yerine tasinir
+        err = ESP_OK;
+        remove(NOISE_HISTORY_FILE_PATH);
+        if (rename(NOISE_HISTORY_TMP_PATH, NOISE_HISTORY_FILE_PATH) != 0) {
+            ESP_LOGW(TAG_NOISE, "%s tasinamadi", NOISE_HISTORY_TMP_PATH);
+        }
+        ESP_LOGW(TAG_NOISE, "%s kullanildi", NOISE_HISTORY_TMP_PATH);
+    }
+
+    if (err != ESP_OK) {
+        for (int i = 0; i < NOISE_TIER_COUNT; i++) s_tier[i].head = s_tier[i].count = 0;
+        acc_start(&s_accMin, NO_SLOT);
+        acc_start(&s_accHour, NO_SLOT);
+        if (err != ESP_ERR_NOT_FOUND) ESP_LOGW(TAG_NOISE, "%s okunamadi, gecmis bos basliyor", NOISE_HISTORY_FILE_PATH);
+        return;
+    }
+    for (int i = 0; i < NOISE_TIER_COUNT; i++) {
+        s_tier[i].head = cp.head[i];
+        s_tier[i].count = cp.count[i];
+        s_tier[i].last_slot = cp.last_slot[i];
+    }
+    s_accMin = cp.acc_min;
+    s_accHour = cp.acc_hour;
+    ESP_LOGI(TAG_NOISE, "Gecmis yuklendi: %u s, %u dk, %u sa; %lu s kapali kalmis",
+             s_tier[NOISE_TIER_SEC].count, s_tier[NOISE_TIER_MIN].count, s_tier[NOISE_TIER_HOUR].count,
+             (unsigned long)(now - cp.saved_at));
+}
+
+
+
+/**
+ * @brief Creates the lock, sets the time base and loads the last checkpoint from the SD card.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the lock could not be created.
+ *
+ * @details
+ * Call after init_sd_card() and after the RTC was read into currentTime_epoch; without a card the history
+ * starts empty. Calling the function again has no effect.
+ */
+esp_err_t NoiseHistory_Init(void)
+{
+    if (s_lock != NULL) return ESP_OK;
+
+    int64_t boot = (int64_t)currentTime_epoch - esp_timer_get_time() / 1000000;
+    s_bootEpoch = boot > 0 ? (uint32_t)boot : 0;
+
+    if (is_sd_card_mounted()) restore_checkpoint(NoiseHistory_Now());
+    s_lastCheckpointUs = esp_timer_get_time();
+
+    s_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL) {
+        ESP_LOGE(TAG_NOISE, "Kilit olusturulamadi");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG_NOISE, "Katmanlar: %d x 1 s, %d x 1 dk, %d x 1 sa (%u byte)",
+             NOISE_HISTORY_SEC_LEN, NOISE_HISTORY_MIN_LEN, NOISE_HISTORY_HOUR_LEN,
+             (unsigned)(sizeof(s_secRec) + sizeof(s_minRec) + sizeof(s_hourRec)));
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Returns the time base of the history.
+ *
+ * @return RTC epoch read at boot plus the uptime, in seconds.
+ */
+uint32_t NoiseHistory_Now(void)
+{
+    return s_bootEpoch + (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+
+
+/**
+ * @brief Records the ambient level of the current second.
+ *
+ * @param[in] db10 Level in dB SPL x10, stored with NOISE_HISTORY_STEP_DB10 resolution.
+ *
+ * @details
+ * Called from IO_Task when NoiseHistory_Now() moves to a new second. Only the first call of a second is
+ * stored, so a faster caller neither overweights the minute average nor inflates the checkpoint count.
+ * Never blocks: while a checkpoint holds the lock the value is kept and added on the next call. Seconds
+ * that were skipped by up to NOISE_HISTORY_HOLD_S repeat the previous value, longer gaps are stored as
+ * no data. Closing a minute or an hour costs one record write per tier.
+ */
+void NoiseHistory_Push(int16_t db10)
+{
+    if (s_lock == NULL) return;
+    uint32_t now = NoiseHistory_Now();
+    uint8_t code = db10_to_code(db10);
+
+    if (xSemaphoreTake(s_lock, 0) != pdTRUE) {
+        s_pending = true;
+        s_pendingCode = code;
+        s_pendingTime = now;
+        return;
+    }
+    if (s_pending) {
+        add_sample(s_pendingTime, s_pendingCode);
+        s_pending = false;
+    }
+    add_sample(now, code);
+    xSemaphoreGive(s_lock);
+}
+
+
+
+/**
+ * @brief Serves a time range at a bounded number of points from the coarsest sufficient tier.
+ *
+ * @param[in] from       Start of the range (epoch s, inclusive).
+ * @param[in] to         End of the range (epoch s, inclusive).
+ * @param[in] max_points Upper limit for the number of points.
+ * @param[in] visit      Called for every point, oldest first; points without data are skipped.
+ * @param[in] arg        Passed to visit.
+ * @return Period of one point in seconds, 0 if the range holds no data.
+ *
+ * @details
+ * The tier is the coarsest one whose period does not exceed (to - from) / max_points, moved to a coarser
+ * tier while the chosen one misses at least one record of that coarser tier at the start of the range.
+ * A point starts at its first slot; a slot that began before from is left out. Neighbouring records are merged (min of minima,
+ * mean of averages, max of maxima) until the count fits max_points. The work is proportional to the
+ * records of the chosen tier within the range. visit runs under the history lock and must not block.
+ */
+uint32_t NoiseHistory_Query(uint32_t from, uint32_t to, uint16_t max_points, NoiseHistoryVisit_t visit, void *arg)
+{
+    if (s_lock == NULL || to < from || max_points == 0 || visit == NULL) return 0;
+    uint32_t step = (to - from) / max_points;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    NoiseTier_t tier = NOISE_TIER_SEC;
+    while (tier + 1 < NOISE_TIER_COUNT && s_tier[tier + 1].period_s <= step) tier++;
+    // Ince katman baslangici en az bir kaba kayit boyu kaciriyorsa kaba katmana gecilir
+    while (tier + 1 < NOISE_TIER_COUNT && tier_oldest_time(tier) > from &&
+           tier_oldest_time(tier) - from >= s_tier[tier + 1].period_s &&
+           tier_oldest_time(tier + 1) < tier_oldest_time(tier)) {
+        tier++;
+    }
+
+    // Araliktan once baslayan yarim dilim alinmaz, son (toplanmakta olan) dilim alinir
+    uint32_t period = s_tier[tier].period_s;
+    uint32_t first = from / period + (from % period != 0), last = to / period;
+    uint32_t oldest = tier_oldest(tier), newest = tier_newest(tier);
+    if (oldest == NO_SLOT || first > newest || last < oldest || first > last) {
+        xSemaphoreGive(s_lock);
+        return 0;
+    }
+    if (first < oldest) first = oldest;
+    if (last > newest) last = newest;
+
+    uint32_t group = (last - first) / max_points + 1;  // ceil((last - first + 1) / max_points)
+    for (uint32_t g = first;; g += group) {
+        uint32_t end = (last - g >= group) ? g + group - 1 : last;
+        Acc_t acc = { 0 };
+        NoiseAggregate_t rec;
+        for (uint32_t s = g; s <= end; s++) {
+            if (tier_get(tier, s, &rec)) acc_add(&acc, rec.min, rec.avg, rec.max);
+        }
+        if (acc.n > 0) {
+            NoiseAggregate_t agg = acc_result(&acc);
+            NoisePoint_t p = {
+                .time = g * period,
+                .period_s = group * period,
+                .min_db10 = code_to_db10(agg.min),
+                .avg_db10 = code_to_db10(agg.avg),
+                .max_db10 = code_to_db10(agg.max),
+            };
+            visit(&p, arg);
+        }
+        if (end == last) break;
+    }
+
+    xSemaphoreGive(s_lock);
+    return group * period;
+}
+
+
+
+/**
+ * @brief Tells whether a checkpoint should be written now.
+ *
+ * @return true when new seconds were recorded, NOISE_HISTORY_CHECKPOINT_MS passed since the last
+ *         checkpoint and an SD card is mounted.
+ */
+bool NoiseHistory_CheckpointDue(void)
+{
+    if (s_lock == NULL || s_dirty == 0) return false;
+    if ((esp_timer_get_time() - s_lastCheckpointUs) < (int64_t)NOISE_HISTORY_CHECKPOINT_MS * 1000) return false;
+    return is_sd_card_mounted();
+}
+
+
+
+/**
+ * @brief Writes all tiers to the SD card.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE without a card or before NoiseHistory_Init(), ESP_FAIL on a write error.
+ *
+ * @details
+ * Called from FlashWrite_task. The rings (about 7 KB) are written under the history lock to
+ * NOISE_HISTORY_TMP_PATH, which is synced and then replaces NOISE_HISTORY_FILE_PATH. A cut between the
+ * removal and the rename leaves only the temporary file; NoiseHistory_Init() loads it from there. Pushes that
+ * arrive meanwhile are deferred, queries wait for the write.
+ */
+esp_err_t NoiseHistory_Checkpoint(void)
+{
+    if (s_lock == NULL || !is_sd_card_mounted()) return ESP_ERR_INVALID_STATE;
+    s_lastCheckpointUs = esp_timer_get_time();
+
+    FILE *fp = fopen(NOISE_HISTORY_TMP_PATH, "wb");
+    if (fp == NULL) {
+        ESP_LOGW(TAG_NOISE, "%s acilamadi", NOISE_HISTORY_TMP_PATH);
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    Checkpoint_t cp = {
+        .magic = NOISE_HISTORY_MAGIC,
+        .version = NOISE_HISTORY_VERSION,
+        .acc_min = s_accMin,
+        .acc_hour = s_accHour,
+        .saved_at = NoiseHistory_Now(),
+    };
+    for (int i = 0; i < NOISE_TIER_COUNT; i++) {
+        cp.len[i] = s_tier[i].len;
+        cp.head[i] = s_tier[i].head;
+        cp.count[i] = s_tier[i].count;
+        cp.last_slot[i] = s_tier[i].last_slot;
+    }
+    bool ok = fwrite(&cp, sizeof(cp), 1, fp) == 1;
+    for (int i = 0; ok && i < NOISE_TIER_COUNT; i++) {
+        ok = fwrite(s_tier[i].rec, s_tier[i].rec_size, s_tier[i].len, fp) == s_tier[i].len;
+    }
+    uint32_t saved = s_dirty;
+    xSemaphoreGive(s_lock);
+
+    // Eski dosya silinmeden once gecici dosya kartta tam olmali
+    if (ok && (fflush(fp) != 0 || fsync(fileno(fp)) != 0)) ok = false;
+    if (fclose(fp) != 0) ok = false;
+    if (ok) {
+        remove(NOISE_HISTORY_FILE_PATH);
+        ok = rename(NOISE_HISTORY_TMP_PATH, NOISE_HISTORY_FILE_PATH) == 0;
+    }
+    if (!ok) {
+        ESP_LOGE(TAG_NOISE, "Kontrol noktasi yazilamadi");
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_dirty -= saved;
+    xSemaphoreGive(s_lock);
+    ESP_LOGI(TAG_NOISE, "Kontrol noktasi yazildi (%lu yeni saniye)", (unsigned long)saved);
+    return ESP_OK;
+}
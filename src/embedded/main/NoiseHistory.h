@@ -0,0 +1,79 @@
+/*
+ * NoiseHistory.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_NOISEHISTORY_H_
+#define MAIN_NOISEHISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "SD_SPI.h"
+
+// Katman uzunluklari: 1 s x 300 = 5 dk, 1 dk x 1440 = 1 gun, 1 sa x 720 = 30 gun
+#ifndef NOISE_HISTORY_SEC_LEN
+#define NOISE_HISTORY_SEC_LEN       300
+#endif
+#ifndef NOISE_HISTORY_MIN_LEN
+#define NOISE_HISTORY_MIN_LEN       1440
+#endif
+#ifndef NOISE_HISTORY_HOUR_LEN
+#define NOISE_HISTORY_HOUR_LEN      720
+#endif
+
+// Saniye katmaninda bu kadar kisa bosluklar onceki degerle doldurulur (IO_Task zamanlama kaymasi)
+#define NOISE_HISTORY_HOLD_S        3
+
+// Kayitlardaki seviye kodu: 0.5 dB adim (0.5 - 127.5 dB), 0 = veri yok
+#define NOISE_HISTORY_STEP_DB10     5
+#define NOISE_HISTORY_NO_DATA       0
+
+// SD kontrol noktasi sikligi; kart yoksa atlanir
+#ifndef NOISE_HISTORY_CHECKPOINT_MS
+#define NOISE_HISTORY_CHECKPOINT_MS (10 * 60 * 1000)
+#endif
+
+// Bir sorgunun en fazla nokta sayisi; HTTP yaniti ~25 byte/nokta ile bellekte kurulur
+#ifndef NOISE_HISTORY_MAX_POINTS
+#define NOISE_HISTORY_MAX_POINTS    480
+#endif
+
+#define NOISE_HISTORY_FILE_PATH     MOUNT_POINT"/noise.bin"
+#define NOISE_HISTORY_TMP_PATH      MOUNT_POINT"/noise.tmp"
+
+typedef enum {
+    NOISE_TIER_SEC = 0,
+    NOISE_TIER_MIN,
+    NOISE_TIER_HOUR,
+    NOISE_TIER_COUNT
+} NoiseTier_t;
+
+// Dakika ve saat katmaninin kaydi, seviye kodlariyla 3 byte
+typedef struct {
+    uint8_t min;
+    uint8_t avg;
+    uint8_t max;
+} NoiseAggregate_t;
+
+// Sorgunun dondugu nokta
+typedef struct {
+    uint32_t time;          // Noktanin basi (epoch s)
+    uint32_t period_s;      // Noktanin kapsadigi sure
+    int16_t  min_db10;
+    int16_t  avg_db10;      // Alt kayitlarin dB ortalamasi
+    int16_t  max_db10;
+} NoisePoint_t;
+
+typedef void (*NoiseHistoryVisit_t)(const NoisePoint_t *point, void *arg);
+
+esp_err_t NoiseHistory_Init(void);
+uint32_t NoiseHistory_Now(void);
+void NoiseHistory_Push(int16_t db10);
+uint32_t NoiseHistory_Query(uint32_t from, uint32_t to, uint16_t max_points, NoiseHistoryVisit_t visit, void *arg);
+bool NoiseHistory_CheckpointDue(void);
+esp_err_t NoiseHistory_Checkpoint(void);
+
+#endif /* MAIN_NOISEHISTORY_H_ */
@@ -19,6 +19,9 @@
  
 #include "Plan.h"
 #include "mongoose_glue.h"
+#include "ClipCache.h"
+#include "Thread.h"
+#include <string.h>
 
 struct xCurrentConfiguration CurrentConfiguration;
 char CurrentPlan; //0,1,2,3 olabilir.
@@ -109,6 +112,8 @@ void GetCurrentPlan(void)
  * into the global CurrentConfiguration structure, based on the value of CurrentPlan.
  * Configuration includes sound parameters, volume levels, activity flags, and green action settings.
  *
+ * The clips needed by the resulting configuration are then queued for preloading into the ClipCache.
+ *
  * @note If CurrentPlan is not '0', '1', '2', or '3', no changes are made.
  *
  * @return None.
@@ -195,6 +200,19 @@ void GetCurrentConfiguration(void)
         CurrentConfiguration.greenCountTo      = s_alt3Configuration.greenCountTo;
         strcpy(CurrentConfiguration.greenAction, s_alt3Configuration.greenAction);
     }
+
+    // Plan veya ses ayarlari degistiyse gerekli klipleri RAM'e on yukle (degismediyse islem yapmaz)
+    ClipCache_PreloadConfiguration();
+
+    // Ayar gercekten degistiyse Process_Thread'i uyandir; saniyelik cagri degismeyen ayarda uyandirmaz
+    static struct xCurrentConfiguration s_notifiedConfiguration;
+    static char s_notifiedPlan = 0;
+    if (CurrentPlan != s_notifiedPlan ||
+        memcmp(&s_notifiedConfiguration, &CurrentConfiguration, sizeof(CurrentConfiguration)) != 0) {
+        s_notifiedConfiguration = CurrentConfiguration;
+        s_notifiedPlan = CurrentPlan;
+        ProcessThread_Notify(PROCESS_EVT_PLAN);
+    }
 }
 
 
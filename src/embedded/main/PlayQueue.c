@@ -0,0 +1,531 @@
+/*
+ * PlayQueue.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Priority playback queue that streams consecutive clips through one I2S session.
+ *
+ * Process_Thread enqueues clips with a per-clip gain, a priority and an optional completion callback;
+ * PlayWav_Task blocks in PlayQueue_RunSession() until something is queued. Clips are converted to the
+ * native output format while they are read and concatenated block by block into the audio pipeline, so a
+ * multi-part announcement is played without gaps; the stream is only closed when the queue runs empty, and
+ * the I2S channel keeps running with silence in between.
+ *
+ * Each priority maps to a voice of AudioMixer (idle, request, green/test). Clips of different lanes play
+ * at the same time: a green phase announcement starts immediately and the idle locator sound keeps running
+ * ducked underneath it, instead of being cut and restarted. Within a lane clips follow each other gaplessly.
+ * Enqueueing a clip still drops the pending (not yet started) clips of lower priority, which are stale.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "PlayQueue.h"
+#include "AudioPipeline.h"
+#include "AudioGain.h"
+#include "AudioMixer.h"
+#include "ImaAdpcm.h"
+#include "SpeakerDriver.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    char              file_path[PLAY_QUEUE_PATH_LEN];
+    float             gain;
+    PlayPriority_t    priority;
+    PlayQueueDoneCb_t on_done;
+    void             *cb_arg;
+    bool              completed;
+    bool              in_use;     // Bekliyor, caliyor veya tamamlanma bildirimi bekliyor
+} PlayQueueItem_t;
+
+static const char *TAG_QUEUE = "PLAY_QUEUE";
+
+static PlayQueueItem_t s_items[PLAY_QUEUE_LEN];
+static PlayQueueItem_t *s_pending[PLAY_QUEUE_LEN];  // Oncelige gore azalan, ayni oncelikte FIFO
+static size_t s_pendingCount = 0;
+static PlayQueueStats_t s_stats;
+static SemaphoreHandle_t s_queueMutex = NULL;
+static SemaphoreHandle_t s_wakeSem = NULL;
+static volatile bool s_sessionActive = false;
+static PlayQueueItem_t *volatile s_playing[AUDIO_MIXER_VOICES];  // Her seste calan klip
+static PlayQueueIdleCb_t s_idleCb = NULL;
+static char s_hint[AUDIO_MIXER_VOICES][PLAY_QUEUE_PATH_LEN];  // Her seste beklenen siradaki klip
+
+typedef struct {
+    PlayQueueItem_t *finished[PLAY_QUEUE_LEN];  // Son blokta biten klipler
+    size_t           n_finished;
+    uint32_t         clips;
+} MixSession_t;
+
+
+
+/* Bos havuz elemani doner, yoksa NULL. Kilit altinda cagrilmali. */
+static PlayQueueItem_t *alloc_item_locked(void)
+{
+    for (int i = 0; i < PLAY_QUEUE_LEN; i++) {
+        if (!s_items[i].in_use) {
+            s_items[i].in_use = true;
+            return &s_items[i];
+        }
+    }
+    return NULL;
+}
+
+/* Bos havuz elemani sayisi. Kilit altinda cagrilmali. */
+static size_t free_items_locked(void)
+{
+    size_t n = 0;
+    for (int i = 0; i < PLAY_QUEUE_LEN; i++) {
+        if (!s_items[i].in_use) n++;
+    }
+    return n;
+}
+
+/*
+ * priority'den dusuk bekleyenleri listeden cikarip dropped'a yazar, sayisini doner.
+ * Geri cagirmalar kilit disinda yapilmali. Kilit altinda cagrilmali.
+ */
+static size_t drop_lower_locked(PlayPriority_t priority, PlayQueueItem_t **dropped)
+{
+    size_t kept = 0, n = 0;
+    for (size_t i = 0; i < s_pendingCount; i++) {
+        if (s_pending[i]->priority < priority) {
+            dropped[n++] = s_pending[i];
+        } else {
+            s_pending[kept++] = s_pending[i];
+        }
+    }
+    s_pendingCount = kept;
+    s_stats.clips_aborted += n;
+    return n;
+}
+
+/* Oncelik sirasini bozmadan, ayni oncelikteki son elemanin arkasina ekler. Kilit altinda cagrilmali. */
+static void insert_locked(PlayQueueItem_t *item)
+{
+    size_t pos = s_pendingCount;
+    while (pos > 0 && s_pending[pos - 1]->priority < item->priority) {
+        s_pending[pos] = s_pending[pos - 1];
+        pos--;
+    }
+    s_pending[pos] = item;
+    s_pendingCount++;
+}
+
+/* Tamamlanma bildirimini yapar ve elemani havuza geri verir. */
+static void finish_item(PlayQueueItem_t *item, bool completed)
+{
+    if (item->on_done != NULL) {
+        item->on_done(item->file_path, completed, item->cb_arg);
+    }
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    if (completed) {
+        s_stats.clips_played++;
+    }
+    item->in_use = false;
+    xSemaphoreGive(s_queueMutex);
+}
+
+/* Klibin son blogu DMA'ya verilince AudioWriter_Task icinden cagrilir */
+static void item_done_hook(void *arg)
+{
+    PlayQueueItem_t *item = (PlayQueueItem_t *)arg;
+    finish_item(item, item->completed);
+}
+
+/* Oncelige karsilik gelen mikser sesi: 0 idle, 1 request, 2 yesil ve test ortak (bkz. PlayQueue.h) */
+static int lane_of(PlayPriority_t priority)
+{
+    return (priority >= AUDIO_MIXER_VOICES) ? AUDIO_MIXER_VOICES - 1 : (int)priority;
+}
+
+/* Seste calan klibi kilit altinda gunceller; PlayQueue_SetGain baska gorevden okur */
+static void set_playing(int lane, PlayQueueItem_t *item)
+{
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    s_playing[lane] = item;
+    xSemaphoreGive(s_queueMutex);
+}
+
+/* Verilen seste calinacak siradaki klibi listeden alir, yoksa NULL */
+static PlayQueueItem_t *pop_next_for_lane(int lane)
+{
+    PlayQueueItem_t *item = NULL;
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    for (size_t i = 0; i < s_pendingCount; i++) {
+        if (lane_of(s_pending[i]->priority) == lane) {
+            item = s_pending[i];
+            memmove(&s_pending[i], &s_pending[i + 1], (s_pendingCount - i - 1) * sizeof(s_pending[0]));
+            s_pendingCount--;
+            break;
+        }
+    }
+    xSemaphoreGive(s_queueMutex);
+    return item;
+}
+
+/* Sesin kuyruktaki siradaki klibini baslatir; acilamayan klipler atlanir */
+static bool start_lane(int lane, MixSession_t *sess)
+{
+    PlayQueueItem_t *item;
+    while ((item = pop_next_for_lane(lane)) != NULL) {
+        printf("[QUEUE] Caliniyor (ses %d): %s\n", lane, item->file_path);
+        if (AudioMixer_Start(lane, item->file_path, AudioGain_FactorToQ15(item->gain), item)) {
+            set_playing(lane, item);
+            sess->clips++;
+            return true;
+        }
+        s_stats.open_failures++;
+        finish_item(item, false);
+    }
+    return false;
+}
+
+/* Bos seslere bekleyen klipleri baslatir */
+static void fill_idle_lanes(MixSession_t *sess)
+{
+    for (int lane = 0; lane < AUDIO_MIXER_VOICES; lane++) {
+        if (!AudioMixer_IsActive(lane)) start_lane(lane, sess);
+    }
+}
+
+/* Render icinden: klip bitti, sinir blogu icin not al ve ayni seste siradakini baslat */
+static void on_clip_end(int voice, void *tag, void *ctx)
+{
+    MixSession_t *sess = (MixSession_t *)ctx;
+    PlayQueueItem_t *item = (PlayQueueItem_t *)tag;
+    item->completed = true;
+    set_playing(voice, NULL);
+    sess->finished[sess->n_finished++] = item;
+    start_lane(voice, sess);
+}
+
+/* Her ses icin siradaki klibi (kuyrukta bekleyen, yoksa ipucu) onceden acar */
+static void prefetch_lanes(void)
+{
+    char next[PLAY_QUEUE_PATH_LEN];
+    for (int lane = 0; lane < AUDIO_MIXER_VOICES; lane++) {
+        next[0] = '\0';
+        xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+        for (size_t i = 0; i < s_pendingCount; i++) {
+            if (lane_of(s_pending[i]->priority) == lane) {
+                snprintf(next, sizeof(next), "%s", s_pending[i]->file_path);
+                break;
+            }
+        }
+        if (next[0] == '\0') {
+            snprintf(next, sizeof(next), "%s", s_hint[lane]);
+        }
+        xSemaphoreGive(s_queueMutex);
+
+        if (next[0] != '\0') {
+            AudioMixer_Prefetch(lane, next);
+        } else {
+            AudioMixer_DropPrefetch(lane);
+        }
+    }
+}
+
+/* Oturum yarida kaldiginda calan klipleri tamamlanmamis olarak bildirir */
+static void on_clip_stopped(int voice, void *tag, void *ctx)
+{
+    (void)ctx;
+    set_playing(voice, NULL);
+    finish_item((PlayQueueItem_t *)tag, false);
+}
+
+
+
+/**
+ * @brief Creates the queue lock and the wake-up semaphore.
+ *
+ * Must be called before PlayWav_Task starts and before Process_Thread enqueues anything.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if a semaphore cannot be created.
+ */
+esp_err_t PlayQueue_Init(void)
+{
+    if (s_queueMutex != NULL) return ESP_OK;
+
+    s_queueMutex = xSemaphoreCreateMutex();
+    s_wakeSem = xSemaphoreCreateBinary();
+    if (s_queueMutex == NULL || s_wakeSem == NULL) {
+        ESP_LOGE(TAG_QUEUE, "Kuyruk semaforlari olusturulamadi");
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(s_items, 0, sizeof(s_items));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_pendingCount = 0;
+    ESP_LOGI(TAG_QUEUE, "Oynatma kuyrugu hazir (%d klip)", PLAY_QUEUE_LEN);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Queues a single clip for playback.
+ *
+ * @param[in] file_path Full path of the WAV file.
+ * @param[in] gain      Linear volume factor applied to this clip only.
+ * @param[in] priority  Clip priority, selects the mixer lane; pending clips of lower priority are dropped.
+ * @param[in] on_done   Optional completion callback (may be NULL).
+ * @param[in] cb_arg    User argument passed to on_done.
+ * @return true if the clip was queued, false if the queue is full or not initialised.
+ */
+bool PlayQueue_Enqueue(const char *file_path, float gain, PlayPriority_t priority,
+                       PlayQueueDoneCb_t on_done, void *cb_arg)
+{
+    return PlayQueue_EnqueueSequence(&file_path, 1, gain, priority, on_done, cb_arg);
+}
+
+
+
+/**
+ * @brief Queues several clips that must be played back to back, as one announcement.
+ *
+ * Either all clips are queued or none, so a multi-part message is never played half.
+ * The on_done callback is invoked once for every clip of the sequence.
+ *
+ * @param[in] file_paths Array of full WAV paths, in playback order.
+ * @param[in] count      Number of entries in file_paths.
+ * @param[in] gain       Linear volume factor applied to every clip of the sequence.
+ * @param[in] priority   Priority of the sequence, selects the mixer lane; pending clips of lower priority
+ *                       are dropped.
+ * @param[in] on_done    Optional completion callback (may be NULL).
+ * @param[in] cb_arg     User argument passed to on_done.
+ * @return true if the sequence was queued, false if it does not fit or the queue is not initialised.
+ */
+bool PlayQueue_EnqueueSequence(const char *const *file_paths, size_t count, float gain,
+                               PlayPriority_t priority, PlayQueueDoneCb_t on_done, void *cb_arg)
+{
+    PlayQueueItem_t *dropped[PLAY_QUEUE_LEN];
+    size_t n_dropped;
+
+    if (s_queueMutex == NULL || file_paths == NULL || count == 0) return false;
+
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    n_dropped = drop_lower_locked(priority, dropped);
+    xSemaphoreGive(s_queueMutex);
+
+    // Atilan elemanlar bildirim yapildiktan sonra havuza doner
+    for (size_t i = 0; i < n_dropped; i++) {
+        ESP_LOGI(TAG_QUEUE, "Dusuk oncelikli klip atildi: %s", dropped[i]->file_path);
+        finish_item(dropped[i], false);
+    }
+
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    if (free_items_locked() < count) {
+        xSemaphoreGive(s_queueMutex);
+        ESP_LOGW(TAG_QUEUE, "Kuyruk dolu, %u klip eklenemedi: %s", (unsigned)count, file_paths[0]);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        PlayQueueItem_t *item = alloc_item_locked();
+        snprintf(item->file_path, sizeof(item->file_path), "%s", file_paths[i]);
+        item->gain = gain;
+        item->priority = priority;
+        item->on_done = on_done;
+        item->cb_arg = cb_arg;
+        item->completed = false;
+        insert_locked(item);
+    }
+    xSemaphoreGive(s_queueMutex);
+
+    xSemaphoreGive(s_wakeSem);
+    return true;
+}
+
+
+
+/**
+ * @brief Changes the volume of the clip of a given priority while it plays.
+ *
+ * The mixer ramps to the new gain across the next output block, so this can be called periodically to
+ * follow the ambient noise level without audible steps. Has no effect if no clip of that priority is
+ * playing; pending clips keep the gain they were queued with.
+ *
+ * @param[in] priority Priority of the playing clip to adjust.
+ * @param[in] gain     New linear volume factor.
+ * @return true if a playing clip was adjusted.
+ */
+bool PlayQueue_SetGain(PlayPriority_t priority, float gain)
+{
+    int lane = lane_of(priority);
+    bool adjusted = false;
+
+    // Calan klip kilit altinda okunur, bu sirada bitip havuza donemez
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    PlayQueueItem_t *item = s_playing[lane];
+    if (item != NULL && item->priority == priority) {
+        item->gain = gain;
+        AudioMixer_SetGain(lane, AudioGain_FactorToQ15(gain));
+        adjusted = true;
+    }
+    xSemaphoreGive(s_queueMutex);
+    return adjusted;
+}
+
+
+
+/**
+ * @brief Tells the queue which clip is expected next for a priority.
+ *
+ * PlayWav_Task opens that clip and reads its first block ahead of time (AudioMixer_Prefetch), so it starts
+ * without SD latency when it is queued. The prefetch runs inside PlayQueue_RunSession(): after every
+ * rendered block during a session, and when this call wakes the task between sessions. The SD open
+ * and the first read therefore hold up the render loop once per new clip, and the blocks already queued in
+ * the audio pipeline have to cover that time. Clips already pending on the same lane take precedence over
+ * the hint. The hint stays until it is replaced, so a looping clip is prefetched again after every start.
+ *
+ * @param[in] priority  Priority (lane) the clip will be queued with.
+ * @param[in] file_path Full path of the expected clip, NULL to clear the hint.
+ */
+void PlayQueue_Hint(PlayPriority_t priority, const char *file_path)
+{
+    if (s_queueMutex == NULL) return;
+    int lane = lane_of(priority);
+    const char *path = (file_path != NULL) ? file_path : "";
+
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    bool changed = strcmp(s_hint[lane], path) != 0;
+    if (changed) {
+        snprintf(s_hint[lane], sizeof(s_hint[lane]), "%s", path);
+    }
+    xSemaphoreGive(s_queueMutex);
+
+    if (changed) {
+        xSemaphoreGive(s_wakeSem);  // Oturum disindaysa yazici gorev on okumayi simdi yapar
+    }
+}
+
+
+
+/**
+ * @brief Tells whether a clip is playing or waiting to be played.
+ *
+ * @return true while the queue holds a clip or an output session is still open.
+ */
+bool PlayQueue_IsBusy(void)
+{
+    return s_sessionActive || s_pendingCount > 0;
+}
+
+
+
+/**
+ * @brief Registers the function called when a session ends.
+ *
+ * @param[in] cb Idle callback, NULL to remove it.
+ */
+void PlayQueue_SetIdleCallback(PlayQueueIdleCb_t cb)
+{
+    s_idleCb = cb;
+}
+
+
+
+/**
+ * @brief Waits for queued clips and plays them as one continuous I2S stream.
+ *
+ * Blocks until at least one clip is queued, then mixes the lanes into pipeline blocks as long as any
+ * lane has a clip. A clip that ends inside a block is followed by the next clip of its lane in the same
+ * block, and a zero-length block carrying the completion hook is queued right after that block, so
+ * callbacks fire when the clip boundary reaches the DMA. Clips enqueued for an idle lane join the mix at
+ * the next block. When every lane runs empty the stream is closed, but the I2S channel keeps outputting
+ * silence. Called in a loop by PlayWav_Task.
+ */
+void PlayQueue_RunSession(void)
+{
+    while (s_pendingCount == 0) {
+        xSemaphoreTake(s_wakeSem, portMAX_DELAY);
+        if (s_pendingCount == 0) prefetch_lanes();  // Yalniz ipucu degisti
+    }
+
+    s_sessionActive = true;
+    s_stats.sessions++;
+
+    MixSession_t sess = { .n_finished = 0, .clips = 0 };
+    uint32_t underruns_before = AudioPipeline_GetUnderrunCount();
+
+    // Tum klipler yerel bicime donusturulur, I2S saati oturum boyunca degismez
+    init_i2s(AUDIO_NATIVE_SAMPLE_RATE, AUDIO_NATIVE_BITS, AUDIO_NATIVE_CHANNELS);
+    fill_idle_lanes(&sess);
+
+    while (AudioMixer_AnyActive()) {
+        AudioBlock_t *blk = AudioPipeline_GetFreeBlock(portMAX_DELAY);
+        if (blk == NULL) {
+            AudioMixer_Reset(on_clip_stopped, NULL);
+            break;
+        }
+
+        sess.n_finished = 0;
+        size_t samples = AudioMixer_Render((int16_t *)blk->data, AUDIO_PIPELINE_BLOCK_SIZE / AUDIO_NATIVE_FRAME_BYTES,
+                                           on_clip_end, &sess);
+        blk->len = samples * AUDIO_NATIVE_FRAME_BYTES;
+        AudioPipeline_SubmitBlock(blk);
+
+        // Bu blokta biten her klip icin bos sinir blogu
+        for (size_t i = 0; i < sess.n_finished; i++) {
+            AudioBlock_t *boundary = AudioPipeline_GetFreeBlock(portMAX_DELAY);
+            if (boundary == NULL) {
+                finish_item(sess.finished[i], false);
+                continue;
+            }
+            boundary->done_cb = item_done_hook;
+            boundary->done_arg = sess.finished[i];
+            AudioPipeline_SubmitBlock(boundary);
+        }
+
+        fill_idle_lanes(&sess);
+        prefetch_lanes();
+    }
+
+    SpeakerDriver_EndStream();
+    s_sessionActive = false;
+    if (s_idleCb != NULL && s_pendingCount == 0) {
+        s_idleCb();
+    }
+
+    AudioPipelineStats_t pipe;
+    AudioMixerStats_t mix;
+    AudioPipeline_GetStats(&pipe);
+    AudioMixer_GetStats(&mix);
+    printf("[QUEUE] Oturum bitti: %" PRIu32 " klip, underrun %" PRIu32 ", klip arasi bosluk son %" PRIu32
+           " us / ort %" PRIu32 " us / max %" PRIu32 " us, I2S yeniden ayar %" PRIu32 "\n",
+           sess.clips, AudioPipeline_GetUnderrunCount() - underruns_before, pipe.gap_last_us,
+           AudioPipeline_GetAvgClipGapUs(), pipe.gap_max_us, SpeakerDriver_GetReconfigCount());
+    printf("[QUEUE] Mikser: %.1f cycle/ornek, en fazla %" PRIu32 " ses ayni anda, on okuma isabet %" PRIu32
+           " / iskalama %" PRIu32 "\n",
+           AudioMixer_GetCyclesPerSample(), mix.max_voices, mix.prefetch_hits, mix.prefetch_misses);
+
+    ImaAdpcmStats_t adpcm;
+    ImaAdpcm_GetStats(&adpcm);
+    if (adpcm.blocks > 0) {
+        printf("[QUEUE] ADPCM cozucu: %.0f cycle/blok, %" PRIu32 " blok\n", ImaAdpcm_GetCyclesPerBlock(), adpcm.blocks);
+    }
+}
+
+
+
+/**
+ * @brief Copies the queue counters.
+ *
+ * @param[out] out Pointer to a structure receiving the statistics.
+ */
+void PlayQueue_GetStats(PlayQueueStats_t *out)
+{
+    if (out == NULL) return;
+    xSemaphoreTake(s_queueMutex, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_queueMutex);
+}
@@ -0,0 +1,72 @@
+/*
+ * PlayQueue.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_PLAYQUEUE_H_
+#define MAIN_PLAYQUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Ayni anda kuyrukta (calan dahil) bulunabilecek klip sayisi
+#ifndef PLAY_QUEUE_LEN
+#define PLAY_QUEUE_LEN          8
+#endif
+
+#define PLAY_QUEUE_PATH_LEN     60
+
+// Oncelik: her biri bir mikser sesine gider, yuksek oncelikli ses calarken dusukler bastirilir.
+// Yuksek oncelikli klip eklenince daha dusuk oncelikli bekleyenler atilir, calan klip kesilmez.
+// Mikserde 3 ses var, yesil ve test ayni sesi paylasir: test klibi bekleyen yesil klipleri atar ve
+// calan yesil klibin bitmesini bekler. Test yalniz web arayuzunden, kurulum sirasinda kullanilir.
+typedef enum {
+    PLAY_PRIO_IDLE = 0,
+    PLAY_PRIO_REQUEST,
+    PLAY_PRIO_GREEN,
+    PLAY_PRIO_TEST,
+} PlayPriority_t;
+
+/**
+ * Completion callback. Called once per clip. The calling task depends on the outcome:
+ * - completed = true: from the audio writer task, right after the last block of the clip was handed to
+ *   the I2S DMA.
+ * - completed = false, clip dropped for a higher priority one: from the task that called
+ *   PlayQueue_Enqueue() / PlayQueue_EnqueueSequence(), before that call returns.
+ * - completed = false, clip could not be opened or the session was cut: from PlayWav_Task
+ *   (PlayQueue_RunSession).
+ * Must not block in any of these tasks.
+ */
+typedef void (*PlayQueueDoneCb_t)(const char *file_path, bool completed, void *arg);
+
+/**
+ * Idle callback. Called from PlayWav_Task (PlayQueue_RunSession) once a session has ended, every block
+ * has been handed to the I2S DMA and no clip is pending, so waiters can react without polling
+ * PlayQueue_IsBusy(). Must not block.
+ */
+typedef void (*PlayQueueIdleCb_t)(void);
+
+typedef struct {
+    uint32_t clips_played;    // Sonuna kadar calinan klip
+    uint32_t clips_aborted;   // Yuksek oncelik nedeniyle baslamadan atilan klip
+    uint32_t open_failures;   // Acilamayan dosya
+    uint32_t sessions;        // I2S acilip kapanan oturum sayisi
+} PlayQueueStats_t;
+
+esp_err_t PlayQueue_Init(void);
+bool PlayQueue_Enqueue(const char *file_path, float gain, PlayPriority_t priority,
+                       PlayQueueDoneCb_t on_done, void *cb_arg);
+bool PlayQueue_EnqueueSequence(const char *const *file_paths, size_t count, float gain,
+                               PlayPriority_t priority, PlayQueueDoneCb_t on_done, void *cb_arg);
+bool PlayQueue_SetGain(PlayPriority_t priority, float gain);
+void PlayQueue_Hint(PlayPriority_t priority, const char *file_path);
+bool PlayQueue_IsBusy(void);
+void PlayQueue_SetIdleCallback(PlayQueueIdleCb_t cb);
+void PlayQueue_RunSession(void);
+void PlayQueue_GetStats(PlayQueueStats_t *out);
+
+#endif /* MAIN_PLAYQUEUE_H_ */
@@ -0,0 +1,251 @@
+/*
+ * RingStats.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Fixed-capacity sliding window with O(1) sum, min, max and bucketed percentiles.
+ *
+ * A window keeps its last `capacity` values in a ring. The running sum is adjusted by the value that
+ * enters and the one that leaves, so the mean costs no loop. Minimum and maximum come from two monotonic
+ * deques of ring slots: a new value removes every slot it dominates from the back, and the slot that
+ * leaves the window can only be at the front, so each value is pushed and popped once (amortised O(1)).
+ * Optional histogram buckets are incremented and decremented the same way; a percentile is read by
+ * walking the buckets, which is a query cost independent of the window length and accurate to one bucket.
+ *
+ * Storage is static and sized at compile time through RING_STATS_DEFINE. A window has one writer;
+ * readers in other tasks may see one push in progress, as with the plain arrays this replaces.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "RingStats.h"
+#include <string.h>
+
+
+
+/* Yuva indeksini halka icinde ilerletir */
+static inline uint16_t ring_next(const RingStats_t *rs, uint16_t i, uint16_t n)
+{
+    uint32_t j = (uint32_t)i + n;
+    return (uint16_t)(j >= rs->capacity ? j - rs->capacity : j);
+}
+
+/* Degerin kovasi; aralik disi degerler uc kovalara yazilir */
+static inline uint16_t bucket_of(const RingStats_t *rs, int32_t value)
+{
+    if (value < rs->bucket_min) return 0;
+    int32_t b = (value - rs->bucket_min) / rs->bucket_width;
+    return (uint16_t)(b >= rs->bucket_count ? rs->bucket_count - 1 : b);
+}
+
+
+
+/**
+ * @brief Sets the histogram range used by RingStats_Percentile().
+ *
+ * @param[in,out] rs           Window defined with a non-zero bucket count.
+ * @param[in]     bucket_min   Lower edge of the first bucket.
+ * @param[in]     bucket_width Width of every bucket; values beyond the last bucket are counted in it.
+ *
+ * @details
+ * Clears the window, since the existing counts would belong to other buckets.
+ */
+void RingStats_SetBuckets(RingStats_t *rs, int32_t bucket_min, int32_t bucket_width)
+{
+    rs->bucket_min = bucket_min;
+    rs->bucket_width = bucket_width > 0 ? bucket_width : 1;
+    RingStats_Reset(rs);
+}
+
+
+
+/**
+ * @brief Empties the window.
+ *
+ * @param[in,out] rs Window to clear.
+ */
+void RingStats_Reset(RingStats_t *rs)
+{
+    rs->count = 0;
+    rs->head = 0;
+    rs->min_head = rs->min_len = 0;
+    rs->max_head = rs->max_len = 0;
+    rs->sum = 0;
+    if (rs->buckets != NULL) memset(rs->buckets, 0, rs->bucket_count * sizeof(uint16_t));
+}
+
+
+
+/**
+ * @brief Fills the whole window with one value.
+ *
+ * @param[in,out] rs    Window to fill.
+ * @param[in]     value Value every slot receives, e.g. 0 so a chart starts with a full axis.
+ */
+void RingStats_Fill(RingStats_t *rs, int32_t value)
+{
+    RingStats_Reset(rs);
+    for (uint16_t i = 0; i < rs->capacity; i++) RingStats_Push(rs, value);
+}
+
+
+
+/**
+ * @brief Appends a value, dropping the oldest one when the window is full.
+ *
+ * @param[in,out] rs    Window to update.
+ * @param[in]     value New value.
+ *
+ * @details
+ * Amortised O(1): every value enters and leaves each deque at most once.
+ */
+void RingStats_Push(RingStats_t *rs, int32_t value)
+{
+    uint16_t slot = rs->head;
+
+    if (rs->count == rs->capacity) {
+        int32_t old = rs->values[slot];
+        rs->sum -= old;
+        // Pencereden cikan yuva kuyruklarda olsa olsa bastadir
+        if (rs->min_len > 0 && rs->min_q[rs->min_head] == slot) {
+            rs->min_head = ring_next(rs, rs->min_head, 1);
+            rs->min_len--;
+        }
+        if (rs->max_len > 0 && rs->max_q[rs->max_head] == slot) {
+            rs->max_head = ring_next(rs, rs->max_head, 1);
+            rs->max_len--;
+        }
+        if (rs->buckets != NULL) rs->buckets[bucket_of(rs, old)]--;
+    } else {
+        rs->count++;
+    }
+
+    rs->values[slot] = value;
+    rs->sum += value;
+
+    while (rs->min_len > 0 && rs->values[rs->min_q[ring_next(rs, rs->min_head, rs->min_len - 1)]] >= value) {
+        rs->min_len--;
+    }
+    rs->min_q[ring_next(rs, rs->min_head, rs->min_len)] = slot;
+    rs->min_len++;
+
+    while (rs->max_len > 0 && rs->values[rs->max_q[ring_next(rs, rs->max_head, rs->max_len - 1)]] <= value) {
+        rs->max_len--;
+    }
+    rs->max_q[ring_next(rs, rs->max_head, rs->max_len)] = slot;
+    rs->max_len++;
+
+    if (rs->buckets != NULL) rs->buckets[bucket_of(rs, value)]++;
+    rs->head = ring_next(rs, slot, 1);
+}
+
+
+
+/**
+ * @brief Returns the number of values in the window.
+ */
+uint16_t RingStats_Count(const RingStats_t *rs)
+{
+    return rs->count;
+}
+
+
+
+/**
+ * @brief Returns a value by age.
+ *
+ * @param[in] rs    Window to read.
+ * @param[in] index 0 for the oldest value, RingStats_Count() - 1 for the newest.
+ * @return The value, 0 if index is out of range.
+ */
+int32_t RingStats_Get(const RingStats_t *rs, uint16_t index)
+{
+    if (index >= rs->count) return 0;
+    return rs->values[ring_next(rs, rs->head, (uint16_t)(rs->capacity - rs->count + index))];
+}
+
+
+
+/**
+ * @brief Returns the newest value, 0 for an empty window.
+ */
+int32_t RingStats_Last(const RingStats_t *rs)
+{
+    return rs->count ? RingStats_Get(rs, rs->count - 1) : 0;
+}
+
+
+
+/**
+ * @brief Returns the smallest value in the window, 0 for an empty window.
+ */
+int32_t RingStats_Min(const RingStats_t *rs)
+{
+    return rs->min_len ? rs->values[rs->min_q[rs->min_head]] : 0;
+}
+
+
+
+/**
+ * @brief Returns the largest value in the window, 0 for an empty window.
+ */
+int32_t RingStats_Max(const RingStats_t *rs)
+{
+    return rs->max_len ? rs->values[rs->max_q[rs->max_head]] : 0;
+}
+
+
+
+/**
+ * @brief Returns the rounded mean of the window, 0 for an empty window.
+ */
+int32_t RingStats_Mean(const RingStats_t *rs)
+{
+    if (rs->count == 0) return 0;
+    int64_t half = rs->count / 2;
+    return (int32_t)((rs->sum >= 0 ? rs->sum + half : rs->sum - half) / rs->count);
+}
+
+
+
+/**
+ * @brief Returns the sum of the window.
+ */
+int64_t RingStats_Sum(const RingStats_t *rs)
+{
+    return rs->sum;
+}
+
+
+
+/**
+ * @brief Estimates a percentile from the histogram buckets.
+ *
+ * @param[in] rs      Window defined with buckets.
+ * @param[in] percent 0-100; 0 and 100 return the exact minimum and maximum.
+ * @return Centre of the bucket that holds the percentile, clamped to [min, max]. A window without
+ *         buckets returns its mean.
+ */
+int32_t RingStats_Percentile(const RingStats_t *rs, uint8_t percent)
+{
+    if (rs->count == 0) return 0;
+    if (percent == 0) return RingStats_Min(rs);
+    if (percent >= 100) return RingStats_Max(rs);
+    if (rs->buckets == NULL) return RingStats_Mean(rs);
+
+    uint32_t target = ((uint32_t)rs->count * percent + 99) / 100;  // Yukari yuvarlanmis sira
+    uint32_t seen = 0;
+    uint16_t b = 0;
+    for (; b < rs->bucket_count - 1; b++) {
+        seen += rs->buckets[b];
+        if (seen >= target) break;
+    }
+
+    int32_t value = rs->bucket_min + b * rs->bucket_width + rs->bucket_width / 2;
+    int32_t lo = RingStats_Min(rs), hi = RingStats_Max(rs);
+    return value < lo ? lo : (value > hi ? hi : value);
+}
@@ -0,0 +1,58 @@
+/*
+ * RingStats.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_RINGSTATS_H_
+#define MAIN_RINGSTATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Sabit kapasiteli pencere: toplam, min/max (monoton kuyruklar) ve yuzdelik icin kova sayaclari
+typedef struct {
+    int32_t  *values;           // Halka, en eski head'de (doluyken)
+    uint16_t *min_q;            // Artan degerli yuva indeksleri
+    uint16_t *max_q;            // Azalan degerli yuva indeksleri
+    uint16_t *buckets;          // Kova basina ornek sayisi; NULL ise yuzdelik yok
+    uint16_t capacity;
+    uint16_t count;
+    uint16_t head;              // Siradaki yazma yuvasi
+    uint16_t min_head, min_len;
+    uint16_t max_head, max_len;
+    uint16_t bucket_count;
+    int32_t  bucket_min;        // Ilk kovanin alt siniri
+    int32_t  bucket_width;
+    int64_t  sum;
+} RingStats_t;
+
+// Bir pencerenin depolamasini ve tanimini olusturur, ornek: RING_STATS_DEFINE(static, adc, 10, 0, 0, 1);
+// Kovasiz pencerede (nbuckets 0) yuzdelik yerine ortalama doner
+#define RING_STATS_DEFINE(storage, name, cap, nbuckets, bmin, bwidth)                   \
+    static int32_t  name##_values[(cap)];                                               \
+    static uint16_t name##_minq[(cap)];                                                 \
+    static uint16_t name##_maxq[(cap)];                                                 \
+    static uint16_t name##_buckets[(nbuckets) > 0 ? (nbuckets) : 1];                    \
+    storage RingStats_t name = {                                                        \
+        .values = name##_values, .min_q = name##_minq, .max_q = name##_maxq,            \
+        .buckets = (nbuckets) > 0 ? name##_buckets : NULL,                              \
+        .capacity = (cap), .bucket_count = (nbuckets),                                  \
+        .bucket_min = (bmin), .bucket_width = (bwidth),                                 \
+    }
+
+void RingStats_SetBuckets(RingStats_t *rs, int32_t bucket_min, int32_t bucket_width);
+void RingStats_Reset(RingStats_t *rs);
+void RingStats_Fill(RingStats_t *rs, int32_t value);
+void RingStats_Push(RingStats_t *rs, int32_t value);
+uint16_t RingStats_Count(const RingStats_t *rs);
+int32_t RingStats_Get(const RingStats_t *rs, uint16_t index);
+int32_t RingStats_Last(const RingStats_t *rs);
+int32_t RingStats_Min(const RingStats_t *rs);
+int32_t RingStats_Max(const RingStats_t *rs);
+int32_t RingStats_Mean(const RingStats_t *rs);
+int64_t RingStats_Sum(const RingStats_t *rs);
+int32_t RingStats_Percentile(const RingStats_t *rs, uint8_t percent);
+
+#endif /* MAIN_RINGSTATS_H_ */
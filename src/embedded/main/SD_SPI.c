@@ -31,6 +31,10 @@
 #include "mongoose.h"
 #include "Alarms.h"
 #include "SpeakerDriver.h"
+#include "WavIndex.h"
+#include "ClipCache.h"
+#include "TraceLog.h"
+#include "NoiseHistory.h"
 
 #if SOC_SDMMC_IO_POWER_EXTERNAL
 #include "sd_pwr_ctrl_by_on_chip_ldo.h"
@@ -40,6 +44,31 @@ static const char *TAG_SD = "SD_CHECK";
 #define EXAMPLE_MAX_CHAR_SIZE    64
 
 const char *TAGSD = "example";
+
+// Cihazin kendi yazdigi dosyalar: yazici gorevler acikken silinirse FAT bozulur (FATFS_FS_LOCK kapali)
+static const char *const s_deviceFiles[] = {
+    TRACE_FILE_PATH, TRACE_FILE_PREV_PATH, NOISE_HISTORY_FILE_PATH, NOISE_HISTORY_TMP_PATH,
+};
+
+
+
+/**
+ * @brief Checks whether a file name belongs to a file the device writes itself (trace, noise history).
+ *
+ * @param[in] name File name without the directory, compared case-insensitively as FAT does.
+ * @return true for trace.bin, trace1.bin, noise.bin and noise.tmp.
+ *
+ * @details
+ * Such files must not be deleted or overwritten from the web interface while their writer task may have
+ * them open; DeleteSDFile, ClearAllSDFiles and the upload handler refuse them.
+ */
+bool is_device_file(const char *name)
+{
+    for (size_t i = 0; i < sizeof(s_deviceFiles) / sizeof(s_deviceFiles[0]); i++) {
+        if (strcasecmp(name, strrchr(s_deviceFiles[i], '/') + 1) == 0) return true;
+    }
+    return false;
+}
  
 
 #ifdef CONFIG_EXAMPLE_DEBUG_PIN_CONNECTIONS
@@ -239,6 +268,9 @@ void init_sd_card(void)
     }
     ESP_LOGI(TAGSD, "Filesystem mounted");
 
+    // WAV indeksini bir kez olustur, sonra upload/silme ile guncel tutulur
+    WavIndex_Build();
+
     // Card has been initialized, print its properties
     sdmmc_card_print_info(stdout, card);
 
@@ -509,7 +541,9 @@ void CheckSDFiles(char *json_buffer, size_t buffer_size) {
         
         // Get file stats (modification time, size, etc.)
         if (stat(path, &file_stat) == 0) {
-            float duration = CheckWavDuration(path); // This correctly returns a float
+            // Indeksten, dosya acilmiyor; liste oynatmadaki gibi 0.5 s ekli sureyi gosterir
+            uint32_t duration_ms = WavIndex_GetDurationMs(path);
+            float duration = duration_ms ? duration_ms / 1000.0f + 0.5f : 0.0f;
 
             struct tm *timeinfo = localtime(&file_stat.st_mtime);
             char modtime_str[32];
@@ -612,9 +646,9 @@ void checkFileName(const char *filename) {
  * @file
  * @brief Deletes a file from the SD card unless it is a protected default file.
  *
- * Attempts to delete the file at the given path. If the path is NULL or the filename begins
- * with "default_", the operation is aborted and a warning is logged. Returns true on success,
- * false otherwise.
+ * Attempts to delete the file at the given path. If the path is NULL, the filename begins
+ * with "default_", or it is one of the files the device writes itself (trace and noise history),
+ * the operation is aborted and a warning is logged. Returns true on success, false otherwise.
  *
  * @param[in] file_path Full path to the file on the SD card.
  * @return bool True if the file was deleted, false otherwise.
@@ -641,6 +675,10 @@ bool DeleteSDFile(const char *file_path)
         ESP_LOGW(TAGSD, "Cannot delete protected file (starts with 'default_'): %s", file_path);
         return false;
     }
+    if (is_device_file(filename)) {
+        ESP_LOGW(TAGSD, "Cannot delete device file (trace/noise history): %s", file_path);
+        return false;
+    }
     
     // Check if file exists before attempting to delete
     FILE *f = fopen(file_path, "r");
@@ -653,6 +691,8 @@ bool DeleteSDFile(const char *file_path)
     // Delete the file
     if ((remove(file_path) == 0)) {
         ESP_LOGI(TAGSD, "File deleted successfully: %s", file_path);
+        WavIndex_Remove(file_path);
+        ClipCache_Invalidate(file_path);
         return true;
     } else {
         ESP_LOGE(TAGSD, "Failed to delete file: %s", file_path);
@@ -667,7 +707,8 @@ bool DeleteSDFile(const char *file_path)
  * @brief Deletes all files on the SD card with specific extensions, except protected files.
  *
  * Iterates through files in the SD card root directory. Deletes files matching certain extensions
- * (.txt, .wav, .mp3, .bin, .log, .dat, .cfg) unless their name starts with "default_".
+ * (.txt, .wav, .mp3, .bin, .log, .dat, .cfg) unless their name starts with "default_" or they are
+ * written by the device itself (trace.bin, trace1.bin, noise.bin, noise.tmp).
  * Tracks counts for deleted, protected, skipped, and error files. Logs the operation summary.
  *
  * @return bool True if all deletions were successful, false if any errors occurred.
@@ -706,7 +747,7 @@ bool ClearAllSDFiles(void)
         }
         
         // Check if filename starts with "default_"
-        if (strncmp(entry->d_name, "default_", 8) == 0) {
+        if (strncmp(entry->d_name, "default_", 8) == 0 || is_device_file(entry->d_name)) {
             ESP_LOGW(TAGSD, "Korunan dosya atlaniyor: %s", entry->d_name);
             protected_count++;
             continue;
@@ -741,6 +782,8 @@ bool ClearAllSDFiles(void)
         // Delete the file
         if (remove(file_path) == 0) {
             ESP_LOGI(TAGSD, "Dosya silindi: %s", entry->d_name);
+            WavIndex_Remove(entry->d_name);
+            ClipCache_Invalidate(entry->d_name);
             deleted_count++;
         } else {
             ESP_LOGE(TAGSD, "Dosya silinemedi: %s", entry->d_name);
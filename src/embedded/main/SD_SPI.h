@@ -42,5 +42,6 @@ void CheckSDFiles(char *json_buffer, size_t buffer_size);
 void checkFileName(const char *filename);
 bool DeleteSDFile(const char *file_path);
 bool ClearAllSDFiles(void);
+bool is_device_file(const char *name);
 
 #endif /* MAIN_SD_SPI_H_ */
@@ -0,0 +1,101 @@
+/*
+ * SoundPolicy.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Table-driven sound policy: which sound groups may play for a plan and the current inputs.
+ *
+ * The plan switches isIdleActive, idleContAfterReq and isReqActive are packed into a 3-bit index of the
+ * rule table below. Each rule gives the sound groups allowed without and with a pedestrian demand; a
+ * confirmed green (when the green sounds are enabled) overrides both and leaves only the green counter.
+ * SoundPolicy_Build() compiles the rule of the active plan into a 4-entry table indexed by the runtime
+ * inputs, so Process_Thread gets all flags with one lookup. A new policy is one more row, not another
+ * branch.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "SoundPolicy.h"
+
+#define I   SOUND_POLICY_IDLE
+#define R   SOUND_POLICY_REQUEST
+
+typedef struct {
+    uint8_t idle;       // Talep yokken
+    uint8_t demand;     // Talep varken
+} SoundPolicyRule_t;
+
+// Indeks: isIdleActive<<2 | idleContAfterReq<<1 | isReqActive
+static const SoundPolicyRule_t s_rules[8] = {
+    [0] = { 0, 0         },     // 000: ses yok
+    [1] = { 0, R         },     // 001: talepte request
+    [2] = { 0, I         },     // 010: talep gidene kadar idle
+    [3] = { 0, I | R     },     // 011: talepte idle + request
+    [4] = { I, 0         },     // 100: talep gelince idle kesilir
+    [5] = { I, R         },     // 101: talepte idle yerine request
+    [6] = { I, I         },     // 110: talepte idle devam eder
+    [7] = { I, I | R     },     // 111: talepte idle + request
+};
+
+// Onayli yesil tum sesleri keser, yalniz geri sayim kalir
+#define GREEN_OVERRIDE  SOUND_POLICY_GREEN_COUNTER
+
+#undef I
+#undef R
+
+
+
+/**
+ * @brief Packs the policy-relevant plan switches into a table key.
+ *
+ * @param[in] idle_active         isIdleActive of the plan.
+ * @param[in] idle_cont_after_req idleContAfterReq of the plan.
+ * @param[in] req_active          isReqActive of the plan.
+ * @param[in] green_active        isGreenActive of the plan.
+ * @return Key for SoundPolicy_Build().
+ */
+uint8_t SoundPolicy_Key(bool idle_active, bool idle_cont_after_req, bool req_active, bool green_active)
+{
+    return (uint8_t)((idle_active ? 4 : 0) | (idle_cont_after_req ? 2 : 0) | (req_active ? 1 : 0) |
+                     (green_active ? 8 : 0));
+}
+
+
+
+/**
+ * @brief Compiles the decision table for a plan.
+ *
+ * @param[out] policy Table to fill.
+ * @param[in]  key    Packed plan switches from SoundPolicy_Key().
+ */
+void SoundPolicy_Build(SoundPolicy_t *policy, uint8_t key)
+{
+    const SoundPolicyRule_t *rule = &s_rules[key & 7];
+    const bool green_active = (key & 8) != 0;
+
+    policy->key = key;
+    for (uint8_t in = 0; in < SOUND_POLICY_INPUTS; in++) {
+        bool demand = (in & 1) != 0;
+        bool green = (in & 2) != 0;
+        policy->table[in] = (green && green_active) ? GREEN_OVERRIDE : (demand ? rule->demand : rule->idle);
+    }
+}
+
+
+
+/**
+ * @brief Returns the sound groups allowed for the current inputs.
+ *
+ * @param[in] policy          Table built for the active plan.
+ * @param[in] demand_active   A pedestrian demand is pending.
+ * @param[in] green_confirmed The green lamp is confirmed on.
+ * @return SOUND_POLICY_* bits.
+ */
+uint8_t SoundPolicy_Decide(const SoundPolicy_t *policy, bool demand_active, bool green_confirmed)
+{
+    return policy->table[(demand_active ? 1 : 0) | (green_confirmed ? 2 : 0)];
+}
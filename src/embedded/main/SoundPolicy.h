@@ -0,0 +1,36 @@
+/*
+ * SoundPolicy.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_SOUNDPOLICY_H_
+#define MAIN_SOUNDPOLICY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Karar ciktisi bitleri
+#define SOUND_POLICY_IDLE           0x01    // Idle sesi calinabilir
+#define SOUND_POLICY_REQUEST        0x02    // Request sesleri calinabilir
+#define SOUND_POLICY_GREEN_COUNTER  0x04    // Yesil geri sayim calinabilir
+
+// Calisma zamani girdileri: talep (bit 0) ve onayli yesil (bit 1)
+#define SOUND_POLICY_INPUTS         4
+
+/**
+ * Decision table of the active plan. Built by SoundPolicy_Build() when the configuration changes; every
+ * decision afterwards is a single lookup. Has no ESP-IDF dependency, so it can be compiled and tested
+ * on the host.
+ */
+typedef struct {
+    uint8_t key;                            // Paketli ayar: idle<<2 | contAfterReq<<1 | req, green<<3
+    uint8_t table[SOUND_POLICY_INPUTS];     // Girdi indeksine gore karar bitleri
+} SoundPolicy_t;
+
+uint8_t SoundPolicy_Key(bool idle_active, bool idle_cont_after_req, bool req_active, bool green_active);
+void SoundPolicy_Build(SoundPolicy_t *policy, uint8_t key);
+uint8_t SoundPolicy_Decide(const SoundPolicy_t *policy, bool demand_active, bool green_confirmed);
+
+#endif /* MAIN_SOUNDPOLICY_H_ */
@@ -17,6 +17,9 @@
 
 #include "SpeakerDriver.h"
 #include "SD_SPI.h"
+#include "AudioPipeline.h"
+#include "ClipCache.h"
+#include "WavIndex.h"
 #include "driver/dac_types.h"
 #include "driver/i2s_common.h"
 #include "driver/ledc.h"
@@ -39,13 +42,14 @@ i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_1, I2S_ROLE_MAST
 
 bool I2S_Channel_Enable = false;
 bool I2S_Init_Enable = false;
+static bool s_i2sRunning = false;      // Kanal etkin, DMA calisiyor (bosta sessizlik)
+static uint32_t s_i2sRate = 0;         // Calisan kanalin bicimi
+static uint8_t s_i2sBits = 0;
+static uint8_t s_i2sChannels = 0;
+static uint32_t s_i2sReconfigs = 0;    // Bicim degisikligi nedeniyle yeniden ayar sayisi
 volatile float volume_factor = 0.02;  // Başlangıç seviyesi
-bool StopPlayWav = false; // Global değişken
 volatile bool is_idle_finished;
-volatile bool is_counter_voice_played;
 volatile bool is_voice_played;
-#define WAV_FILE_PATH "/sdcard/%d.wav"
-#define BUFFER_SIZE_I2S      4096    
 #define DAC_CHANNEL_1_GPIO 25
 static const char *TAG_DAC = "WAV_PLAYER";
 #define DAC_OUTPUT_PIN DAC_CHAN_0_GPIO_NUM // DAC_CHAN_0 için GPIO numarası (GPIO25)
@@ -63,19 +67,27 @@ typedef struct {
  * @brief Initializes and configures the I2S peripheral for audio output.
  *
  * This function allocates and configures an I2S TX channel with the specified sample rate, bit width, and number of channels.
- * It supports mono or stereo output and various bit depths. If the I2S channel is already initialized, it reconfigures clock, GPIO, and slot settings.
- * Finally, it enables the I2S channel for audio transmission.
+ * It supports mono or stereo output and various bit depths. The channel is created with auto_clear, so once enabled it
+ * stays running and the DMA outputs silence whenever no audio is queued. If the channel is already running with the
+ * requested format, nothing is done; only when the format differs is the channel stopped (after the queued audio has
+ * been played out), reconfigured and enabled again.
  *
- * @param[in] sample_rate      I2S sample rate in Hz (e.g. 44100, 48000)
+ * @param[in] sample_rate      I2S sample rate in Hz (e.g. 16000, 44100)
  * @param[in] bits_per_sample  Audio resolution: supported values are 8, 16, 24, or 32
  * @param[in] num_channels     Number of channels: 1 for mono, 2 for stereo
  * @return None
  */
 void init_i2s(uint32_t sample_rate, uint8_t bits_per_sample, uint8_t num_channels)
 {
+    // Kanal zaten bu bicimde calisiyorsa dokunma
+    if (s_i2sRunning && s_i2sRate == sample_rate && s_i2sBits == bits_per_sample && s_i2sChannels == num_channels) {
+        return;
+    }
+
     /* Allocate a new TX channel and get the handle of this channel */
     if(I2S_Channel_Enable==false)
     {
+		 chan_cfg.auto_clear = true;  // Veri yokken DMA sessizlik (sifir) gonderir
 		 i2s_new_channel(&chan_cfg, &tx_handle, NULL);
 		 I2S_Channel_Enable = true;
 	}
@@ -114,6 +126,17 @@ void init_i2s(uint32_t sample_rate, uint8_t bits_per_sample, uint8_t num_channel
     },
 };
 
+      // Bicim degisiyor: DMA'daki son ses calinsin, sonra kanal durdurulup yeniden ayarlanir
+      if (s_i2sRunning) {
+          uint32_t dma_ms = (chan_cfg.dma_desc_num * chan_cfg.dma_frame_num * 1000) / (s_i2sRate ? s_i2sRate : 1) + 1;
+          vTaskDelay(pdMS_TO_TICKS(dma_ms) + 1);
+          i2s_channel_disable(tx_handle);
+          s_i2sRunning = false;
+          s_i2sReconfigs++;
+          printf("I2S yeniden ayarlaniyor: %" PRIu32 " Hz %u bit %u kanal -> %" PRIu32 " Hz %u bit %u kanal\n",
+                 s_i2sRate, s_i2sBits, s_i2sChannels, sample_rate, bits_per_sample, num_channels);
+      }
+
       /* Initialize the channel */
       if(I2S_Init_Enable == false)
       {
@@ -126,529 +149,260 @@ void init_i2s(uint32_t sample_rate, uint8_t bits_per_sample, uint8_t num_channel
 	  i2s_channel_reconfig_std_gpio(tx_handle, &std_cfg.gpio_cfg);
 	  i2s_channel_reconfig_std_slot(tx_handle, &std_cfg.slot_cfg);
       }
- i2s_channel_enable(tx_handle);
+ if (i2s_channel_enable(tx_handle) == ESP_OK) {
+     s_i2sRunning = true;
+     s_i2sRate = sample_rate;
+     s_i2sBits = bits_per_sample;
+     s_i2sChannels = num_channels;
+ }
 }
 
 
 
- /**
- * @file
- * @brief Plays a WAV file through the I2S interface in idle mode.
- *
- * This function opens a WAV file, parses its header, initializes the I2S interface,
- * applies volume adjustment, and streams audio data to the I2S peripheral.
- * Supports 8, 16, 24, and 32 bit PCM WAV files. Handles mono and stereo channels.
- * Automatically frees allocated buffers and disables the I2S channel after playback.
+/**
+ * @brief Returns how many times the running I2S channel had to be reconfigured for a new format.
  *
- * @param[in] file_path Full path to the WAV file to be played.
- * @return None
+ * @return Reconfiguration count since boot.
  */
-void play_wav_idle(const char *file_path) {
-	
-	FILE *wav_file = fopen(file_path, "rb");
-    if (!wav_file) {
-        printf("WAV dosyasi acilamadi: %s (errno=%d -> %s)\n",
-           file_path, errno, strerror(errno));
-    return;
-    }
-
-    uint8_t header[WAV_HEADER_SIZE];
-    if (fread(header, 1, WAV_HEADER_SIZE, wav_file) != WAV_HEADER_SIZE) {
-        printf("WAV basligi okunamadi veya eksik!\n");
-        fclose(wav_file);
-        return;
-    }
-   // Validate the WAV header
-    if (strncmp((char *)header, "RIFF", 4) != 0 || strncmp((char *)&header[8], "WAVE", 4) != 0) {
-        printf("Gecersiz WAV dosyasi!\n");
-        fclose(wav_file);
-        return;
-    }
-    uint32_t sample_rate = *(uint32_t*)&header[24];  // 24. bayttan itibaren örnekleme hızı
-    uint16_t bits_per_sample = *(uint16_t*)&header[34];  // 34. bayttan itibaren bit derinliği
-    uint16_t num_channels = *(uint16_t*)&header[22]; 
-
-    if (num_channels == 1) {
-     printf("Ses dosyasi MONO\n");
-    } else if (num_channels == 2) {
-    printf("Ses dosyasi STEREO\n");
-    } else {
-    num_channels = 1;
-    printf("Bilinmeyen kanal sayisi: %u\n", num_channels);
-   }
-
-    printf("Ornekleme Hizi: %" PRIu32 " Hz, Bit Derinligi: %" PRIu16 " bit\n", sample_rate, bits_per_sample);
-    init_i2s(sample_rate, bits_per_sample,num_channels);  // I2S başlat
-
-    uint8_t *buffer = (uint8_t *)malloc(BUFFER_SIZE_I2S);
-    size_t bytes_read, bytes_written;
-
-    while ((bytes_read = fread(buffer, 1, BUFFER_SIZE_I2S, wav_file)) > 0) {
-		
-       if (bits_per_sample == 16) {
-        int16_t *sample_buffer = (int16_t *)buffer;
-        size_t sample_count = bytes_read / 2;
-
-         for (size_t i = 0; i < sample_count; i++) {
-            int32_t sample = (int32_t)(sample_buffer[i] * volume_factor);
-
-            // 16-bit için sınır kontrolü
-            if (sample > INT16_MAX) sample = INT16_MAX;
-            if (sample < INT16_MIN) sample = INT16_MIN;
-
-            sample_buffer[i] = (int16_t)sample;
-         }
-        } else if (bits_per_sample == 8) {
-        uint8_t *sample_buffer = buffer;
-        size_t sample_count = bytes_read;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int16_t sample = (int16_t)(sample_buffer[i] - 128); // 8-bit PCM offset düzeltme
-            sample = (int16_t)(sample * volume_factor);
-
-            if (sample < -128) sample = -128;
-            if (sample > 127) sample = 127;
-
-            sample_buffer[i] = (uint8_t)(sample + 128);
-          }
-         } else if (bits_per_sample == 24) {
-            size_t sample_count = bytes_read / 3;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int32_t sample = (buffer[i * 3] | (buffer[i * 3 + 1] << 8) | (buffer[i * 3 + 2] << 16));
-
-            if (sample & 0x800000) sample |= 0xFF000000; // İşaret genişletme (sign extension)
-
-            sample = (int32_t)(sample * volume_factor);
-
-            if (sample > 8388607) sample = 8388607; // 24-bit maksimum
-            if (sample < -8388608) sample = -8388608; // 24-bit minimum
+uint32_t SpeakerDriver_GetReconfigCount(void)
+{
+    return s_i2sReconfigs;
+}
 
-            buffer[i * 3] = sample & 0xFF;
-            buffer[i * 3 + 1] = (sample >> 8) & 0xFF;
-            buffer[i * 3 + 2] = (sample >> 16) & 0xFF;
-        }
-        } else if (bits_per_sample == 32) {
-        int32_t *sample_buffer = (int32_t *)buffer;
-        size_t sample_count = bytes_read / 4;
 
-        for (size_t i = 0; i < sample_count; i++) {
-            int64_t sample = (int64_t)(sample_buffer[i] * volume_factor);
 
-            if (sample > INT32_MAX) sample = INT32_MAX;
-            if (sample < INT32_MIN) sample = INT32_MIN;
-            sample_buffer[i] = (int32_t)sample;
+/* Klip bicimi icin cozucu ve donusturucuyu hazirlar, desteklenmeyen bicimde kaynagi kapatir */
+static bool OpenConverter(ClipSource_t *src, const char *file_path)
+{
+    uint16_t channels = (src->num_channels == 2) ? 2 : 1;
+    uint16_t bits = src->bits_per_sample;
+
+    src->compressed = (src->audio_format == WAV_FORMAT_IMA_ADPCM);
+    if (src->compressed) {
+        if (!ImaAdpcm_Init(&src->adpcm, src->num_channels, src->block_align)) {
+            printf("Desteklenmeyen ADPCM bicimi: %s (%u kanal, blok %u)\n", file_path, src->num_channels, src->block_align);
+            SpeakerDriver_CloseClip(src);
+            return false;
         }
+        bits = 16;  // Cozucu cikisi
     }
-       
-        // I2S'e yaz
-        size_t bytes_to_write = bytes_read;
-        esp_err_t ret = i2s_channel_write(tx_handle, buffer, bytes_to_write, &bytes_written, portMAX_DELAY);
-        if (ret != ESP_OK) {
-            printf("I2S yazma hatası!\n");
-            break;
+    if (!AudioConvert_Init(&src->conv, src->sample_rate, bits, channels)) {
+        printf("Desteklenmeyen WAV bicimi: %s (%" PRIu32 " Hz, %u bit, %u kanal)\n",
+               file_path, src->sample_rate, src->bits_per_sample, src->num_channels);
+        SpeakerDriver_CloseClip(src);
+        return false;
+    }
+    return true;
+}
+
+/* IMA-ADPCM klipten yerel PCM okur: ham blok -> 16-bit PCM -> donusturucu */
+static size_t ReadAdpcm(ClipSource_t *src, uint8_t *dst, size_t max)
+{
+    static uint8_t s_adpcmRaw[SPEAKER_READ_SCRATCH_BYTES / 4];  // 4 bit/ornek: tam dolu PCM tamponuna yeter
+    static int16_t s_adpcmPcm[SPEAKER_READ_SCRATCH_BYTES / 2];
+    const size_t frame = src->conv.in_frame_bytes;
+    size_t out = 0;
+
+    while (out == 0) {
+        size_t pcm_room = AudioConvert_InputBytesFor(&src->conv, max);
+        if (!src->conv.passthrough && pcm_room > sizeof(s_adpcmPcm)) pcm_room = sizeof(s_adpcmPcm);
+        size_t avail = src->remaining;
+        if (src->cached == NULL && avail > sizeof(s_adpcmRaw)) avail = sizeof(s_adpcmRaw);
+
+        size_t want = ImaAdpcm_InputBytesFor(&src->adpcm, pcm_room / frame, avail);
+        if (want == 0) return 0;
+
+        const uint8_t *in;
+        if (src->cached != NULL) {
+            in = src->pcm;
+            src->pcm += want;
+        } else {
+            want = fread(s_adpcmRaw, 1, want, src->file);
+            if (want == 0) return 0;
+            in = s_adpcmRaw;
         }
+        src->remaining -= want;
+
+        // Yerel bicimdeki ADPCM dogrudan hedefe cozulur
+        int16_t *pcm = src->conv.passthrough ? (int16_t *)dst : s_adpcmPcm;
+        size_t frames = ImaAdpcm_Decode(&src->adpcm, in, want, pcm);
+        out = src->conv.passthrough ? frames * frame
+                                    : AudioConvert_Process(&src->conv, (const uint8_t *)pcm, frames * frame, (int16_t *)dst);
     }
-    i2s_channel_disable(tx_handle);
-    free(buffer);
-    fclose(wav_file);
-    printf("WAV dosyasi oynatildi ve buffer bosaltildi!\n");
- 
+    return out;
 }
- 
 
 
- /**
- * @file
- * @brief Plays a WAV file through the I2S interface, ensuring buffer flush after playback.
+
+/**
+ * @brief Opens a clip for streaming, from the RAM clip cache if possible, otherwise from SD.
  *
- * Opens a WAV file, parses its header, initializes the I2S interface, applies volume adjustment,
- * and streams audio to the I2S peripheral. Supports 8/16/24/32 bit PCM, mono/stereo. 
- * After playback, flushes the I2S buffer with zeros and waits to ensure complete playback.
- * Frees resources and disables the I2S channel at the end.
+ * When the file is in the WAV index, the data chunk location and length are taken from there so that
+ * trailing metadata chunks are never played as noise; otherwise the classic 44-byte header is assumed.
+ * IMA-ADPCM clips must be in the index, since their data chunk is not at a fixed offset. A decoder and a
+ * format converter are attached so that SpeakerDriver_ReadClip() always returns native PCM.
  *
- * @param[in] file_path Full path to the WAV file to be played.
- * @return None
+ * @param[in]  file_path Full path to the WAV file.
+ * @param[out] src       Clip source to initialise.
+ * @return true on success, false if the file cannot be opened or is not a WAV file.
  */
-void play_wav(const char *file_path) {
-	
-	FILE *wav_file = fopen(file_path, "rb");
-    if (!wav_file) {
+bool SpeakerDriver_OpenClip(const char *file_path, ClipSource_t *src)
+{
+    memset(src, 0, sizeof(*src));
+
+    // Klip RAM onbellegindeyse SD karta hic dokunmadan oradan cal
+    src->cached = ClipCache_Acquire(file_path);
+    if (src->cached != NULL) {
+        src->sample_rate = src->cached->sample_rate;
+        src->bits_per_sample = src->cached->bits_per_sample;
+        src->num_channels = src->cached->num_channels;
+        src->audio_format = src->cached->audio_format;
+        src->block_align = src->cached->block_align;
+        src->pcm = src->cached->pcm;
+        src->remaining = src->cached->len;
+        return OpenConverter(src, file_path);
+    }
+
+    src->file = fopen(file_path, "rb");
+    if (!src->file) {
         printf("WAV dosyasi acilamadi: %s (errno=%d -> %s)\n",file_path, errno, strerror(errno));
-    return;
+        return false;
+    }
+
+    WavInfo_t info;
+    if (WavIndex_Lookup(file_path, &info) && fseek(src->file, (long)info.data_offset, SEEK_SET) == 0) {
+        src->sample_rate = info.sample_rate;
+        src->bits_per_sample = info.bits_per_sample;
+        src->num_channels = info.num_channels;
+        src->audio_format = info.audio_format;
+        src->block_align = info.block_align;
+        src->remaining = info.data_length;
+        return OpenConverter(src, file_path);
     }
+
     uint8_t header[WAV_HEADER_SIZE];
-    if (fread(header, 1, WAV_HEADER_SIZE, wav_file) != WAV_HEADER_SIZE) {
+    if (fseek(src->file, 0, SEEK_SET) != 0 || fread(header, 1, WAV_HEADER_SIZE, src->file) != WAV_HEADER_SIZE) {
         printf("WAV basligi okunamadi veya eksik!\n");
-        fclose(wav_file);
-        return;
+        SpeakerDriver_CloseClip(src);
+        return false;
     }
    // Validate the WAV header
     if (strncmp((char *)header, "RIFF", 4) != 0 || strncmp((char *)&header[8], "WAVE", 4) != 0) {
         printf("Gecersiz WAV dosyasi!\n");
-        fclose(wav_file);
-        return;
-    }
-    uint32_t sample_rate = *(uint32_t*)&header[24];  // 24. bayttan itibaren örnekleme hızı
-    uint16_t bits_per_sample = *(uint16_t*)&header[34];  // 34. bayttan itibaren bit derinliği
-    uint16_t num_channels = *(uint16_t*)&header[22]; 
-
-    if (num_channels == 1) {
-     printf("Ses dosyasi MONO\n");
-    } else if (num_channels == 2) {
-    printf("Ses dosyasi STEREO\n");
-    } else {
-    num_channels = 1;
-    printf("Bilinmeyen kanal sayisi: %u\n", num_channels);
-   }
-
-    printf("Ornekleme Hizi: %" PRIu32 " Hz, Bit Derinligi: %" PRIu16 " bit\n", sample_rate, bits_per_sample);
-    init_i2s(sample_rate, bits_per_sample,num_channels);  // I2S başlat
-
-    uint8_t *buffer = (uint8_t *)malloc(BUFFER_SIZE_I2S);
-    size_t bytes_read, bytes_written;
-
-    while ((bytes_read = fread(buffer, 1, BUFFER_SIZE_I2S, wav_file)) > 0) {
-		
-       if (bits_per_sample == 16) {
-        int16_t *sample_buffer = (int16_t *)buffer;
-        size_t sample_count = bytes_read / 2;
-
-         for (size_t i = 0; i < sample_count; i++) {
-            int32_t sample = (int32_t)(sample_buffer[i] * volume_factor);
-
-            // 16-bit için sınır kontrolü
-            if (sample > INT16_MAX) sample = INT16_MAX;
-            if (sample < INT16_MIN) sample = INT16_MIN;
-
-            sample_buffer[i] = (int16_t)sample;
-         }
-        } else if (bits_per_sample == 8) {
-        uint8_t *sample_buffer = buffer;
-        size_t sample_count = bytes_read;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int16_t sample = (int16_t)(sample_buffer[i] - 128); // 8-bit PCM offset düzeltme
-            sample = (int16_t)(sample * volume_factor);
-
-            if (sample < -128) sample = -128;
-            if (sample > 127) sample = 127;
-
-            sample_buffer[i] = (uint8_t)(sample + 128);
-          }
-         } else if (bits_per_sample == 24) {
-            size_t sample_count = bytes_read / 3;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int32_t sample = (buffer[i * 3] | (buffer[i * 3 + 1] << 8) | (buffer[i * 3 + 2] << 16));
-
-            if (sample & 0x800000) sample |= 0xFF000000; // İşaret genişletme (sign extension)
-
-            sample = (int32_t)(sample * volume_factor);
-
-            if (sample > 8388607) sample = 8388607; // 24-bit maksimum
-            if (sample < -8388608) sample = -8388608; // 24-bit minimum
-
-            buffer[i * 3] = sample & 0xFF;
-            buffer[i * 3 + 1] = (sample >> 8) & 0xFF;
-            buffer[i * 3 + 2] = (sample >> 16) & 0xFF;
-        }
-        } else if (bits_per_sample == 32) {
-        int32_t *sample_buffer = (int32_t *)buffer;
-        size_t sample_count = bytes_read / 4;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int64_t sample = (int64_t)(sample_buffer[i] * volume_factor);
-
-            if (sample > INT32_MAX) sample = INT32_MAX;
-            if (sample < INT32_MIN) sample = INT32_MIN;
-            sample_buffer[i] = (int32_t)sample;
-        }
-    }
-       
-        // I2S'e yaz
-        size_t bytes_to_write = bytes_read;
-        esp_err_t ret = i2s_channel_write(tx_handle, buffer, bytes_to_write, &bytes_written, portMAX_DELAY);
-        if (ret != ESP_OK) {
-            printf("I2S yazma hatası!\n");
-            break;
-        }
+        SpeakerDriver_CloseClip(src);
+        return false;
     }
-        // *** KRİTİK: I2S BUFFER'INI TAM BOŞALT ***
-    printf("I2S buffer bosaltiliyor...\n");
-    
-    // Flush buffer ile sıfır gönder
-    uint8_t *zero_buffer = (uint8_t *)calloc(BUFFER_SIZE_I2S, 1);
-    if (zero_buffer != NULL) {
-        size_t zero_written;
-        esp_err_t flush_ret = i2s_channel_write(tx_handle, zero_buffer, BUFFER_SIZE_I2S, &zero_written, 
-                                               pdMS_TO_TICKS(500));  // 500ms timeout
-        printf("Flush buffer yazildi: %zu bytes (ret: %s)\n", zero_written, esp_err_to_name(flush_ret));
-        free(zero_buffer);
+    src->sample_rate = *(uint32_t*)&header[24];  // 24. bayttan itibaren örnekleme hızı
+    src->bits_per_sample = *(uint16_t*)&header[34];  // 34. bayttan itibaren bit derinliği
+    src->num_channels = *(uint16_t*)&header[22];
+    src->audio_format = *(uint16_t*)&header[20];
+    if (src->audio_format == WAV_FORMAT_IMA_ADPCM) {
+        printf("Indekste olmayan ADPCM dosyasi calinamaz: %s\n", file_path);
+        SpeakerDriver_CloseClip(src);
+        return false;
     }
-    
-    // Buffer'ın tamamen boşalması için bekle
-    vTaskDelay(pdMS_TO_TICKS(200)); // 200ms bekle - SES TAMAMEN BİTSİN
-    
-    i2s_channel_disable(tx_handle);
-    free(buffer);
-    fclose(wav_file);
-    printf("WAV dosyasi oynatildi ve buffer bosaltildi!\n");
+    src->remaining = UINT32_MAX;  // Indekste yok: dosya sonuna kadar oku
+    return OpenConverter(src, file_path);
 }
- 
-
-
 
 
 
 /**
- * @file
- * @brief Calculates the duration (in seconds) of a WAV file by parsing its header.
+ * @brief Reads the next chunk of unscaled PCM from an open clip, converted to the native format.
  *
- * Opens the WAV file, checks the RIFF and WAVE header, reads the "fmt " and "data" chunks,
- * and computes the duration of the audio data in seconds. Returns 0 in case of any errors.
+ * Clips already in the native format are read straight into dst. Other clips are read into a scratch
+ * buffer (or taken from the cache) and converted, so the output is always AUDIO_NATIVE_BITS mono at
+ * AUDIO_NATIVE_SAMPLE_RATE. IMA-ADPCM clips are decoded first, a quarter of the bytes per second of PCM.
+ * Only one reader (PlayWav_Task) may use this at a time.
  *
- * @param[in] file_path Full path to the WAV file to check.
- * @return float Duration of the WAV file in seconds (rounded to the nearest second), or 0 on error.
+ * @param[in,out] src Clip source opened with SpeakerDriver_OpenClip().
+ * @param[out]    dst Destination buffer.
+ * @param[in]     max Capacity of dst in bytes.
+ * @return Number of native PCM bytes written, 0 at the end of the clip.
  */
-float  CheckWavDuration(char *file_path)
+size_t SpeakerDriver_ReadClip(ClipSource_t *src, uint8_t *dst, size_t max)
 {
-    FILE *wav_file = fopen(file_path, "rb");
-    if (!wav_file) {
-        printf("Hata: WAV dosyasi acilamadi! -> %s\n", file_path);
-        return 0;
-    }
+    static uint8_t s_readScratch[SPEAKER_READ_SCRATCH_BYTES];
+    const size_t frame = src->conv.in_frame_bytes;
+    size_t out = 0;
 
-    // Gerekli başlık bilgilerini okumak için bir tampon
-    uint8_t header[44];
-    if (fread(header, 1, 12, wav_file) != 12) {
-        printf("Hata: Gecersiz RIFF basligi!\n");
-        fclose(wav_file);
-        return 0;
-    }
+    if (src->compressed) return ReadAdpcm(src, dst, max);
 
-    // RIFF ve WAVE format kontrolü
-    if (strncmp((char*)header, "RIFF", 4) != 0 || strncmp((char*)&header[8], "WAVE", 4) != 0) {
-        printf("Hata: Gecerli bir WAV dosyasi degil!\n");
-        fclose(wav_file);
-        return 0;
-    }
+    // Yukari ornekleme baslangicinda bir frame cikis uretmeyebilir, cikis olana dek devam et
+    while (out == 0) {
+        size_t want = AudioConvert_InputBytesFor(&src->conv, max);
+        const uint8_t *in = NULL;
+        size_t n;
 
-    // "fmt " bölümünden temel bilgileri oku
-    // Bu bölüm genellikle dosyanın başında yer alır.
-    fseek(wav_file, 12, SEEK_SET); // "fmt " chunk'ının başlangıcına git
-    
-    if (fread(header, 1, 24, wav_file) != 24) { // "fmt " chunk'ını oku
-         printf("Hata: 'fmt ' bolumu okunamadi!\n");
-         fclose(wav_file);
-         return 0;
-    }
-    
-    uint32_t sample_rate = *(uint32_t*)&header[12]; // 12. byte'tan itibaren (fmt chunk'ının 8. byte'ı)
-    uint16_t num_channels = *(uint16_t*)&header[10];
-    uint16_t bits_per_sample = *(uint16_t*)&header[22];
-
-    // "data" chunk'ını arama döngüsü
-    char chunk_id[5] = {0};
-    uint32_t data_size = 0;
-
-    while (fread(chunk_id, 1, 4, wav_file) == 4) {
-        // chunk boyutunu oku
-        uint32_t chunk_size;
-        if (fread(&chunk_size, sizeof(uint32_t), 1, wav_file) != 1) {
-            printf("Hata: Chunk boyutu okunamadi!\n");
-            break;
+        if (want > src->remaining) want = src->remaining - (src->remaining % frame);
+        if (!src->conv.passthrough && src->cached == NULL && want > sizeof(s_readScratch)) {
+            want = sizeof(s_readScratch) - (sizeof(s_readScratch) % frame);
         }
-
-        if (strncmp(chunk_id, "data", 4) == 0) {
-            data_size = chunk_size;
-            break; // "data" bölümünü bulduk, döngüden çık
+        if (want == 0) return 0;
+
+        if (src->cached != NULL) {
+            in = src->pcm;
+            src->pcm += want;
+            n = want;
+        } else if (src->conv.passthrough) {
+            n = fread(dst, 1, want, src->file);  // Donusum yok, dogrudan hedefe
+            n -= n % frame;
+            if (src->remaining != UINT32_MAX) src->remaining -= n;
+            return n;
         } else {
-            // Bu "data" bölümü değil, chunk_size kadar ilerle
-            fseek(wav_file, chunk_size, SEEK_CUR);
+            n = fread(s_readScratch, 1, want, src->file);
+            n -= n % frame;
+            in = s_readScratch;
         }
+        if (n == 0) return 0;
+        if (src->remaining != UINT32_MAX) {
+            src->remaining -= n;
+        }
+        out = AudioConvert_Process(&src->conv, in, n, (int16_t *)dst);
     }
-
-    fclose(wav_file);
-
-    if (data_size == 0) {
-        printf("Hata: 'data' bolumu bulunamadi veya boyutu sifir!\n");
-        return 0;
-    }
-
-    // Hesaplamalar
-    uint32_t bytes_per_sample = (bits_per_sample / 8) * num_channels;
-    if (bytes_per_sample == 0 || sample_rate == 0) {
-        printf("Hata: Gecersiz WAV parametreleri! (Ornekleme Hizi/Bit Derinligi sifir olamaz)\n");
-        return 0;
-    }
-
-    float duration_seconds = (float)data_size / (float)(sample_rate * bytes_per_sample);
-    printf("WAV Suresi: %.2f saniye\n", duration_seconds);
-
-    // Süreyi en yakın saniyeye yuvarla
-    return (float)(duration_seconds + 0.5f);
+    return out;
 }
 
 
+
 /**
- * @file
- * @brief Plays a countdown audio WAV file corresponding to the given countdown value.
- *
- * Builds the file path for the countdown audio file using the countdown value,
- * prints the file path to the terminal, and plays the file using play_wav().
+ * @brief Releases the cache entry or closes the file behind a clip source.
  *
- * @param[in] countdown_value Integer value for the countdown (e.g., 5 for "5.wav").
- * @return None
+ * @param[in,out] src Clip source to close. Safe to call more than once.
  */
-void play_countdown_audio(int countdown_value) {
-    char file_path[50];
-    snprintf(file_path, sizeof(file_path), WAV_FILE_PATH, countdown_value);
-    printf("Oynatilan dosya: %s\n", file_path);  // Terminale yazdır
-    play_wav(file_path);
+void SpeakerDriver_CloseClip(ClipSource_t *src)
+{
+    if (src->cached != NULL) {
+        ClipCache_Release(src->cached);
+        src->cached = NULL;
+    }
+    if (src->file != NULL) {
+        fclose(src->file);
+        src->file = NULL;
+    }
 }
 
 
 
-
 /**
- * @file
- * @brief Plays a counter WAV file through I2S for a fixed duration (e.g., 850 ms), with volume adjustment.
- *
- * Opens the WAV file, parses its header, initializes the I2S interface, and streams audio data for a limited duration.
- * Supports 8/16/24/32 bit PCM, mono/stereo. If StopPlayWav is set or the duration is reached, playback stops.
- * Frees resources and disables the I2S channel at the end.
+ * @brief Terminates the current output stream and waits until it has been handed to the DMA.
  *
- * @param[in] file_path Full path to the WAV file to be played.
- * @return None
+ * Submits the end-of-stream marker and waits until the writer has written every queued block. The I2S
+ * channel is left running: the DMA plays out the tail of the last clip and then outputs silence, so the
+ * next clip starts without any channel setup, flush or drain delay.
  */
-void play_wav_counter(const char* file_path) {
-   FILE *wav_file = fopen(file_path, "rb");
-    if (!wav_file) {
-        printf("WAV dosyasi acilamadi!\n");
-        return;
-    }
-
-    uint8_t header[WAV_HEADER_SIZE];
-    if(fread(header, 1, WAV_HEADER_SIZE, wav_file) != WAV_HEADER_SIZE) {
-        printf("WAV basligi okunamadi!\n");
-        fclose(wav_file);
-        return;
-    }
-
-    uint32_t sample_rate = *(uint32_t*)&header[24];
-    uint16_t bits_per_sample = *(uint16_t*)&header[34];
-    uint16_t num_channels = *(uint16_t*)&header[22];
-    uint32_t byte_rate = *(uint32_t*)&header[28];
-
-    printf("Ornekleme Hizi: %" PRIu32 " Hz, Bit Derinligi: %" PRIu16 " bit, Kanallar: %d\n", 
-          sample_rate, bits_per_sample, num_channels);
-
-    init_i2s(sample_rate, bits_per_sample, num_channels);
-
-    uint8_t *buffer = (uint8_t *)malloc(BUFFER_SIZE_I2S);
-    if(!buffer) {
-        printf("Bellek ayrilamadi!\n");
-        fclose(wav_file);
-        return;
-    }
-
-    StopPlayWav = false;
-    uint32_t start_time = esp_timer_get_time(); // Mikrosaniye cinsinden başlangıç zamanı
-    uint32_t target_duration = 950000; // 850 ms mikrosaniye cinsinden
-    size_t bytes_read, bytes_written;
-    is_counter_voice_played = false;
-    while (!StopPlayWav && (bytes_read = fread(buffer, 1, BUFFER_SIZE_I2S, wav_file)) > 0) {
-        // Geçen süreyi kontrol et
-        uint32_t elapsed_time = (esp_timer_get_time() - start_time);
-        if(elapsed_time >= target_duration) {
-            printf("850 ms ulasildi, durduruluyor.\n");
-            StopPlayWav = true;
-        }
-
-        // Ses verilerini işle
-        if (bits_per_sample == 16) {
-            int16_t *sample_buffer = (int16_t *)buffer;
-            size_t sample_count = bytes_read / 2;
-            for (size_t i = 0; i < sample_count; i++) {
-                int32_t sample = (int32_t)(sample_buffer[i] * volume_factor);
-                sample_buffer[i] = (int16_t)(sample > INT16_MAX ? INT16_MAX : 
-                                           (sample < INT16_MIN ? INT16_MIN : sample));
-            }
-        } else if (bits_per_sample == 8) {
-        uint8_t *sample_buffer = buffer;
-        size_t sample_count = bytes_read;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int16_t sample = (int16_t)(sample_buffer[i] - 128); // 8-bit PCM offset düzeltme
-            sample = (int16_t)(sample * volume_factor);
-
-            if (sample < -128) sample = -128;
-            if (sample > 127) sample = 127;
-
-            sample_buffer[i] = (uint8_t)(sample + 128);
-          }
-         } else if (bits_per_sample == 24) {
-            size_t sample_count = bytes_read / 3;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int32_t sample = (buffer[i * 3] | (buffer[i * 3 + 1] << 8) | (buffer[i * 3 + 2] << 16));
-
-            if (sample & 0x800000) sample |= 0xFF000000; // İşaret genişletme (sign extension)
-
-            sample = (int32_t)(sample * volume_factor);
-
-            if (sample > 8388607) sample = 8388607; // 24-bit maksimum
-            if (sample < -8388608) sample = -8388608; // 24-bit minimum
-
-            buffer[i * 3] = sample & 0xFF;
-            buffer[i * 3 + 1] = (sample >> 8) & 0xFF;
-            buffer[i * 3 + 2] = (sample >> 16) & 0xFF;
-        }
-        } else if (bits_per_sample == 32) {
-        int32_t *sample_buffer = (int32_t *)buffer;
-        size_t sample_count = bytes_read / 4;
-
-        for (size_t i = 0; i < sample_count; i++) {
-            int64_t sample = (int64_t)(sample_buffer[i] * volume_factor);
-
-            if (sample > INT32_MAX) sample = INT32_MAX;
-            if (sample < INT32_MIN) sample = INT32_MIN;
-            sample_buffer[i] = (int32_t)sample;
-        }
-    }
-       // Eğer durdurma bayrağı set edildiyse çık
-        if (StopPlayWav) 
-        {
-		printf("PlayWav fonksiyonu durduruldu!\n");	
-		break;
-		}
-        // Diğer bit derinlikleri için benzer işlemler...
-        
-        // I2S'e yaz
-        esp_err_t ret = i2s_channel_write(tx_handle, buffer, bytes_read, &bytes_written, portMAX_DELAY);
-        if (ret != ESP_OK) {
-            printf("I2S yazma hatasi: %d\n", ret);
-            break;
-        }
-
-        if (StopPlayWav) {
-            printf("Oynatma durduruldu!\n");
-            break;
-        }
+void SpeakerDriver_EndStream(void)
+{
+    // Akis sonu isaretini gonder ve yazici son blogu DMA'ya verene kadar bekle
+    AudioBlock_t *blk = AudioPipeline_GetFreeBlock(portMAX_DELAY);
+    if (blk != NULL) {
+        blk->end_of_clip = true;
+        AudioPipeline_SubmitBlock(blk);
+        AudioPipeline_WaitClipDone(portMAX_DELAY);
     }
-
-    // Temizlik
-    free(buffer);
-    fclose(wav_file);
-    i2s_channel_disable(tx_handle);
-    printf("Oynatma tamamlandi.\n");
-    is_counter_voice_played = true;
 }
 
- 
 
- 
 
 /**
  * @file
@@ -23,6 +23,9 @@
 #include "sdmmc_cmd.h"
 #include "driver/sdspi_host.h"
 #include "esp_err.h"
+#include "ClipCache.h"
+#include "AudioConvert.h"
+#include "ImaAdpcm.h"
  
 // I2S Pinleri
 //#define I2S_BCLK      26
@@ -33,15 +36,36 @@
 #define I2S_DOUT      4
 #define WAV_HEADER_SIZE  44
 
+// SD'den okunan ham verinin donusturulmeden once tutuldugu tampon
+#ifndef SPEAKER_READ_SCRATCH_BYTES
+#define SPEAKER_READ_SCRATCH_BYTES  4096
+#endif
+
+// Calinmakta olan klibin kaynagi: RAM onbellegi veya SD'deki dosya
+typedef struct {
+    FILE                   *file;       // SD'den okunuyorsa acik dosya, aksi halde NULL
+    const ClipCacheEntry_t *cached;     // Onbellekten caliniyorsa sabitlenmis kayit, aksi halde NULL
+    const uint8_t          *pcm;        // Onbellekte okunacak siradaki byte
+    uint32_t                remaining;  // Kalan "data" byte'i (indekste yoksa UINT32_MAX)
+    uint32_t                sample_rate;
+    uint16_t                bits_per_sample;
+    uint16_t                num_channels;
+    uint16_t                audio_format;  // WAV_FORMAT_PCM veya WAV_FORMAT_IMA_ADPCM
+    uint16_t                block_align;
+    bool                    compressed;    // IMA-ADPCM: once adpcm ile 16-bit PCM'e cozulur
+    ImaAdpcm_t              adpcm;
+    AudioConvert_t          conv;       // Klip biciminden yerel cikis bicimine donusturucu
+} ClipSource_t;
+
 extern volatile bool is_idle_finished;
 extern volatile bool is_voice_played;
 
-void play_wav(const char *file_path);
-float CheckWavDuration(char *file_path);
-extern bool StopPlayWav; // Global değişken
-void play_countdown_audio(int countdown_value);
-void play_wav_counter(const char* filename);
-void play_wav_idle(const char *file_path);
+void init_i2s(uint32_t sample_rate, uint8_t bits_per_sample, uint8_t num_channels);
+bool SpeakerDriver_OpenClip(const char *file_path, ClipSource_t *src);
+size_t SpeakerDriver_ReadClip(ClipSource_t *src, uint8_t *dst, size_t max);
+void SpeakerDriver_CloseClip(ClipSource_t *src);
+void SpeakerDriver_EndStream(void);
+uint32_t SpeakerDriver_GetReconfigCount(void);
 void play_wav_dac(const char* path);
 void play_wav_blocking(const char* filename);
 bool is_audio_hardware_busy();
@@ -6,12 +6,21 @@
  */
 #include "Thread.h"
 #include "Alarms.h"
+#include "CycleModel.h"
 #include "DetectTraffic.h"
 #include "FlashConfig.h"
+#include "GpioEdge.h"
+#include "LampPcnt.h"
+#include "Loudness.h"
 #include "MichADCRead.h"
+#include "NoiseHistory.h"
 #include "Plan.h"
+#include "PlayQueue.h"
+#include "SoundPolicy.h"
 #include "SpeakerDriver.h"
 #include "SystemTime.h"
+#include "TraceLog.h"
+#include "WavIndex.h"
 #include "esp_task_wdt.h"
 #include "esp_timer.h"
 #include "main.h"
@@ -30,12 +39,15 @@ uint32_t COUNTDOWN_START;
 #define GPIO_INPUT_IO_1 CONFIG_GPIO_INPUT_1
 #define MIN_GAP_MS 200
 
-#define MAX_ADC_VALUE 4048.0f
+#define NOISE_QUIET_DB10 450 // Bu seviye ve alti minimum ses (45 dB)
+#define NOISE_LOUD_DB10 850 // Bu seviye ve ustu maksimum ses (85 dB)
 #define MAX_VOLUME_FACTOR 0.5f
-#define MIN_ADC_VALUE 0.0f
 #define MIN_VOLUME_FACTOR 0.0f
+#define CLIP_END_MARGIN_MS 500 // Klip suresine eklenen 0.5 s pay, oynatma zamanlamasi bununla ayarli
+#define VOLUME_TRACK_MS 250 // Calan seslerin ses seviyesi gurultuye gore bu aralikla guncellenir
+#define IO_POLL_TICKS 50 // IO_Task gurultu gecmisi ve talep islemleri periyodu; giris kenarlari beklemeden islenir
+#define PROCESS_STATS_MS 60000 // Process_Thread uyanma istatistigi bu aralikla loglanir
 
-#define NOISE_LEVEL_HISTORY_SIZE 15 // Son 15 saniyelik veriyi sakla
 #define ADC_UPDATE_INTERVAL_MS 100 // 1 saniyelik periyotla adc verisini goster.
 #define TIMER_CALLBACK_INTERVAL_MS 50 // Your current timer interval
 #define UPDATES_PER_SECOND                                                     \
@@ -53,6 +65,9 @@ TaskHandle_t play_wav_task_handle = NULL;
 TaskHandle_t xIO_TaskHandle = NULL;
 TaskHandle_t flashWrite_task_handle = NULL;
 
+static EventGroupHandle_t s_processEvents = NULL;
+static volatile int64_t s_processEventUs = 0; // Bekleyen ilk olayin zamani, 0: olay yok
+
 extern volatile uint32_t g_movingRMS;
 extern volatile float volume_factor; // Başlangıç seviyesi
 int64_t time_difference;
@@ -66,7 +81,7 @@ bool playOrientationflag = false;
 bool goCrossOverFlag = false;
 bool isPlayGreenLightVoice = false;
 uint8_t RequestSoundPlaybackPeriod = 0;
-int noise_level_history[NOISE_LEVEL_HISTORY_SIZE] = {0};
+RING_STATS_DEFINE(, noise_level_history, NOISE_LEVEL_HISTORY_SIZE, NOISE_LEVEL_BUCKETS, 0, NOISE_LEVEL_BUCKET_DB);
 bool isGreenCountdownAction = false;
 
 uint8_t ui8_greenCountFrom = 10;
@@ -109,12 +124,6 @@ TickType_t last_sound_end_time = 0; // Son sesin bittiği zaman
 
 #define IDLE_PERIOD_MS 700 // Idle periyodu sabit 700ms
 #define MIN_SILENCE_MS 700 // Her ses arası minimum 700ms boşluk
-// Global değişkenler
-char play_wav_file[60] = {0};
-char play_wav_file_2[60] = {0};  // İkinci ses için
-volatile bool new_file_ready = false;
-volatile bool new_file_2_ready = false;  // İkinci ses için flag
-volatile bool audio_playing = false;
 
 
 
@@ -135,6 +144,208 @@ void Timer_Threads_Init(void) {
   // 1000 ms (1 saniye) timer
   xTimer_1000ms = xTimerCreate("Timer_1000ms", pdMS_TO_TICKS(1000), pdTRUE,
                                NULL, TimerCallback_1000ms);
+
+  // Process_Thread olaylari; gorevler ve zamanlayicilar baslamadan olusturulur
+  s_processEvents = xEventGroupCreate();
+}
+
+
+
+/**
+ * @brief Wakes Process_Thread for the given events.
+ *
+ * Safe to call from any task or timer callback. The time of the first pending event is kept so
+ * Process_Thread can report its reaction latency.
+ *
+ * @param[in] events PROCESS_EVT_* bits.
+ */
+void ProcessThread_Notify(EventBits_t events)
+{
+    if (s_processEvents == NULL) {
+        return;
+    }
+    if (s_processEventUs == 0) {
+        s_processEventUs = esp_timer_get_time();
+    }
+    xEventGroupSetBits(s_processEvents, events);
+}
+
+
+
+/* Zaman tabanli bir kararin anini bekleme suresine ekler, en erken olan kazanir */
+static void WakeAt(TickType_t *wait_ticks, TickType_t now, TickType_t at)
+{
+    if ((int32_t)(at - now) > 0 && (at - now) < *wait_ticks) {
+        *wait_ticks = at - now;
+    }
+}
+
+
+
+/* Kuyruk bosaldiginda Process_Thread'i uyandirir (PlayWav_Task'ta, PlayQueue_RunSession sonunda calisir) */
+static void OnQueueIdle(void)
+{
+    ProcessThread_Notify(PROCESS_EVT_PLAYBACK);
+}
+
+
+
+/**
+ * @brief Returns the duration of a clip from the WAV index, in seconds.
+ *
+ * The lookup is a RAM read, the SD card is not touched. CLIP_END_MARGIN_MS is added to the indexed length,
+ * the playback timing was tuned with that 0.5 s pad.
+ *
+ * @param[in] file_path Full path of the WAV file.
+ * @return Duration in seconds, 0 if the file is not indexed.
+ */
+static float IndexedWavDuration(const char *file_path)
+{
+    uint32_t ms = WavIndex_GetDurationMs(file_path);
+    return ms ? (float)(ms + CLIP_END_MARGIN_MS) / 1000.0f : 0.0f;
+}
+
+
+
+/**
+ * @brief Maps the ambient noise level to a volume factor between the configured limits.
+ *
+ * @param[in] min_volume Configured minimum volume, in percent of MAX_VOLUME_FACTOR.
+ * @param[in] max_volume Configured maximum volume, in percent of MAX_VOLUME_FACTOR.
+ * @return Volume factor for the current Slow-weighted ambient level, linear in dB between
+ *         NOISE_QUIET_DB10 and NOISE_LOUD_DB10 and clamped outside. The level excludes the device's own
+ *         announcements, so a playing clip does not turn its own volume up.
+ */
+static float NoiseScaledVolume(int min_volume, int max_volume)
+{
+    float max_factor = ((float)max_volume / 100.0f) * MAX_VOLUME_FACTOR;
+    float min_factor = ((float)min_volume / 100.0f) * MAX_VOLUME_FACTOR;
+    int32_t db10 = Loudness_GetDb10();
+    if (db10 < NOISE_QUIET_DB10) db10 = NOISE_QUIET_DB10;
+    if (db10 > NOISE_LOUD_DB10) db10 = NOISE_LOUD_DB10;
+    return ((float)(db10 - NOISE_QUIET_DB10) / (float)(NOISE_LOUD_DB10 - NOISE_QUIET_DB10)) * (max_factor - min_factor) + min_factor;
+}
+
+
+
+/**
+ * @brief Follows the ambient noise level with the volume of the clips that are playing.
+ *
+ * Called every loop of Process_Thread, acts every VOLUME_TRACK_MS. The mixer ramps each change across
+ * one output block, so long idle loops adapt continuously without zipper noise.
+ *
+ * @param[in] now Current tick count.
+ */
+static void TrackNoiseVolume(TickType_t now)
+{
+    static TickType_t last_track_time = 0;
+    if ((now - last_track_time) < pdMS_TO_TICKS(VOLUME_TRACK_MS)) {
+        return;
+    }
+    last_track_time = now;
+
+    PlayQueue_SetGain(PLAY_PRIO_IDLE, NoiseScaledVolume(CurrentConfiguration.idleMinVolume, CurrentConfiguration.idleMaxVolume));
+    PlayQueue_SetGain(PLAY_PRIO_REQUEST, NoiseScaledVolume(CurrentConfiguration.reqMinVolume, CurrentConfiguration.reqMaxVolume));
+    PlayQueue_SetGain(PLAY_PRIO_GREEN, NoiseScaledVolume(CurrentConfiguration.greenMinVolume, CurrentConfiguration.greenMaxVolume));
+}
+
+
+
+/**
+ * @brief Playback queue completion callback, runs in AudioWriter_Task.
+ *
+ * The end times set by Process_Thread are estimates taken from the WAV index when the clip is queued.
+ * If the clip actually finished later (e.g. it waited behind a green announcement), the end time is
+ * pushed forward so the silence and request period are counted from the real end of the sound.
+ *
+ * @param[in] file_path Path of the finished clip (unused).
+ * @param[in] completed false if the clip was skipped or preempted (unused).
+ * @param[in] arg       Optional TickType_t to update as well (request end time), may be NULL.
+ */
+static void OnSoundDone(const char *file_path, bool completed, void *arg)
+{
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(now - last_sound_end_time) > 0) {
+        last_sound_end_time = now;
+    }
+    if (arg != NULL && (int32_t)(now - *(TickType_t *)arg) > 0) {
+        *(TickType_t *)arg = now;
+    }
+    ProcessThread_Notify(PROCESS_EVT_PLAYBACK);
+}
+
+
+
+/**
+ * @brief Queues one configured sound file from the SD card at the current volume_factor.
+ *
+ * @param[in] file_name  File name as stored in the configuration ("-" means none).
+ * @param[in] priority   Playback priority.
+ * @param[in] end_time   Optional end time to track, passed to OnSoundDone().
+ * @param[in] tag        Label for the log line.
+ * @return true if the clip was queued.
+ */
+static bool EnqueueConfiguredSound(const char *file_name, PlayPriority_t priority, TickType_t *end_time, const char *tag)
+{
+    char path[PLAY_QUEUE_PATH_LEN];
+    if (file_name == NULL || file_name[0] == '\0' || strcmp(file_name, "-") == 0) {
+        return false;
+    }
+    snprintf(path, sizeof(path), "/sdcard/%s", file_name);
+    bool queued = PlayQueue_Enqueue(path, volume_factor, priority, OnSoundDone, end_time);
+    printf("[PROCESS] %s dosyasi kuyruga eklendi: %s\n", tag, path);
+    return queued;
+}
+
+
+
+/**
+ * @brief Queues request sound 1 and, if configured, request sound 2 as one gapless announcement.
+ *
+ * @param[in] tag         Label for the log line.
+ * @param[in] request_end Optional request end time to track, passed to OnSoundDone().
+ * @return Expected total duration of the announcement, from the WAV index.
+ */
+static TickType_t EnqueueRequestSounds(const char *tag, TickType_t *request_end)
+{
+    char path1[PLAY_QUEUE_PATH_LEN];
+    char path2[PLAY_QUEUE_PATH_LEN];
+    const char *paths[2] = { path1, path2 };
+    size_t count = 1;
+
+    snprintf(path1, sizeof(path1), "/sdcard/%s", CurrentConfiguration.reqSound1);
+    TickType_t total_sound_duration = pdMS_TO_TICKS((int)(IndexedWavDuration(path1) * 1000));
+
+    if (strcmp(CurrentConfiguration.reqSound2, "-") != 0) {
+        snprintf(path2, sizeof(path2), "/sdcard/%s", CurrentConfiguration.reqSound2);
+        total_sound_duration += pdMS_TO_TICKS((int)(IndexedWavDuration(path2) * 1000));
+        count = 2;  // Iki ses arasinda bekleme yok, kuyruk bosluksuz birlestirir
+    }
+
+    PlayQueue_EnqueueSequence(paths, count, volume_factor, PLAY_PRIO_REQUEST, OnSoundDone, request_end);
+    printf("[PROCESS] %s sesleri kuyruga eklendi: %s%s%s\n", tag, path1, count > 1 ? " + " : "", count > 1 ? path2 : "");
+    return total_sound_duration;
+}
+
+
+
+/**
+ * @brief Tells the playback queue which configured sound is expected next on a priority lane.
+ *
+ * The queue prefetches that clip from the SD card while the current clip still plays.
+ *
+ * @param[in] priority  Lane priority.
+ * @param[in] file_name File name as stored in the configuration; NULL or "-" clears the hint.
+ */
+static void HintNextSound(PlayPriority_t priority, const char *file_name)
+{
+    char path[PLAY_QUEUE_PATH_LEN];
+    if (file_name == NULL || file_name[0] == '\0' || strcmp(file_name, "-") == 0) {
+        PlayQueue_Hint(priority, NULL);
+        return;
+    }
+    snprintf(path, sizeof(path), "/sdcard/%s", file_name);
+    PlayQueue_Hint(priority, path);
 }
 
 
@@ -146,223 +357,76 @@ void Timer_Threads_Init(void) {
  * It handles the scheduling and timing of sound playback, including single and sequential sounds, volume adjustment, and sound duration caching.
  * Special logic is included for test mode, request period management, silence intervals, green light voice and counter, and green action sound.
  *
+ * The thread does not poll: it blocks on an event group signalled by input transitions, plan changes,
+ * countdown ticks, playback completion and test requests. While waiting, the timeout is the earliest
+ * time based decision that is pending (end of silence, next request period, volume tracking while a clip
+ * plays), and is infinite when nothing is scheduled. Wakeups and the worst event reaction time are logged
+ * every PROCESS_STATS_MS.
+ *
  * @param[in] arg Pointer to thread parameters (unused).
  */
 void Process_Thread(void *arg) {
   static TickType_t last_idle_play_time = 0;
   static TickType_t last_request_end_time = 0;
   static float cached_idle_duration = 0.0;
-  static bool idle_duration_cached = false;
-  
-  while (1) {
+  TickType_t wait_ticks = 0;
+  TickType_t stats_start = xTaskGetTickCount();
+  uint32_t wake_events = 0, wake_timeouts = 0;
+  int64_t max_react_us = 0;
+  SoundPolicy_t policy;
+  bool policy_built = false;
 
-   /*
-   -------------------------------------------------
-   | 000 | 001 | 010 | 011 | 100 | 101 | 110 | 111 |
-   |-----------------------------------------------|
-   |  +  |  +  |  +  |  +  |  +  |  +  |  +  |  +  |
-   -------------------------------------------------
-   */
+  PlayQueue_SetIdleCallback(OnQueueIdle);
 
-    // --------------------
-    // CASE 1: 100
-    // --------------------
-    if (CurrentConfiguration.isIdleActive == true &&
-        CurrentConfiguration.idleContAfterReq == false &&
-        CurrentConfiguration.isReqActive == false) {
-      RequestPlayFlag = false;
-      IdlePlayFlag = true;
-      GreenCounterPlayFlag = false;
-      // printf("100\n");
-      if (Demand_input.isDemandActive ==
-          true) // talep alindiktan sonra idle sesini kes. ve yesil saymayi
-                // birakana kadar
-      {
-        IdlePlayFlag = false;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
+  while (1) {
+    EventBits_t events = xEventGroupWaitBits(s_processEvents, PROCESS_EVT_ALL, pdTRUE, pdFALSE, wait_ticks);
+    wait_ticks = portMAX_DELAY;
+
+    if (events & PROCESS_EVT_ALL) {
+      int64_t posted = s_processEventUs;
+      s_processEventUs = 0;
+      wake_events++;
+      if (posted != 0 && esp_timer_get_time() - posted > max_react_us) {
+        max_react_us = esp_timer_get_time() - posted;
       }
-
+    } else {
+      wake_timeouts++;
     }
-    // --------------------
-    // CASE 2: 110
-    // --------------------
-    else if (CurrentConfiguration.isIdleActive == true &&
-             CurrentConfiguration.idleContAfterReq == true &&
-             CurrentConfiguration.isReqActive == false) {
-      IdlePlayFlag = true;
-      RequestPlayFlag = false;
-      GreenCounterPlayFlag = false;
-      // printf("110\n");
-      if (Demand_input.isDemandActive) // talep alinmissa idle sesi devam etmeli
-      {
-        IdlePlayFlag = true;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
-      }
 
+    if ((xTaskGetTickCount() - stats_start) >= pdMS_TO_TICKS(PROCESS_STATS_MS)) {
+      printf("[PROCESS] Son %d s: %" PRIu32 " uyanma (olay %" PRIu32 ", zaman asimi %" PRIu32 "), en kotu tepki %" PRId64 " us\n",
+             PROCESS_STATS_MS / 1000, wake_events + wake_timeouts, wake_events, wake_timeouts, max_react_us);
+      stats_start = xTaskGetTickCount();
+      wake_events = wake_timeouts = 0;
+      max_react_us = 0;
     }
-    // --------------------
-    // CASE 3: 010
-    // --------------------
-    else if (CurrentConfiguration.isIdleActive == false &&
-             CurrentConfiguration.idleContAfterReq == true &&
-             CurrentConfiguration.isReqActive == false) {
-      IdlePlayFlag = false;
-      RequestPlayFlag = false;
-      GreenCounterPlayFlag = false;
-      // printf("010\n");
-      if (Demand_input
-              .isDemandActive) // talep alinmissa talep gidene kadar sesini cal
-      {
-        IdlePlayFlag = true;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
-      }
 
+    // Plan anahtari degistiyse karar tablosunu yeniden derle, sonra tek bakista bayraklari al
+    uint8_t policy_key = SoundPolicy_Key(CurrentConfiguration.isIdleActive, CurrentConfiguration.idleContAfterReq,
+                                         CurrentConfiguration.isReqActive, CurrentConfiguration.isGreenActive);
+    if (!policy_built || policy_key != policy.key) {
+      SoundPolicy_Build(&policy, policy_key);
+      policy_built = true;
     }
-    // --------------------
-    // CASE 4: 000
-    // --------------------
-    else if (CurrentConfiguration.isIdleActive == false &&
-             CurrentConfiguration.idleContAfterReq == false &&
-             CurrentConfiguration.isReqActive == false) {
-      IdlePlayFlag = false;
-      GreenCounterPlayFlag = false;
-      // printf("000\n");
-      if (Demand_input.isDemandActive) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
-      }
-    }
-    // --------------------
-    // CASE 5: 111
-    // --------------------
-    else if (CurrentConfiguration.isIdleActive == true &&
-             CurrentConfiguration.idleContAfterReq == true &&
-             CurrentConfiguration.isReqActive == true) {
-      IdlePlayFlag = true;
-      RequestPlayFlag = false;
-      GreenCounterPlayFlag = false;
-      // printf("111\n");
-      if (Demand_input.isDemandActive) {
-        IdlePlayFlag = true;
-        RequestPlayFlag = true;
-        StopPlayWav = true;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
-      }
-    }
-    // --------------------
-    // CASE 6: 001
-    // --------------------
-    else if (CurrentConfiguration.isIdleActive == false &&
-             CurrentConfiguration.idleContAfterReq == false &&
-             CurrentConfiguration.isReqActive == true) {
-      IdlePlayFlag = false;
-      GreenCounterPlayFlag = false;
-      RequestPlayFlag = false;
-      // printf("001\n");
-      if (Demand_input.isDemandActive) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = true;
-        StopPlayWav = true;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
-      }
+    uint8_t decision = SoundPolicy_Decide(&policy, Demand_input.isDemandActive, green_input.confirmed_flag);
+    IdlePlayFlag = (decision & SOUND_POLICY_IDLE) != 0;
+    RequestPlayFlag = (decision & SOUND_POLICY_REQUEST) != 0;
+    GreenCounterPlayFlag = (decision & SOUND_POLICY_GREEN_COUNTER) != 0;
 
-    }
-    // --------------------
-    // CASE 7: 011
-    // --------------------
-    else if (CurrentConfiguration.isIdleActive == false &&
-             CurrentConfiguration.idleContAfterReq == true &&
-             CurrentConfiguration.isReqActive == true) {
-      IdlePlayFlag = false;
-      GreenCounterPlayFlag = false;
-      RequestPlayFlag = false;
-      // printf("011\n");
-      if (Demand_input.isDemandActive) {
-        IdlePlayFlag = true;
-        RequestPlayFlag = true;
-        StopPlayWav = true;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
-      }
-    }
-    // --------------------
-    // CASE 8: 101
-    // --------------------
-    else if (CurrentConfiguration.isIdleActive == true &&
-             CurrentConfiguration.idleContAfterReq == false &&
-             CurrentConfiguration.isReqActive == true) {
-      IdlePlayFlag = true;
-      GreenCounterPlayFlag = false;
-      RequestPlayFlag = false;
-      // printf("101\n");
-      if (Demand_input.isDemandActive) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = true;
-        StopPlayWav = true;
-      }
-      if (CurrentConfiguration.isGreenActive == true &&
-          green_input.confirmed_flag == true) {
-        IdlePlayFlag = false;
-        RequestPlayFlag = false;
-        StopPlayWav = true;
-        GreenCounterPlayFlag = true;
-      }
-    }
-    
       // --------------------
     // PLAY SOUND
     // --------------------
      if (TestMode == true) {
-            snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", s_playSound.fileName);
-            new_file_ready = true;
-            printf("[PROCESS] Test dosyasi ayarlandi: %s\n", play_wav_file);
+            char test_path[PLAY_QUEUE_PATH_LEN];
+            snprintf(test_path, sizeof(test_path), "/sdcard/%s", s_playSound.fileName);
+            PlayQueue_Enqueue(test_path, volume_factor, PLAY_PRIO_TEST, NULL, NULL);
+            printf("[PROCESS] Test dosyasi kuyruga eklendi: %s\n", test_path);
             TestMode = false;
         }
 
         if (TestMode == false) {
             TickType_t current_time = xTaskGetTickCount();
+            TrackNoiseVolume(current_time);
             int req_delay_ms = 0;
 
             if (RequestPlayFlag) {
@@ -382,15 +446,24 @@ void Process_Thread(void *arg) {
 
             TickType_t request_period_ticks = pdMS_TO_TICKS(req_delay_ms);
             TickType_t min_silence_ticks = pdMS_TO_TICKS(MIN_SILENCE_MS);
-            bool is_sound_playing = (current_time < last_sound_end_time) || audio_playing; // *** ÖNEMLİ: audio_playing eklendi
+            bool is_sound_playing = (current_time < last_sound_end_time) || PlayQueue_IsBusy(); // Kuyrukta veya calan klip varsa
             bool silence_period_passed = (current_time >= (last_sound_end_time + min_silence_ticks));
 
-            // Idle ses süresini cache'le
-            if (!idle_duration_cached && IdlePlayFlag) {
+            // Tahmini ses sonu ve sessizlik sonu, oynatma olayi gelmese de karar anidir
+            if (IdlePlayFlag || RequestPlayFlag) {
+                WakeAt(&wait_ticks, current_time, last_sound_end_time);
+                WakeAt(&wait_ticks, current_time, last_sound_end_time + min_silence_ticks);
+            }
+            // Calan klip varken ses seviyesi gurultuyu izler
+            if (PlayQueue_IsBusy()) {
+                WakeAt(&wait_ticks, current_time, current_time + pdMS_TO_TICKS(VOLUME_TRACK_MS));
+            }
+
+            // Idle ses suresi indeksten okunur (SD erisimi yok), plan degisince de guncel kalir
+            if (IdlePlayFlag) {
                 char idle_path[256];
                 snprintf(idle_path, sizeof(idle_path), "/sdcard/%s", CurrentConfiguration.idleSound);
-                cached_idle_duration = CheckWavDuration(idle_path);
-                idle_duration_cached = true;
+                cached_idle_duration = IndexedWavDuration(idle_path);
             }
 
             if (IdlePlayFlag && RequestPlayFlag && req_delay_ms > 0) {
@@ -402,55 +475,24 @@ void Process_Thread(void *arg) {
                     actual_next_request_time = current_time;
                 }
                 bool request_time_reached = (current_time >= actual_next_request_time);
+                WakeAt(&wait_ticks, current_time, actual_next_request_time);
 
                 if (!is_sound_playing && silence_period_passed) {
                     if (request_time_reached) {
-                        // *** REQUEST SES 1 + 2 AYARLAMA ***
-                        snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", CurrentConfiguration.reqSound1);
-                        new_file_ready = true;
-                        printf("[PROCESS] Request ses 1 ayarlandi: %s\n", play_wav_file);
-                        
-                        // --- REQUEST VOLUME AYARI ---
-                        float max_factor = ((float)CurrentConfiguration.reqMaxVolume / 100.0f) * MAX_VOLUME_FACTOR;
-					    float min_factor = ((float)CurrentConfiguration.reqMinVolume / 100.0f) * MAX_VOLUME_FACTOR;
-    					volume_factor = ((float)(g_adcAverage - MIN_ADC_VALUE) / (MAX_ADC_VALUE - MIN_ADC_VALUE)) * (max_factor - min_factor) + min_factor;
-					                    
-					                    
-                        // Timing hesaplamaları
-                        float duration1 = CheckWavDuration(play_wav_file);
-                        TickType_t total_sound_duration = pdMS_TO_TICKS((int)(duration1 * 1000));
-
-                        if (strcmp(CurrentConfiguration.reqSound2, "-") != 0) {
-                            snprintf(play_wav_file_2, sizeof(play_wav_file_2), "/sdcard/%s", CurrentConfiguration.reqSound2);
-                            new_file_2_ready = true;
-                            printf("[PROCESS] Request ses 2 ayarlandi: %s\n", play_wav_file_2);
-                            
-                            float duration2 = CheckWavDuration(play_wav_file_2);
-                            total_sound_duration += pdMS_TO_TICKS((int)(duration2 * 1000));
-                            total_sound_duration += pdMS_TO_TICKS(50); // İki ses arası delay
-                        } else {
-                            new_file_2_ready = false;
-                            play_wav_file_2[0] = '\0';
-                        }
+                        // *** REQUEST SES 1 + 2 KUYRUGA EKLEME ***
+                        volume_factor = NoiseScaledVolume(CurrentConfiguration.reqMinVolume, CurrentConfiguration.reqMaxVolume);
+                        TickType_t total_sound_duration = EnqueueRequestSounds("Request", &last_request_end_time);
 
                         last_sound_end_time = current_time + total_sound_duration;
                         last_request_end_time = last_sound_end_time;
                     } else {
-                        // *** IDLE SES AYARLAMA ***
+                        // *** IDLE SES KUYRUGA EKLEME ***
                         TickType_t time_until_next_request = actual_next_request_time - current_time;
                         TickType_t idle_duration_ticks = pdMS_TO_TICKS((int)(cached_idle_duration * 1000));
                         
                         if (time_until_next_request > idle_duration_ticks) {
-                            snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", CurrentConfiguration.idleSound);
-                            
-				            // --- IDLE VOLUME AYARI ---
-				            float max_factor = ((float)CurrentConfiguration.idleMaxVolume / 100.0f) * MAX_VOLUME_FACTOR;
-				            float min_factor = ((float)CurrentConfiguration.idleMinVolume / 100.0f) * MAX_VOLUME_FACTOR;
-				            volume_factor = ((float)(g_adcAverage - MIN_ADC_VALUE) / (MAX_ADC_VALUE - MIN_ADC_VALUE)) * (max_factor - min_factor) + min_factor;
-                                    
-                            new_file_ready = true;
-                            new_file_2_ready = false;
-                            printf("[PROCESS] Idle dosyasi ayarlandi: %s\n", play_wav_file);
+                            volume_factor = NoiseScaledVolume(CurrentConfiguration.idleMinVolume, CurrentConfiguration.idleMaxVolume);
+                            EnqueueConfiguredSound(CurrentConfiguration.idleSound, PLAY_PRIO_IDLE, NULL, "Idle");
                             
                             last_sound_end_time = current_time + idle_duration_ticks;
                         }
@@ -459,23 +501,9 @@ void Process_Thread(void *arg) {
             } 
             else if (IdlePlayFlag && !RequestPlayFlag) { // --- Sadece Idle aktifse ---
                 if (silence_period_passed && !is_sound_playing) {
-                    if (!idle_duration_cached) {
-                        char idle_path[256];
-                        snprintf(idle_path, sizeof(idle_path), "/sdcard/%s", CurrentConfiguration.idleSound);
-                        cached_idle_duration = CheckWavDuration(idle_path);
-                        idle_duration_cached = true;
-                    }
-                    
-                    // *** IDLE ONLY SES AYARLAMA ***
-                    snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", CurrentConfiguration.idleSound);
-                    new_file_ready = true;
-                    new_file_2_ready = false;
-                    printf("[PROCESS] Idle only dosyasi ayarlandi: %s\n", play_wav_file);
-                    
-                    // --- IDLE VOLUME AYARI ---
-			        float max_factor = ((float)CurrentConfiguration.idleMaxVolume / 100.0f) * MAX_VOLUME_FACTOR;
-			        float min_factor = ((float)CurrentConfiguration.idleMinVolume / 100.0f) * MAX_VOLUME_FACTOR;
-			        volume_factor = ((float)(g_adcAverage - MIN_ADC_VALUE) / (MAX_ADC_VALUE - MIN_ADC_VALUE)) * (max_factor - min_factor) + min_factor;
+                    // *** IDLE ONLY SES KUYRUGA EKLEME ***
+                    volume_factor = NoiseScaledVolume(CurrentConfiguration.idleMinVolume, CurrentConfiguration.idleMaxVolume);
+                    EnqueueConfiguredSound(CurrentConfiguration.idleSound, PLAY_PRIO_IDLE, NULL, "Idle only");
 
                     last_idle_play_time = current_time;
                     last_sound_end_time = current_time + pdMS_TO_TICKS((int)(cached_idle_duration * 1000));
@@ -499,85 +527,31 @@ void Process_Thread(void *arg) {
                     }
                 }
 
+                WakeAt(&wait_ticks, current_time, actual_next_request_time);
                 if (current_time >= actual_next_request_time && !is_sound_playing && silence_period_passed) {
-                    // *** REQUEST ONLY SES 1 + 2 AYARLAMA ***
-                    snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", CurrentConfiguration.reqSound1);
-                    new_file_ready = true;
-                    printf("[PROCESS] Request only ses 1 ayarlandi: %s\n", play_wav_file);
-                    
-                        // --- REQUEST VOLUME AYARI ---
-			        float max_factor = ((float)CurrentConfiguration.reqMaxVolume / 100.0f) * MAX_VOLUME_FACTOR;
-			        float min_factor = ((float)CurrentConfiguration.reqMinVolume / 100.0f) * MAX_VOLUME_FACTOR;
-			        volume_factor = ((float)(g_adcAverage - MIN_ADC_VALUE) / (MAX_ADC_VALUE - MIN_ADC_VALUE)) * (max_factor - min_factor) + min_factor;
-                                
-                                
-                    float duration1 = CheckWavDuration(play_wav_file);
-                    TickType_t total_sound_duration = pdMS_TO_TICKS((int)(duration1 * 1000));
-
-                    if (strcmp(CurrentConfiguration.reqSound2, "-") != 0) {
-                        snprintf(play_wav_file_2, sizeof(play_wav_file_2), "/sdcard/%s", CurrentConfiguration.reqSound2);
-                        new_file_2_ready = true;
-                        printf("[PROCESS] Request only ses 2 ayarlandi: %s\n", play_wav_file_2);
-                        
-                        float duration2 = CheckWavDuration(play_wav_file_2);
-                        total_sound_duration += pdMS_TO_TICKS((int)(duration2 * 1000));
-                        total_sound_duration += pdMS_TO_TICKS(50);
-                    } else {
-                        new_file_2_ready = false;
-                        play_wav_file_2[0] = '\0';
-                    }
+                    // *** REQUEST ONLY SES 1 + 2 KUYRUGA EKLEME ***
+                    volume_factor = NoiseScaledVolume(CurrentConfiguration.reqMinVolume, CurrentConfiguration.reqMaxVolume);
+                    TickType_t total_sound_duration = EnqueueRequestSounds("Request only", &last_request_end_time);
                     
                     last_sound_end_time = current_time + total_sound_duration;
                     last_request_end_time = last_sound_end_time;
                 }
             } 
             else if (RequestPlayFlag && CurrentConfiguration.reqPlayPeriod == 0 && silence_period_passed && !is_sound_playing) { // --- Tek seferlik request ---
-                // *** TEK SEFERLİK REQUEST SES 1 + 2 AYARLAMA ***
-                snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", CurrentConfiguration.reqSound1);
-                
-                 // --- REQUEST VOLUME AYARI ---
-		        float max_factor = ((float)CurrentConfiguration.reqMaxVolume / 100.0f) * MAX_VOLUME_FACTOR;
-		        float min_factor = ((float)CurrentConfiguration.reqMinVolume / 100.0f) * MAX_VOLUME_FACTOR;
-		        volume_factor = ((float)(g_adcAverage - MIN_ADC_VALUE) / (MAX_ADC_VALUE - MIN_ADC_VALUE))  
-		                              * (max_factor - min_factor) + min_factor;
-		                              
-                              
-                new_file_ready = true;
-                printf("[PROCESS] Tek seferlik ses 1 ayarlandi: %s\n", play_wav_file);
-                
-                float duration1 = CheckWavDuration(play_wav_file);
-                TickType_t total_sound_duration = pdMS_TO_TICKS((int)(duration1 * 1000));
-
-                if (strcmp(CurrentConfiguration.reqSound2, "-") != 0) {
-                    snprintf(play_wav_file_2, sizeof(play_wav_file_2), "/sdcard/%s", CurrentConfiguration.reqSound2);
-                    new_file_2_ready = true;
-                    printf("[PROCESS] Tek seferlik ses 2 ayarlandi: %s\n", play_wav_file_2);
-                    
-                    float duration2 = CheckWavDuration(play_wav_file_2);
-                    total_sound_duration += pdMS_TO_TICKS((int)(duration2 * 1000));
-                    total_sound_duration += pdMS_TO_TICKS(50);
-                } else {
-                    new_file_2_ready = false;
-                    play_wav_file_2[0] = '\0';
-                }
+                // *** TEK SEFERLİK REQUEST SES 1 + 2 KUYRUGA EKLEME ***
+                volume_factor = NoiseScaledVolume(CurrentConfiguration.reqMinVolume, CurrentConfiguration.reqMaxVolume);
+                TickType_t total_sound_duration = EnqueueRequestSounds("Tek seferlik", NULL);
 
                 last_sound_end_time = current_time + total_sound_duration;
                 RequestPlayFlag = false;
             }
 
-            // *** GREEN SOUND AYARLAMA ***
+            // *** GREEN SOUND KUYRUGA EKLEME ***
             if (green_input.confirmed_flag == true && !isPlayGreenLightVoice && 
                 strcmp(CurrentConfiguration.greenSound, "-") != 0) {
                 
-                float max_factor = ((float)CurrentConfiguration.greenMaxVolume / 100.0f) * MAX_VOLUME_FACTOR;
-                float min_factor = ((float)CurrentConfiguration.greenMinVolume / 100.0f) * MAX_VOLUME_FACTOR;
-                volume_factor = ((float)(g_adcAverage - MIN_ADC_VALUE) / (MAX_ADC_VALUE - MIN_ADC_VALUE)) * (max_factor - min_factor) + min_factor;
-                
-                printf("GreenSound ayarlaniyor: %s\n", CurrentConfiguration.greenSound);
-                snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", CurrentConfiguration.greenSound);
-                new_file_ready = true;
-                new_file_2_ready = false;
-                printf("[PROCESS] Green dosyasi ayarlandi: %s\n", play_wav_file);
+                volume_factor = NoiseScaledVolume(CurrentConfiguration.greenMinVolume, CurrentConfiguration.greenMaxVolume);
+                EnqueueConfiguredSound(CurrentConfiguration.greenSound, PLAY_PRIO_GREEN, NULL, "Green");
                 
                 isPlayGreenLightVoice = true;
             }
@@ -586,45 +560,46 @@ void Process_Thread(void *arg) {
                 isPlayGreenLightVoice = false;
             }
 
-            // *** GREEN COUNTER AYARLAMA ***
+            // *** GREEN COUNTER KUYRUGA EKLEME ***
             if (GreenCounterPlayFlag == true && new_file_available == true) {
                 new_file_available = false;
                 
-                float max_factor = ((float)CurrentConfiguration.greenMaxVolume / 100.0f) * MAX_VOLUME_FACTOR;
-                float min_factor = ((float)CurrentConfiguration.greenMinVolume / 100.0f) * MAX_VOLUME_FACTOR;
-                volume_factor = ((float)(g_adcAverage - MIN_ADC_VALUE) / (MAX_ADC_VALUE - MIN_ADC_VALUE)) * (max_factor - min_factor) + min_factor;
+                volume_factor = NoiseScaledVolume(CurrentConfiguration.greenMinVolume, CurrentConfiguration.greenMaxVolume);
 
                 if (green_input.countdown_current <= CurrentConfiguration.greenCountFrom && 
                     green_input.countdown_current > CurrentConfiguration.greenCountTo - 1) {
                     
-                    printf("Sayim ayarlaniyor: %s\n", current_playing_file);
-                    snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", current_playing_file);
-                    new_file_ready = true;
-                    new_file_2_ready = false;
-                    printf("[PROCESS] Counter dosyasi ayarlandi: %s\n", play_wav_file);
-
-                    while (!new_file_available && green_input.isCountdown_active) {
-                        vTaskDelay(pdMS_TO_TICKS(10));
-                    }
+                    // Yesil ses henuz caliyorsa sayi arkasina bosluksuz eklenir
+                    // Siradaki sayi zamanlayicidan PROCESS_EVT_COUNTDOWN ile gelir, burada beklenmez
+                    EnqueueConfiguredSound(current_playing_file, PLAY_PRIO_GREEN, NULL, "Counter");
                 }
             }
             
-            // *** GREEN ACTION AYARLAMA ***
+            // *** GREEN ACTION KUYRUGA EKLEME ***
             if ((strcmp(CurrentConfiguration.greenAction, "-") != 0) && 
                 isGreenCountdownAction == true && green_input.confirmed_flag == false) {
                 
-                printf("Yesil bitis sesi ayarlaniyor: %s\n", CurrentConfiguration.greenAction);
-                snprintf(play_wav_file, sizeof(play_wav_file), "/sdcard/%s", CurrentConfiguration.greenAction);
-                new_file_ready = true;
-                new_file_2_ready = false;
-                printf("[PROCESS] Green action dosyasi ayarlandi: %s\n", play_wav_file);
+                EnqueueConfiguredSound(CurrentConfiguration.greenAction, PLAY_PRIO_GREEN, NULL, "Green action");
                 
                 isGreenCountdownAction = false;
             }
+
+            // *** SIRADAKI KLIP IPUCLARI (ON OKUMA) ***
+            // Idle dongusu ve periyodik request tekrar eder; sayacta siradaki sayi bellidir
+            HintNextSound(PLAY_PRIO_IDLE, IdlePlayFlag ? CurrentConfiguration.idleSound : NULL);
+            HintNextSound(PLAY_PRIO_REQUEST, (RequestPlayFlag && req_delay_ms > 0) ? CurrentConfiguration.reqSound1 : NULL);
+            const char *next_green = NULL;
+            if (GreenCounterPlayFlag && green_input.countdown_current > 1) {
+                int next_count = (int)green_input.countdown_current - 1;
+                if (next_count > CurrentConfiguration.greenCountFrom) {
+                    next_count = CurrentConfiguration.greenCountFrom;  // Sessiz fazda ilk konusulan sayi
+                }
+                if (next_count >= CurrentConfiguration.greenCountTo) {
+                    next_green = get_audio_file_path((uint32_t)next_count);
+                }
+            }
+            HintNextSound(PLAY_PRIO_GREEN, next_green);
         }
-        
-    
-    vTaskDelay(pdMS_TO_TICKS(10)); // CPU'yu serbest bırak
   }
 }
 
@@ -664,47 +639,29 @@ void TimerCallback_1000ms(TimerHandle_t xTimer) {
 
   //      //GERI SAYIM...
   if (green_input.isCountdown_active) {
-    static uint32_t current_count = 0;
-    static bool silent_phase = true;
-
-    // İlk çalışmada başlangıç değerlerini ayarla
-    if (current_count == 0) {
-      current_count = green_input.countdown_current;
-      silent_phase = (current_count > ui8_greenCountFrom);
-//      printf("[TIMER] baslangic: %" PRIu8 "->%" PRIu8 " (Su an: %" PRIu32 ")\n",
-//             ui8_greenCountFrom, ui8_greenCountTo, current_count);
-    }
-
-    // Sayım devam ediyorsa
-    if (current_count > ui8_greenCountTo) {
-      current_count--;
-
-      // Sessiz fazdan konuşma fazına geçiş kontrolü
-      if (silent_phase && current_count <= ui8_greenCountFrom) {
-        silent_phase = false;
-//        printf("[TIMER] Konusma fazi basladi (%" PRIu32 ")\n", current_count);
-      }
-
-      // Yalnızca konuşma fazındaysa dosya adını al
-      if (!silent_phase) {
-        const char *new_file_path = get_audio_file_path(current_count);
-
-        if (new_file_path != NULL) {
-          if (strcmp(new_file_path, current_playing_file) != 0) {
-            strncpy(current_playing_file, new_file_path,
-                    sizeof(current_playing_file) - 1);
-            current_playing_file[sizeof(current_playing_file) - 1] = '\0';
-            new_file_available = true;
-          }
+    static Countdown_t s_countdown;
+    uint32_t count = Countdown_Tick(&green_input, &s_countdown, ui8_greenCountFrom, ui8_greenCountTo);
+
+    // Yalnızca konuşma fazındaysa dosya adını al
+    if (count > 0) {
+      const char *new_file_path = get_audio_file_path(count);
+
+      if (new_file_path != NULL) {
+        if (strcmp(new_file_path, current_playing_file) != 0) {
+          strncpy(current_playing_file, new_file_path,
+                  sizeof(current_playing_file) - 1);
+          current_playing_file[sizeof(current_playing_file) - 1] = '\0';
+          new_file_available = true;
+          ProcessThread_Notify(PROCESS_EVT_COUNTDOWN);
+          TraceLog_Add(TRACE_EVT_ANNOUNCE, green_input.pin, 1, 0, count, 0);
         }
       }
-      green_input.countdown_current = current_count;
-    } else {
+    }
+
+    if (!green_input.isCountdown_active) {
       // Sayım tamamlandı
-      green_input.isCountdown_active = false;
-      current_count = 0;
-//      printf("[TIMER] Sayim tamamlandi (%" PRIu8 "e ulasildi)\n",
-//             ui8_greenCountTo);
+      ProcessThread_Notify(PROCESS_EVT_COUNTDOWN);
+      TraceLog_Add(TRACE_EVT_COUNTDOWN, green_input.pin, 0, TRACE_CD_STOPPED, 0, 0);
     }
   }
 
@@ -801,42 +758,46 @@ void mongoose_task(void *pvParameters) {
 
 
 /**
- * @brief FreeRTOS task for handling IO operations, including ADC sampling and pedestrian button logic.
+ * @brief FreeRTOS task for handling IO operations, including the noise history and pedestrian button logic.
  *
- * This task performs periodic ADC readings, updates a noise level history array, and manages GPIO feedback/input routines for pedestrian signaling.
- * It scales and stores the ADC average, updates demand states based on button presses, and clears timing if lamp states meet certain conditions.
- * When a write operation is requested, it deinitializes the ADC and prepares for configuration writing.
+ * This task updates a noise level history array from the ambient level and manages GPIO feedback/input routines for pedestrian signaling.
+ * The microphone itself is sampled by MicADC_Task; this task only stores the published ambient level in dB,
+ * updates demand states based on button presses, and clears timing if lamp states meet certain conditions.
+ * The history runs every IO_POLL_TICKS; input edges captured by the GPIO interrupts wake the task at once, so a button press
+ * is confirmed INPUT_DEBOUNCE_US after its edge instead of after up to three 50 ms polls.
+ * The green and red lamp feedbacks are confirmed and tracked on every wake (TrackInputRequest), which measures the
+ * lamp periods, feeds CycleModel and starts the countdowns.
+ * When a write operation is requested, it stops the ADC stream and prepares for configuration writing; the stream is
+ * restarted once FlashWrite_task has cleared the request.
  *
  * @param[in] pvParameters Pointer to task parameters (unused).
  */
 void IO_Task(void *pvParameters) {
+  uint8_t last_inputs = 0;
+  uint32_t settle_ms = UINT32_MAX;
+  TickType_t last_poll = xTaskGetTickCount();
+  bool poll_due = true;
+  uint32_t last_noise_second = 0;
+
+  GpioEdge_SetConsumer(xTaskGetCurrentTaskHandle());
+  RingStats_Fill(&noise_level_history, 0); // Grafik ilk acilista da tam eksenle baslasin
 
   while (1) {
 
-    if (StopIO_Threat == false && StartWriteConfigs == false) {
+    if (StopIO_Threat == false && StartWriteConfigs == false && adc_handle == NULL) {
+      InitADC(); // Flash yazimi bitti, mikrofon akisini yeniden baslat
+    }
+
+    if (StopIO_Threat == false && StartWriteConfigs == false && poll_due) {
       /**************ADC**************/
-      // ADC oku ve diziye ekle
-      uint32_t sample = ADC_Read_Average(ADC_SAMPLE_COUNT);
-      memmove(&adc_samples[0], &adc_samples[1],
-              (ADC_AVERAGE_COUNT - 1) * sizeof(uint32_t));
-      // Yeni değeri dizinin sonuna ekle
-      adc_samples[ADC_AVERAGE_COUNT - 1] = sample;
-      // Her seferinde ortalamayı yeniden hesapla
-      uint64_t sum =
-          0; // Toplam değeri için daha büyük bir tip kullanmak taşmayı önler.
-      for (int i = 0; i < ADC_AVERAGE_COUNT; i++) {
-        sum += adc_samples[i];
-      }
-      g_adcAverage = sum / ADC_AVERAGE_COUNT;
-      
+      // Seviye MicADC_Task'ta DMA cercevelerinden hesaplanir, burada yalniz gecmise yazilir
       // *** NEW LOGIC FOR HISTORY UPDATE (Once per second) ***
       s_adc_update_counter++;
       if (s_adc_update_counter >=
           UPDATES_PER_SECOND) {   // True every 1 second (every 20th call)
         s_adc_update_counter = 0; // Reset counter for the next second
-                                  // Scale g_adcAverage to 0-150 range
-        double scaled_value_double = (double)g_adcAverage * (150.0 / 4095.0);
-        int current_scaled_value = (int)round(scaled_value_double);
+                                  // Ortam seviyesi dB, 0-150 araligina yuvarlanir
+        int current_scaled_value = (Loudness_GetDb10() + 5) / 10;
 
         // Ensure value stays within 0-150 bounds
         if (current_scaled_value < 0)
@@ -844,23 +805,33 @@ void IO_Task(void *pvParameters) {
         if (current_scaled_value > 150)
           current_scaled_value = 150;
 
-        memmove(&noise_level_history[0], &noise_level_history[1],
-                (NOISE_LEVEL_HISTORY_SIZE - 1) * sizeof(int));
-        noise_level_history[NOISE_LEVEL_HISTORY_SIZE - 1] =
-            current_scaled_value;
+        RingStats_Push(&noise_level_history, current_scaled_value);
+
+        // Grafik 100 ms'de bir, katmanli gecmis saniyede bir kayit alir
+        uint32_t noise_second = NoiseHistory_Now();
+        if (noise_second != last_noise_second) {
+          last_noise_second = noise_second;
+          NoiseHistory_Push(Loudness_GetDb10());
+        }
 
         // ESP_LOGI("TimerCallback", "Gecmis dizi guncellendi. Son eklenen
         // deger: %d", current_scaled_value);
       }
 
+    }
+
+    if (StopIO_Threat == false && StartWriteConfigs == false) {
       /**************GPIO**************/
+      settle_ms = ProcessInputEdges(); // Kesmelerle yakalanan kenarlar
+      LampPcnt_Update(esp_timer_get_time()); // Flas/sabit siniflandirmasi, pencere basina bir sayac okumasi
       // DetectFeedBack(&User_button_input);
       // DetectFeedBack(&No_demand_input);
       DetectPedestrianDemandFeedback();
-      //DetectGreenFeedback();
-      //DetectRedFeedback();
-      //TrackInputRequest(&green_input); // <-- Talep süresi takibi, IO 35
-      //TrackInputRequest(&red_input);   // <-- Talep süresi takib, IO 32
+      DetectGreenFeedback();
+      DetectRedFeedback();
+      // Her uyanista cagrilir: kenar olmasa da olcum sonu (2 s karanlik) burada yakalanir
+      TrackInputRequest(&green_input); // <-- Talep süresi takibi, IO 35
+      TrackInputRequest(&red_input);   // <-- Talep süresi takib, IO 32
 
       
       if (green_input.isCountdown_active == true) {
@@ -911,10 +882,18 @@ void IO_Task(void *pvParameters) {
         printf("Buton talebi algilandi.\n");
       }
       // Yeşil ışık aktifse ve daha önce talep edilmişse
-      if (green_input.confirmed_flag) {
+      if (green_input.confirmed_flag && Demand_input.isDemandActive) {
         Demand_input.isDemandActive = false; // talebi yesil yanan ve sil.
         printf("Buton talebi temizlendi.\n");
       }
+
+      // Karar veren girislerden biri degistiyse Process_Thread'i uyandir
+      uint8_t inputs = (uint8_t)((Demand_input.isDemandActive ? 1 : 0) | (green_input.confirmed_flag ? 2 : 0) |
+                                 (green_input.isCountdown_active ? 4 : 0) | (isGreenCountdownAction ? 8 : 0));
+      if (inputs != last_inputs) {
+        last_inputs = inputs;
+        ProcessThread_Notify(PROCESS_EVT_INPUT);
+      }
     }
 
     if (StopIO_Threat == true && StartWriteConfigs == false) {
@@ -922,7 +901,20 @@ void IO_Task(void *pvParameters) {
       printf("ADC DEINIT\n");
       StartWriteConfigs = true;
     }
-    vTaskDelay(50);
+
+    // Siradaki periyoda kadar veya bir kenar gelene kadar bekle; onay bekleyen kenar varsa o ana kadar
+    TickType_t now = xTaskGetTickCount();
+    TickType_t elapsed = now - last_poll;
+    TickType_t wait = (elapsed < IO_POLL_TICKS) ? IO_POLL_TICKS - elapsed : 0;
+    if (settle_ms != UINT32_MAX && pdMS_TO_TICKS(settle_ms) + 1 < wait) {
+      wait = pdMS_TO_TICKS(settle_ms) + 1;
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
+
+    poll_due = (xTaskGetTickCount() - last_poll) >= IO_POLL_TICKS;
+    if (poll_due) {
+      last_poll = xTaskGetTickCount();
+    }
   }
 }
 
@@ -934,64 +926,15 @@ void IO_Task(void *pvParameters) {
 /**
  * @brief FreeRTOS task for playing WAV audio files.
  *
- * This task checks if a new audio file (or two sequential files) is ready to play.
- * It copies the file paths, plays the first audio file, and if a second file is ready, waits 50ms and plays the second file.
- * Playback duration is measured and printed for each file.
- * The audio_playing flag is set while playback is active and reset after both files are played.
+ * This task drains the playback queue filled by Process_Thread. It blocks until a clip is queued,
+ * then plays every queued clip back to back in a single I2S session (see PlayQueue_RunSession()).
+ * There is no polling: the task sleeps on the queue semaphore while nothing is to be played.
  *
  * @param[in] pvParameters Pointer to task parameters (unused).
  */
 void PlayWav_Task(void *pvParameters) {
-    char local_file_path[60];
-    char local_file_path_2[60];
-    
     while (1) {
-        // Yeni dosya hazır mı kontrol et
-        if (new_file_ready && !audio_playing) {
-            // Dosya yollarını kopyala
-            strcpy(local_file_path, play_wav_file);
-            bool has_second_file = new_file_2_ready;
-            if (has_second_file) {
-                strcpy(local_file_path_2, play_wav_file_2);
-            }
-            
-            new_file_ready = false;
-            new_file_2_ready = false;
-            audio_playing = true;
-            
-            // İLK SES DOSYASINI ÇAL
-            printf("[AUDIO TASK] Caliniyor (1/%s): %s\n", 
-                   has_second_file ? "2" : "1", local_file_path);
-            uint32_t start_time = esp_timer_get_time() / 1000;
-            
-            play_wav(local_file_path);
-            
-            uint32_t end_time = esp_timer_get_time() / 1000;
-            printf("[AUDIO TASK] Tamamlandi (1): %s (sure: %" PRIu32 " ms)\n", 
-                   local_file_path, end_time - start_time);
-            
-            // İKİNCİ SES VARSA ONU DA ÇAL
-            if (has_second_file && strlen(local_file_path_2) > 0) {
-                printf("[AUDIO TASK] Ara gecis... (50ms)\n");
-                vTaskDelay(pdMS_TO_TICKS(50));  // İki ses arası bekle
-                
-                printf("[AUDIO TASK] Caliniyor (2/2): %s\n", local_file_path_2);
-                uint32_t start_time_2 = esp_timer_get_time() / 1000;
-                
-                play_wav(local_file_path_2);
-                
-                uint32_t end_time_2 = esp_timer_get_time() / 1000;
-                printf("[AUDIO TASK] Tamamlandi (2): %s (sure: %" PRIu32 " ms)\n", 
-                       local_file_path_2, end_time_2 - start_time_2);
-                
-                printf("[AUDIO TASK] REQUEST SEQUENCE TAMAMLANDI!\n");
-            }
-            
-            audio_playing = false; // Tüm sesler bitti
-            printf("[AUDIO TASK] Audio playing = false\n");
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(50));
+        PlayQueue_RunSession();
     }
 }
 
@@ -1128,7 +1071,14 @@ void FlashWrite_task(void *pvParameters) {
       StartWriteConfigs = false;
       StopIO_Threat = false;
     }
+    if (CycleModel_SaveDue()) {
+      CycleModel_Save();
+    }
+    if (NoiseHistory_CheckpointDue()) {
+      NoiseHistory_Checkpoint();
+    }
     if (isOtaDone == true) {
+      NoiseHistory_Checkpoint(); // Yeniden baslamadan gecmisi koru
       vTaskDelay(200);
       esp_restart();
     }
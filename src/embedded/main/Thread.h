@@ -10,6 +10,22 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_bit_defs.h"
+#include "RingStats.h"
+
+// Process_Thread'i uyandiran olaylar
+#define PROCESS_EVT_INPUT      BIT0    // Talep veya yesil giris durumu degisti
+#define PROCESS_EVT_PLAN       BIT1    // Aktif plan/ses ayari degisti
+#define PROCESS_EVT_COUNTDOWN  BIT2    // Yeni geri sayim dosyasi hazir veya sayim bitti
+#define PROCESS_EVT_PLAYBACK   BIT3    // Klip bitti veya kuyruk bosaldi
+#define PROCESS_EVT_TEST       BIT4    // Web arayuzunden test sesi istendi
+#define PROCESS_EVT_ALL        (PROCESS_EVT_INPUT | PROCESS_EVT_PLAN | PROCESS_EVT_COUNTDOWN | \
+                                PROCESS_EVT_PLAYBACK | PROCESS_EVT_TEST)
+
+#define NOISE_LEVEL_HISTORY_SIZE 15 // Son 15 olcumluk veriyi sakla
+#define NOISE_LEVEL_BUCKET_DB    5  // Yuzdelik kovalari 5 dB genisliginde
+#define NOISE_LEVEL_BUCKETS      (150 / NOISE_LEVEL_BUCKET_DB)
 
 
 
@@ -18,6 +34,7 @@ void TimerCallback_50ms(TimerHandle_t xTimer);
 void TimerCallback_500ms(TimerHandle_t xTimer);
 void TimerCallback_1000ms(TimerHandle_t xTimer);
 void Timer_Threads_Init(void);
+void ProcessThread_Notify(EventBits_t events);
 void mongoose_task(void *pvParameters);
 void PlayWav_Task(void *pvParameters);
 void FlashWrite_task(void *pvParameters);
@@ -45,4 +62,5 @@ extern bool ui8_isReqActive;
 extern bool ui8_isGreenActive;
 extern uint8_t RequestSoundPlaybackPeriod;
 extern char *TAG_GLUE; 
+extern RingStats_t noise_level_history;
 #endif /* MAIN_THREAD_H_ */
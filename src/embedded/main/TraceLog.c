@@ -0,0 +1,301 @@
+/*
+ * TraceLog.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Binary trace of the signal transitions and countdown decisions, kept on the SD card.
+ *
+ * Producers (IO_Task, the 1 s timer, Process_Thread) append fixed 12-byte records to a RAM ring under a
+ * short spinlock; nothing touches the SD card on their path. A low-priority writer task drains the ring in
+ * batches, when it is half full or every TRACE_FLUSH_MS, appending straight from the ring slots to
+ * TRACE_FILE_PATH. The file is opened for each batch and closed right after it, so no handle stays open
+ * between flushes (FATFS_FS_LOCK is off; the trace files are also protected from the SD delete and upload
+ * paths). Readers that keep a trace file open across several calls, the /api/trace download and the replay,
+ * bracket it with TraceLog_ExportBegin()/TraceLog_ExportEnd(); meanwhile no flush or rotation runs and the
+ * records wait in the ring.
+ * When the file would exceed TRACE_FILE_MAX_BYTES it becomes TRACE_FILE_PREV_PATH and a new file is
+ * started. Each new file, and the first batch after boot, begins with a TRACE_EVT_CLOCK record that ties
+ * the boot-relative millisecond stamps to the RTC epoch. While no card is mounted the records wait in the
+ * ring; once it is full new records are dropped and counted.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "TraceLog.h"
+#include "NoiseHistory.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RING_MASK   (TRACE_RING_LEN - 1)
+
+static const char *TAG_TRACE = "TRACE";
+
+static TraceRecord_t s_ring[TRACE_RING_LEN];
+static uint32_t s_head = 0;                 // Ureticiler kilit altinda yazar
+static uint32_t s_tail = 0;                 // Yalniz yazici gorev kilit altinda yazar
+static portMUX_TYPE s_traceMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_writerTask = NULL;
+static TraceLogStats_t s_stats;
+
+static uint32_t s_exports = 0;              // Dosyayi okuyan acik disa aktarim sayisi
+static bool s_flushing = false;             // Yazici dosyaya dokunuyor
+
+static FILE *s_fp = NULL;
+static uint32_t s_fileBytes = 0;
+static bool s_bootClock = true;
+
+
+
+/* Dosya basina ayni andaki acilis zamani ve epoch'u yazar (NoiseHistory_Now ile ayni taban) */
+static bool write_clock(void)
+{
+    TraceRecord_t rec = {
+        .time_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .type = TRACE_EVT_CLOCK,
+        .state = s_bootClock ? 1 : 0,
+        .value = NoiseHistory_Now(),
+    };
+    if (fwrite(&rec, sizeof(rec), 1, s_fp) != 1) return false;
+    s_fileBytes += sizeof(rec);
+    s_bootClock = false;
+    return true;
+}
+
+/* Iz dosyasini ekleme kipinde acar, yeni dosyaya ve acilistan sonra ilk kez saat kaydi yazar; kart yoksa false */
+static bool open_file(void)
+{
+    if (s_fp != NULL) return true;
+    if (!is_sd_card_mounted()) return false;
+
+    s_fp = fopen(TRACE_FILE_PATH, "ab");
+    if (s_fp == NULL) {
+        ESP_LOGW(TAG_TRACE, "%s acilamadi", TRACE_FILE_PATH);
+        return false;
+    }
+    struct stat st;
+    s_fileBytes = (stat(TRACE_FILE_PATH, &st) == 0) ? (uint32_t)st.st_size : 0;
+    if ((s_bootClock || s_fileBytes == 0) && !write_clock()) {
+        fclose(s_fp);
+        s_fp = NULL;
+        return false;
+    }
+    return true;
+}
+
+/* Dosyayi diske yazip kapatir; tutamac yigin arasinda acik kalmaz */
+static void close_file(void)
+{
+    if (s_fp == NULL) return;
+    fflush(s_fp);
+    fsync(fileno(s_fp));  // Dizin girisindeki boyut guncellensin, /api/trace yeni kayitlari gorsun
+    fclose(s_fp);
+    s_fp = NULL;
+}
+
+/* Dolan dosyayi onceki dosya yapar, yenisini baslatir */
+static bool rotate_file(void)
+{
+    fclose(s_fp);
+    s_fp = NULL;
+    remove(TRACE_FILE_PREV_PATH);
+    if (rename(TRACE_FILE_PATH, TRACE_FILE_PREV_PATH) != 0) {
+        ESP_LOGW(TAG_TRACE, "Dosya dondurulemedi, bastan yaziliyor");
+        remove(TRACE_FILE_PATH);
+    }
+    s_stats.rotations++;
+    return open_file();
+}
+
+/* Halkadaki kayitlari dosyaya ekler; yuvalar yazilana kadar ureticilere kapali kalir */
+static void write_ring(void)
+{
+    portENTER_CRITICAL(&s_traceMux);
+    uint32_t head = s_head;
+    portEXIT_CRITICAL(&s_traceMux);
+
+    uint32_t tail = s_tail;
+    if (head == tail || !open_file()) return;
+
+    if (s_fileBytes + (head - tail) * sizeof(TraceRecord_t) > TRACE_FILE_MAX_BYTES && !rotate_file()) return;
+
+    while (tail != head) {
+        uint32_t idx = tail & RING_MASK;
+        uint32_t n = head - tail;
+        if (n > TRACE_RING_LEN - idx) n = TRACE_RING_LEN - idx;  // Halka sonunda iki parcada yazilir
+        size_t done = fwrite(&s_ring[idx], sizeof(TraceRecord_t), n, s_fp);
+        s_fileBytes += done * sizeof(TraceRecord_t);
+        tail += done;
+        if (done < n) {
+            ESP_LOGW(TAG_TRACE, "SD yazma hatasi, dosya kapatildi");
+            fclose(s_fp);
+            s_fp = NULL;
+            break;
+        }
+    }
+    close_file();
+
+    portENTER_CRITICAL(&s_traceMux);
+    s_stats.written += tail - s_tail;
+    s_tail = tail;
+    portEXIT_CRITICAL(&s_traceMux);
+}
+
+/* Disa aktarim yoksa halkayi yazar; varsa kayitlar halkada bekler */
+static void flush_ring(void)
+{
+    portENTER_CRITICAL(&s_traceMux);
+    s_flushing = (s_exports == 0);
+    bool run = s_flushing;
+    portEXIT_CRITICAL(&s_traceMux);
+    if (!run) return;
+
+    write_ring();
+
+    portENTER_CRITICAL(&s_traceMux);
+    s_flushing = false;
+    portEXIT_CRITICAL(&s_traceMux);
+}
+
+/* Yazici gorev: esik bildirimi ya da TRACE_FLUSH_MS ile halkayi bosaltir */
+static void TraceLog_Task(void *pvParameters)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TRACE_FLUSH_MS));
+        flush_ring();
+    }
+}
+
+
+
+/**
+ * @brief      Starts the trace writer task.
+ *
+ * @return     ESP_OK on success, ESP_FAIL if the task could not be created.
+ *
+ * @details
+ * Records added before this call are dropped. The SD card does not have to be mounted yet; the file is
+ * opened on the first flush that finds a card. Calling the function again has no effect.
+ */
+esp_err_t TraceLog_Init(void)
+{
+    if (s_writerTask != NULL) return ESP_OK;
+
+    if (xTaskCreate(TraceLog_Task, "TraceLog_Task", TRACE_TASK_STACK, NULL,
+                    TRACE_TASK_PRIORITY, &s_writerTask) != pdPASS) {
+        ESP_LOGE(TAG_TRACE, "TraceLog_Task olusturulamadi");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG_TRACE, "Iz kaydi hazir: %d kayitlik halka, %s", TRACE_RING_LEN, TRACE_FILE_PATH);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief      Appends one record to the trace ring.
+ *
+ * @param[in]  type     Event type.
+ * @param[in]  pin      GPIO of the input the event belongs to.
+ * @param[in]  level    Input level, or the event specific byte described at TraceEvent_t.
+ * @param[in]  state    Event specific state byte.
+ * @param[in]  value    Event specific value.
+ * @param[in]  time_us  Event time from esp_timer_get_time(); 0 stamps the current time.
+ *
+ * @details
+ * Safe from any task; takes a spinlock for a few instructions and never blocks. Not for ISR use.
+ */
+void TraceLog_Add(TraceEvent_t type, uint8_t pin, uint8_t level, uint8_t state, uint32_t value, int64_t time_us)
+{
+    if (s_writerTask == NULL) return;
+    if (time_us == 0) time_us = esp_timer_get_time();
+
+    bool wake = false;
+    portENTER_CRITICAL(&s_traceMux);
+    uint32_t used = s_head - s_tail;
+    if (used >= TRACE_RING_LEN) {
+        s_stats.dropped++;
+    } else {
+        TraceRecord_t *rec = &s_ring[s_head & RING_MASK];
+        rec->time_ms = (uint32_t)(time_us / 1000);
+        rec->type = (uint8_t)type;
+        rec->pin = pin;
+        rec->level = level;
+        rec->state = state;
+        rec->value = value;
+        s_head++;
+        s_stats.recorded++;
+        wake = (used + 1 == TRACE_FLUSH_THRESHOLD);
+    }
+    portEXIT_CRITICAL(&s_traceMux);
+
+    if (wake) xTaskNotifyGive(s_writerTask);
+}
+
+
+
+/**
+ * @brief      Asks the writer task to flush the ring now instead of at the next period.
+ */
+void TraceLog_Flush(void)
+{
+    if (s_writerTask != NULL) xTaskNotifyGive(s_writerTask);
+}
+
+
+
+/**
+ * @brief      Keeps the writer away from the trace files while a reader has one open.
+ *
+ * @details
+ * Waits for a flush that is already running (one batch) to close the file, then holds off flushes and
+ * rotation until the matching TraceLog_ExportEnd(). Records keep going to the ring; if it fills up before
+ * the export ends, new records are dropped and counted. Calls may nest, e.g. two downloads at once.
+ */
+void TraceLog_ExportBegin(void)
+{
+    for (;;) {
+        portENTER_CRITICAL(&s_traceMux);
+        bool idle = !s_flushing;
+        if (idle) s_exports++;
+        portEXIT_CRITICAL(&s_traceMux);
+        if (idle) return;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+
+
+/**
+ * @brief      Ends an export started with TraceLog_ExportBegin() and flushes the records that waited.
+ */
+void TraceLog_ExportEnd(void)
+{
+    portENTER_CRITICAL(&s_traceMux);
+    if (s_exports > 0) s_exports--;
+    portEXIT_CRITICAL(&s_traceMux);
+    TraceLog_Flush();
+}
+
+
+
+/**
+ * @brief      Copies the trace counters.
+ *
+ * @param[out] stats Receives the counters.
+ */
+void TraceLog_GetStats(TraceLogStats_t *stats)
+{
+    portENTER_CRITICAL(&s_traceMux);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_traceMux);
+}
@@ -0,0 +1,79 @@
+/*
+ * TraceLog.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_TRACELOG_H_
+#define MAIN_TRACELOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "SD_SPI.h"
+
+// RAM halkasi (kayit sayisi, 2'nin kuvveti); yarisi dolunca yazici uyandirilir
+#ifndef TRACE_RING_LEN
+#define TRACE_RING_LEN          256
+#endif
+#define TRACE_FLUSH_THRESHOLD   (TRACE_RING_LEN / 2)
+
+// Halka en gec bu aralikla SD'ye bosaltilir
+#ifndef TRACE_FLUSH_MS
+#define TRACE_FLUSH_MS          5000
+#endif
+
+// Dosya bu boyutu gecince onceki dosyaya doner, en fazla iki dosya tutulur
+#ifndef TRACE_FILE_MAX_BYTES
+#define TRACE_FILE_MAX_BYTES    (256 * 1024)
+#endif
+
+#define TRACE_FILE_PATH         MOUNT_POINT"/trace.bin"
+#define TRACE_FILE_PREV_PATH    MOUNT_POINT"/trace1.bin"
+
+#define TRACE_TASK_STACK        (1024 * 3)
+#define TRACE_TASK_PRIORITY     2   // PlayWav_Task (3) altinda, SD'yi sesten once tutmasin
+
+typedef enum {
+    TRACE_EVT_CLOCK = 0,    // Dosya basi: value = time_ms anindaki epoch (s), state = 1 acilista
+    TRACE_EVT_EDGE,         // Onaylanan giris gecisi: level, state = light_mode, value = flas periyodu (ms)
+    TRACE_EVT_MEASURE,      // Olcum sonu: state = olcum sayisi, value = toplam sure (ms)
+    TRACE_EVT_COUNTDOWN,    // Geri sayim karari: level = guven, state = TraceCountdownSource_t, value = baslangic (s)
+    TRACE_EVT_ANNOUNCE,     // Geri sayim anonsu: value = okunan sayi
+} TraceEvent_t;
+
+typedef enum {
+    TRACE_CD_STOPPED = 0,
+    TRACE_CD_NONE,          // Ilk olcum, tahmin yok
+    TRACE_CD_MEASURED,      // Onceki olcumden
+    TRACE_CD_MODEL,         // CycleModel tahmininden
+} TraceCountdownSource_t;
+
+// Dosyadaki kayit: little-endian, 12 byte
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;       // Acilistan beri (esp_timer)
+    uint8_t  type;          // TraceEvent_t
+    uint8_t  pin;
+    uint8_t  level;
+    uint8_t  state;
+    uint32_t value;
+} TraceRecord_t;
+
+_Static_assert(sizeof(TraceRecord_t) == 12, "TraceRecord_t 12 byte olmali");
+
+typedef struct {
+    uint32_t recorded;      // Halkaya alinan kayit
+    uint32_t dropped;       // Halka doluyken atilan kayit
+    uint32_t written;       // SD'ye yazilan kayit
+    uint32_t rotations;
+} TraceLogStats_t;
+
+esp_err_t TraceLog_Init(void);
+void TraceLog_Add(TraceEvent_t type, uint8_t pin, uint8_t level, uint8_t state, uint32_t value, int64_t time_us);
+void TraceLog_Flush(void);
+void TraceLog_ExportBegin(void);
+void TraceLog_ExportEnd(void);
+void TraceLog_GetStats(TraceLogStats_t *stats);
+
+#endif /* MAIN_TRACELOG_H_ */
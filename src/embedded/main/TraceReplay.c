@@ -0,0 +1,385 @@
+/*
+ * TraceReplay.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Replays a recorded or synthetic signal trace through the countdown logic in accelerated time.
+ *
+ * The trace (TraceLog format) is streamed from the SD card in TRACE_REPLAY_CHUNK record blocks. Green and
+ * red edge records drive private replay copies of the lamp inputs through TrackInputRequestAt(), and a
+ * simulated 1 s tick runs Countdown_Tick() exactly as TimerCallback_1000ms does, so the real measurement
+ * and countdown code is exercised without a signal controller. Demand edge records drive a replay copy of the
+ * demand input through DetectPedestrianDemandFeedbackAt() on the same tick, which counts the demands and
+ * the stuck input alarms. Time only advances from record to record,
+ * so hours of traffic replay in well under a second. The announcements produced are matched in order against
+ * the TRACE_EVT_ANNOUNCE records of the trace; a synthetic trace may omit them and only read the counters.
+ * A boot record or a step back in time resets the replay state, as the device restarted there.
+ *
+ * TraceReplay_Start() runs the replay in a low-priority task of its own, so the web server keeps polling while
+ * the file is read from the SD card; TraceReplay_GetResult() returns the outcome once it is done. Files larger
+ * than TRACE_REPLAY_MAX_BYTES are refused. While the task reads, TraceLog is held off (TraceLog_ExportBegin),
+ * so the trace file is neither appended to nor rotated under the reader.
+ *
+ * The replay copies are marked replay: they do not print, do not touch CycleModel, the trace, the alarm log
+ * or the device status, so a replay can run on a live unit. Countdowns that were started from a CycleModel prediction
+ * on the device show up as missed announcements, since the replay only models the measured countdown.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "TraceReplay.h"
+#include "TraceLog.h"
+#include "DetectTraffic.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define REPLAY_TICK_MS  1000
+
+typedef struct {
+    uint32_t count;
+    uint32_t time_ms;
+} ReplayAnnounce_t;
+
+typedef struct {
+    ReplayAnnounce_t item[TRACE_REPLAY_PENDING];
+    uint8_t head;
+    uint8_t len;
+} ReplayFifo_t;
+
+typedef struct {
+    InputDebounce_t green;
+    InputDebounce_t red;
+    InputDebounce_t demand;
+    DemandTrack_t demand_track;
+    Countdown_t countdown;
+    uint32_t next_tick_ms;
+    bool started;
+    ReplayFifo_t sim;           // Benzetimin anonslari
+    ReplayFifo_t rec;           // Izdeki anonslar
+    uint32_t count_from;
+    uint32_t count_to;
+    TraceReplayResult_t *res;
+} ReplayState_t;
+
+static const char *TAG_REPLAY = "TRACE_REPLAY";
+
+// Arka plan oynatmasi: is Start'ta yazilir, sonuc gorev bitince kilit altinda yayinlanir
+static struct {
+    char path[64];
+    uint32_t count_from;
+    uint32_t count_to;
+} s_job;
+static TraceReplayResult_t s_result;
+static esp_err_t s_resultErr = ESP_OK;
+static TraceReplayState_t s_state = TRACE_REPLAY_IDLE;
+static portMUX_TYPE s_replayMux = portMUX_INITIALIZER_UNLOCKED;
+
+
+
+/* Kuyrugun basi */
+static inline ReplayAnnounce_t *fifo_front(ReplayFifo_t *f)
+{
+    return &f->item[f->head];
+}
+
+/* Kuyrugun basini atar */
+static inline void fifo_pop(ReplayFifo_t *f)
+{
+    f->head = (uint8_t)((f->head + 1) % TRACE_REPLAY_PENDING);
+    f->len--;
+}
+
+/* Kuyruga ekler; doluysa en eskiyi atar ve false doner */
+static bool fifo_push(ReplayFifo_t *f, uint32_t count, uint32_t time_ms)
+{
+    bool dropped = false;
+    if (f->len == TRACE_REPLAY_PENDING) {
+        fifo_pop(f);
+        dropped = true;
+    }
+    ReplayAnnounce_t *a = &f->item[(f->head + f->len) % TRACE_REPLAY_PENDING];
+    a->count = count;
+    a->time_ms = time_ms;
+    f->len++;
+    return !dropped;
+}
+
+/* Iki taraftaki anonslari sirasiyla eslestirir; esit olmayan ciftte erken olan atilir */
+static void match_announces(ReplayState_t *st)
+{
+    while (st->sim.len > 0 && st->rec.len > 0) {
+        ReplayAnnounce_t *s = fifo_front(&st->sim);
+        ReplayAnnounce_t *r = fifo_front(&st->rec);
+        if (s->count == r->count) {
+            uint32_t skew = (s->time_ms > r->time_ms) ? s->time_ms - r->time_ms : r->time_ms - s->time_ms;
+            if (skew > st->res->max_skew_ms) st->res->max_skew_ms = skew;
+            st->res->matched++;
+            fifo_pop(&st->sim);
+            fifo_pop(&st->rec);
+        } else if (s->time_ms <= r->time_ms) {
+            st->res->extra++;
+            fifo_pop(&st->sim);
+        } else {
+            st->res->missed++;
+            fifo_pop(&st->rec);
+        }
+    }
+}
+
+/* Replay kopyalarini bos cihaz durumuna getirir; isaret Init'ten once konur ki kopyalar yazmasin */
+static void reset_inputs(ReplayState_t *st)
+{
+    st->green.pin = green_input.pin;
+    st->red.pin = red_input.pin;
+    st->demand.pin = Demand_input.pin;
+    st->green.replay = st->red.replay = st->demand.replay = true;
+    InputDebounce_Init(&st->green, "REPLAY_GREEN");
+    InputDebounce_Init(&st->red, "REPLAY_RED");
+    InputDebounce_Init(&st->demand, "REPLAY_DEMAND");
+    st->res->demand_alarms += st->demand_track.alarms;
+    memset(&st->demand_track, 0, sizeof(st->demand_track));
+    memset(&st->countdown, 0, sizeof(st->countdown));
+    st->started = false;
+}
+
+/* Bir girisi izler, biten olcumu sayar */
+static void track(ReplayState_t *st, InputDebounce_t *input, uint32_t now_ms)
+{
+    bool was_counting = input->counting;
+    TrackInputRequestAt(input, now_ms);
+    if (was_counting && !input->counting) st->res->measurements++;
+}
+
+/* Talep girisini izler, onaylanan talebi sayar */
+static void track_demand(ReplayState_t *st, uint32_t now_ms)
+{
+    bool was_high = st->demand.confirmed_flag;
+    bool initialized = st->demand_track.initialized;
+    DetectPedestrianDemandFeedbackAt(&st->demand, &st->demand_track, now_ms);
+    if (initialized && !was_high && st->demand.confirmed_flag) st->res->demands++;
+}
+
+/* Benzetim saatini verilen zamana kadar 1 s adimlarla ilerletir */
+static void advance_to(ReplayState_t *st, uint32_t time_ms)
+{
+    if (!st->started) {
+        st->next_tick_ms = time_ms + REPLAY_TICK_MS;
+        st->started = true;
+        track_demand(st, time_ms);  // Acilistaki gibi baslangic seviyesi (LOW) alinir
+        return;
+    }
+    while ((int32_t)(time_ms - st->next_tick_ms) >= 0) {
+        uint32_t now = st->next_tick_ms;
+        track(st, &st->green, now);
+        track(st, &st->red, now);
+        track_demand(st, now);
+        if (st->green.isCountdown_active) {
+            uint32_t count = Countdown_Tick(&st->green, &st->countdown, st->count_from, st->count_to);
+            if (count > 0) {
+                st->res->announced++;
+                if (!fifo_push(&st->sim, count, now)) st->res->extra++;
+                match_announces(st);
+            }
+        }
+        st->next_tick_ms += REPLAY_TICK_MS;
+    }
+}
+
+/* Tek kaydi oynatir */
+static void replay_record(ReplayState_t *st, const TraceRecord_t *rec, uint32_t *last_ms)
+{
+    bool restarted = (rec->type == TRACE_EVT_CLOCK && rec->state == 1) ||
+                     (st->started && (int32_t)(rec->time_ms - *last_ms) < 0);
+    if (restarted) {
+        match_announces(st);
+        reset_inputs(st);
+        st->res->boots++;
+    }
+    advance_to(st, rec->time_ms);
+    *last_ms = rec->time_ms;
+
+    switch (rec->type) {
+    case TRACE_EVT_EDGE: {
+        if (rec->pin == st->demand.pin) {
+            st->demand.debounced_level = (rec->level != 0);
+            st->demand.timestamp = (int64_t)rec->time_ms * 1000;
+            track_demand(st, rec->time_ms);
+            break;
+        }
+        InputDebounce_t *input = NULL;
+        if (rec->pin == st->green.pin) input = &st->green;
+        else if (rec->pin == st->red.pin) input = &st->red;
+        if (input == NULL) break;  // Diger girisler geri sayimi etkilemez
+
+        input->light_mode = (LightMode)rec->state;
+        input->flash_period_ms = (uint16_t)rec->value;
+        input->confirmed_flag = input->debounced_level = (rec->level != 0);
+        input->timestamp = (int64_t)rec->time_ms * 1000;
+        track(st, input, rec->time_ms);
+        st->res->edges++;
+        break;
+    }
+    case TRACE_EVT_ANNOUNCE:
+        st->res->expected++;
+        if (!fifo_push(&st->rec, rec->value, rec->time_ms)) st->res->missed++;
+        match_announces(st);
+        break;
+    default:
+        break;
+    }
+}
+
+
+
+/**
+ * @brief      Replays a trace file and compares the resulting announcements with the recorded ones.
+ *
+ * @param[in]  path        Trace file, e.g. TRACE_FILE_PATH or an uploaded synthetic trace.
+ * @param[in]  count_from  greenCountFrom to replay with.
+ * @param[in]  count_to    greenCountTo to replay with.
+ * @param[out] res         Replay counters; valid even when an error is returned after the file was opened.
+ * @return     ESP_OK, ESP_ERR_NOT_FOUND if the file cannot be opened, ESP_ERR_INVALID_ARG if it is larger than
+ *             TRACE_REPLAY_MAX_BYTES, ESP_ERR_INVALID_SIZE if the file does not hold whole records.
+ *
+ * @details
+ * Runs synchronously: the record block and the replay state take about 1.5 KB of the caller's stack. The
+ * device runs it through TraceReplay_Start(); the host test calls it directly. Announcements are produced with a 1 s tick phase of their own; max_skew_ms of up to one
+ * tick is expected.
+ */
+esp_err_t TraceReplay_Run(const char *path, uint32_t count_from, uint32_t count_to, TraceReplayResult_t *res)
+{
+    memset(res, 0, sizeof(*res));
+    struct stat fs;
+    if (stat(path, &fs) != 0) return ESP_ERR_NOT_FOUND;
+    if (fs.st_size > TRACE_REPLAY_MAX_BYTES) return ESP_ERR_INVALID_ARG;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return ESP_ERR_NOT_FOUND;
+
+    int64_t start_us = esp_timer_get_time();
+    ReplayState_t st;
+    memset(&st, 0, sizeof(st));
+    st.count_from = count_from;
+    st.count_to = count_to;
+    st.res = res;
+    reset_inputs(&st);
+
+    TraceRecord_t block[TRACE_REPLAY_CHUNK];
+    uint32_t first_ms = 0, last_ms = 0;
+    size_t n;
+    esp_err_t err = ESP_OK;
+
+    while ((n = fread(block, 1, sizeof(block), fp)) > 0) {
+        if (n % sizeof(TraceRecord_t) != 0) err = ESP_ERR_INVALID_SIZE;  // Yarim kayit atlanir
+        n /= sizeof(TraceRecord_t);
+        for (size_t i = 0; i < n; i++) {
+            if (res->records == 0) first_ms = block[i].time_ms;
+            replay_record(&st, &block[i], &last_ms);
+            res->records++;
+        }
+    }
+    fclose(fp);
+
+    // Son anonslarin eslesebilmesi icin bir geri sayim boyu daha ilerle
+    advance_to(&st, last_ms + (count_from + 1) * REPLAY_TICK_MS);
+    match_announces(&st);
+    res->extra += st.sim.len;
+    res->missed += st.rec.len;
+    res->demand_alarms += st.demand_track.alarms;
+
+    res->span_ms = last_ms - first_ms;
+    res->elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    ESP_LOGI(TAG_REPLAY, "%s: %lu kayit, %lu ms trafik %lu ms'de; anons %lu/%lu eslesti, %lu eksik, %lu fazla, sapma %lu ms; "
+             "talep %lu, talep alarmi %lu",
+             path, (unsigned long)res->records, (unsigned long)res->span_ms, (unsigned long)res->elapsed_ms,
+             (unsigned long)res->matched, (unsigned long)res->expected, (unsigned long)res->missed,
+             (unsigned long)res->extra, (unsigned long)res->max_skew_ms, (unsigned long)res->demands,
+             (unsigned long)res->demand_alarms);
+    return err;
+}
+
+
+
+/* Oynatma gorevi: isi calistirir, sonucu yayinlar ve kendini siler */
+static void TraceReplay_Task(void *pvParameters)
+{
+    TraceReplayResult_t res;
+    TraceLog_ExportBegin();
+    esp_err_t err = TraceReplay_Run(s_job.path, s_job.count_from, s_job.count_to, &res);
+    TraceLog_ExportEnd();
+
+    portENTER_CRITICAL(&s_replayMux);
+    s_result = res;
+    s_resultErr = err;
+    s_state = TRACE_REPLAY_DONE;
+    portEXIT_CRITICAL(&s_replayMux);
+    vTaskDelete(NULL);
+}
+
+
+
+/**
+ * @brief      Starts replaying a trace file in a background task.
+ *
+ * @param[in]  path        Trace file, at most 63 characters.
+ * @param[in]  count_from  greenCountFrom to replay with.
+ * @param[in]  count_to    greenCountTo to replay with.
+ * @return     ESP_OK when the task was started, ESP_ERR_INVALID_STATE while a replay is running,
+ *             ESP_ERR_INVALID_ARG for a path that is too long, ESP_ERR_NO_MEM if the task could not be created.
+ *
+ * @details
+ * Returns at once; poll TraceReplay_GetResult() for the outcome. The previous result is dropped when a new
+ * replay starts. Only one replay runs at a time.
+ */
+esp_err_t TraceReplay_Start(const char *path, uint32_t count_from, uint32_t count_to)
+{
+    if (strlen(path) >= sizeof(s_job.path)) return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&s_replayMux);
+    bool busy = (s_state == TRACE_REPLAY_RUNNING);
+    if (!busy) s_state = TRACE_REPLAY_RUNNING;
+    portEXIT_CRITICAL(&s_replayMux);
+    if (busy) return ESP_ERR_INVALID_STATE;
+
+    strcpy(s_job.path, path);
+    s_job.count_from = count_from;
+    s_job.count_to = count_to;
+    if (xTaskCreate(TraceReplay_Task, "TraceReplay_Task", TRACE_REPLAY_TASK_STACK, NULL,
+                    TRACE_REPLAY_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG_REPLAY, "TraceReplay_Task olusturulamadi");
+        portENTER_CRITICAL(&s_replayMux);
+        s_state = TRACE_REPLAY_IDLE;
+        portEXIT_CRITICAL(&s_replayMux);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief      Returns the state of the background replay and, once it is done, its result.
+ *
+ * @param[out] res  Replay counters, written only in TRACE_REPLAY_DONE.
+ * @param[out] err  Return value of TraceReplay_Run(), written only in TRACE_REPLAY_DONE.
+ * @return     TRACE_REPLAY_IDLE, TRACE_REPLAY_RUNNING or TRACE_REPLAY_DONE.
+ */
+TraceReplayState_t TraceReplay_GetResult(TraceReplayResult_t *res, esp_err_t *err)
+{
+    portENTER_CRITICAL(&s_replayMux);
+    TraceReplayState_t state = s_state;
+    if (state == TRACE_REPLAY_DONE) {
+        *res = s_result;
+        *err = s_resultErr;
+    }
+    portEXIT_CRITICAL(&s_replayMux);
+    return state;
+}
@@ -0,0 +1,57 @@
+/*
+ * TraceReplay.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_TRACEREPLAY_H_
+#define MAIN_TRACEREPLAY_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Dosyadan tek seferde okunan kayit sayisi
+#ifndef TRACE_REPLAY_CHUNK
+#define TRACE_REPLAY_CHUNK      64
+#endif
+
+// Eslesmeyi bekleyen anons sayisi (her iki taraf icin)
+#define TRACE_REPLAY_PENDING    16
+
+// Oynatilabilecek en buyuk dosya; cihazin kendi izi (TRACE_FILE_MAX_BYTES) sigar
+#ifndef TRACE_REPLAY_MAX_BYTES
+#define TRACE_REPLAY_MAX_BYTES  (256 * 1024)
+#endif
+
+#define TRACE_REPLAY_TASK_STACK     (1024 * 4)
+#define TRACE_REPLAY_TASK_PRIORITY  1   // TraceLog_Task (2) altinda
+
+typedef enum {
+    TRACE_REPLAY_IDLE = 0,      // Hic oynatma baslatilmadi
+    TRACE_REPLAY_RUNNING,
+    TRACE_REPLAY_DONE,          // Son oynatmanin sonucu hazir
+} TraceReplayState_t;
+
+typedef struct {
+    uint32_t records;           // Okunan kayit
+    uint32_t edges;             // Yesil/kirmizi gecis kaydi
+    uint32_t boots;             // Izdeki acilis sayisi (her biri durumu sifirlar)
+    uint32_t measurements;      // Benzetimde biten olcum
+    uint32_t expected;          // Izde kayitli anons
+    uint32_t announced;         // Benzetimin urettigi anons
+    uint32_t matched;           // Ayni sayi, sirasiyla eslesen anons
+    uint32_t missed;            // Izde olup benzetimde olmayan
+    uint32_t extra;             // Benzetimde olup izde olmayan
+    uint32_t max_skew_ms;       // Eslesen anonslar arasindaki en buyuk zaman farki
+    uint32_t demands;           // Benzetimde onaylanan talep (talep girisinin yukselen kenari)
+    uint32_t demand_alarms;     // Benzetimde takili talep girisi alarmi
+    uint32_t span_ms;           // Oynatilan trafik suresi
+    uint32_t elapsed_ms;        // Oynatmanin suresi
+} TraceReplayResult_t;
+
+esp_err_t TraceReplay_Run(const char *path, uint32_t count_from, uint32_t count_to, TraceReplayResult_t *res);
+esp_err_t TraceReplay_Start(const char *path, uint32_t count_from, uint32_t count_to);
+TraceReplayState_t TraceReplay_GetResult(TraceReplayResult_t *res, esp_err_t *err);
+
+#endif /* MAIN_TRACEREPLAY_H_ */
@@ -0,0 +1,351 @@
+/*
+ * WavIndex.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Keeps an in-RAM index of the WAV files on the SD card.
+ *
+ * The index is built once after the card is mounted and is kept current by the upload and delete paths,
+ * so the real-time code (Process_Thread, directory listing) can look up duration and format information
+ * with a hash table read instead of opening the file and walking its RIFF chunks.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "WavIndex.h"
+#include "SD_SPI.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG_WAVIDX = "WAV_INDEX";
+
+static WavInfo_t s_slots[WAV_INDEX_SLOTS];
+static size_t s_count = 0;
+static SemaphoreHandle_t s_indexMutex = NULL;
+
+_Static_assert((WAV_INDEX_SLOTS & (WAV_INDEX_SLOTS - 1)) == 0, "WAV_INDEX_SLOTS 2'nin kuvveti olmali");
+
+
+
+static void index_lock(void)
+{
+    if (s_indexMutex) xSemaphoreTake(s_indexMutex, portMAX_DELAY);
+}
+
+static void index_unlock(void)
+{
+    if (s_indexMutex) xSemaphoreGive(s_indexMutex);
+}
+
+/* Yoldan dosya adini ayirir ("/sdcard/a.wav" -> "a.wav") */
+static const char *base_name(const char *file_path)
+{
+    const char *p = strrchr(file_path, '/');
+    return p ? p + 1 : file_path;
+}
+
+/* FAT buyuk/kucuk harf duyarsiz oldugu icin hash de duyarsiz (FNV-1a) */
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (uint8_t)tolower((unsigned char)*name++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool is_wav_name(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    return ext && strcasecmp(ext, ".wav") == 0;
+}
+
+/* Ismin bulundugu slotu, yoksa -1 doner. Kilit altinda cagrilmali. */
+static int find_slot(const char *name)
+{
+    uint32_t i = name_hash(name) & (WAV_INDEX_SLOTS - 1);
+    for (int n = 0; n < WAV_INDEX_SLOTS; n++) {
+        if (s_slots[i].name[0] == '\0') return -1;
+        if (strcasecmp(s_slots[i].name, name) == 0) return (int)i;
+        i = (i + 1) & (WAV_INDEX_SLOTS - 1);
+    }
+    return -1;
+}
+
+/* Kaydi ekler veya gunceller. Kilit altinda cagrilmali. */
+static bool insert_locked(const WavInfo_t *info)
+{
+    uint32_t i = name_hash(info->name) & (WAV_INDEX_SLOTS - 1);
+    for (int n = 0; n < WAV_INDEX_SLOTS; n++) {
+        if (s_slots[i].name[0] == '\0') {
+            if (s_count >= WAV_INDEX_MAX_FILES) return false;
+            s_slots[i] = *info;
+            s_count++;
+            return true;
+        }
+        if (strcasecmp(s_slots[i].name, info->name) == 0) {
+            s_slots[i] = *info;
+            return true;
+        }
+        i = (i + 1) & (WAV_INDEX_SLOTS - 1);
+    }
+    return false;
+}
+
+/* Slotu bosaltir ve arkasindaki zinciri geri kaydirir (tombstone kullanmadan). Kilit altinda cagrilmali. */
+static void remove_slot_locked(int slot)
+{
+    uint32_t hole = (uint32_t)slot;
+    uint32_t i = hole;
+    s_slots[hole].name[0] = '\0';
+    s_count--;
+
+    while (1) {
+        i = (i + 1) & (WAV_INDEX_SLOTS - 1);
+        if (s_slots[i].name[0] == '\0') return;
+        uint32_t home = name_hash(s_slots[i].name) & (WAV_INDEX_SLOTS - 1);
+        // Kaydin ana slotu (hole, i] araliginda degilse bosluga tasinabilir
+        bool in_range = (hole <= i) ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!in_range) {
+            s_slots[hole] = s_slots[i];
+            s_slots[i].name[0] = '\0';
+            hole = i;
+        }
+    }
+}
+
+
+
+/**
+ * @brief Parses the RIFF header of a WAV file.
+ *
+ * Walks the chunk list until both the "fmt " and "data" chunks have been found. Odd sized chunks are
+ * padded as required by RIFF. A data length that runs past the end of the file (e.g. a header written
+ * before the size was known) is clamped to the real file size.
+ *
+ * @param[in]  file_path Full path to the WAV file.
+ * @param[out] info      Structure receiving the parsed metadata (name is set to the base name).
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the file cannot be opened,
+ *         ESP_ERR_INVALID_RESPONSE if the file is not a valid WAV file.
+ */
+esp_err_t WavIndex_ParseFile(const char *file_path, WavInfo_t *info)
+{
+    if (file_path == NULL || info == NULL) return ESP_ERR_INVALID_ARG;
+
+    FILE *f = fopen(file_path, "rb");
+    if (f == NULL) return ESP_ERR_NOT_FOUND;
+
+    memset(info, 0, sizeof(*info));
+    snprintf(info->name, sizeof(info->name), "%s", base_name(file_path));
+
+    uint8_t hdr[16];
+    uint32_t byte_rate = 0;
+    bool have_fmt = false, have_data = false;
+
+    if (fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(&hdr[8], "WAVE", 4) != 0) {
+        fclose(f);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    long pos = 12;
+    while (!(have_fmt && have_data) && fread(hdr, 1, 8, f) == 8) {
+        uint32_t chunk_size = (uint32_t)hdr[4] | (uint32_t)hdr[5] << 8 | (uint32_t)hdr[6] << 16 | (uint32_t)hdr[7] << 24;
+        pos += 8;
+
+        if (memcmp(hdr, "fmt ", 4) == 0 && chunk_size >= 16) {
+            if (fread(hdr, 1, 16, f) != 16) break;
+            info->audio_format    = (uint16_t)(hdr[0] | hdr[1] << 8);
+            info->num_channels    = (uint16_t)(hdr[2] | hdr[3] << 8);
+            info->sample_rate     = (uint32_t)hdr[4] | (uint32_t)hdr[5] << 8 | (uint32_t)hdr[6] << 16 | (uint32_t)hdr[7] << 24;
+            byte_rate             = (uint32_t)hdr[8] | (uint32_t)hdr[9] << 8 | (uint32_t)hdr[10] << 16 | (uint32_t)hdr[11] << 24;
+            info->block_align     = (uint16_t)(hdr[12] | hdr[13] << 8);
+            info->bits_per_sample = (uint16_t)(hdr[14] | hdr[15] << 8);
+            have_fmt = true;
+        } else if (memcmp(hdr, "data", 4) == 0) {
+            info->data_offset = (uint32_t)pos;
+            info->data_length = chunk_size;
+            have_data = true;
+        }
+
+        pos += (long)chunk_size + (chunk_size & 1);  // RIFF: tek boyutlu chunk'lar 1 byte doldurulur
+        if (fseek(f, pos, SEEK_SET) != 0) break;
+    }
+
+    long file_size = 0;
+    if (fseek(f, 0, SEEK_END) == 0) file_size = ftell(f);
+    fclose(f);
+
+    if (!have_fmt || !have_data || byte_rate == 0) {
+        ESP_LOGW(TAG_WAVIDX, "Gecersiz WAV: %s", file_path);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (file_size > 0 && (uint64_t)info->data_offset + info->data_length > (uint64_t)file_size) {
+        info->data_length = (file_size > (long)info->data_offset) ? (uint32_t)(file_size - info->data_offset) : 0;
+    }
+
+    info->duration_ms = (uint32_t)(((uint64_t)info->data_length * 1000u) / byte_rate);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Scans the SD card root and rebuilds the index from scratch.
+ *
+ * Called once after the filesystem has been mounted. Creates the index mutex on first use.
+ *
+ * @return ESP_OK on success, ESP_FAIL if the directory cannot be opened.
+ */
+esp_err_t WavIndex_Build(void)
+{
+    if (s_indexMutex == NULL) {
+        s_indexMutex = xSemaphoreCreateMutex();
+    }
+
+    DIR *dir = opendir(MOUNT_POINT);
+    if (dir == NULL) {
+        ESP_LOGE(TAG_WAVIDX, "SD kart dizini acilamadi");
+        return ESP_FAIL;
+    }
+
+    index_lock();
+    memset(s_slots, 0, sizeof(s_slots));
+    s_count = 0;
+    index_unlock();
+
+    struct dirent *entry;
+    char path[WAV_INDEX_NAME_LEN + sizeof(MOUNT_POINT) + 1];
+    WavInfo_t info;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type == DT_DIR || !is_wav_name(entry->d_name)) continue;
+        if (strlen(entry->d_name) >= WAV_INDEX_NAME_LEN) {
+            ESP_LOGW(TAG_WAVIDX, "Dosya adi cok uzun, atlaniyor: %s", entry->d_name);
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", MOUNT_POINT, entry->d_name);
+        if (WavIndex_ParseFile(path, &info) != ESP_OK) continue;
+
+        index_lock();
+        bool ok = insert_locked(&info);
+        index_unlock();
+        if (!ok) {
+            ESP_LOGW(TAG_WAVIDX, "Indeks dolu (%d), atlaniyor: %s", WAV_INDEX_MAX_FILES, entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    ESP_LOGI(TAG_WAVIDX, "WAV indeksi hazir: %u dosya", (unsigned)s_count);
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Re-reads one file and inserts or refreshes its index entry.
+ *
+ * Used after an upload completes. Non-WAV files are ignored; a WAV file that no longer parses is
+ * removed from the index.
+ *
+ * @param[in] file_path Full path to the file.
+ * @return true if the file is indexed after the call, false otherwise.
+ */
+bool WavIndex_Update(const char *file_path)
+{
+    if (file_path == NULL || !is_wav_name(file_path)) return false;
+
+    WavInfo_t info;
+    if (WavIndex_ParseFile(file_path, &info) != ESP_OK) {
+        WavIndex_Remove(file_path);
+        return false;
+    }
+
+    index_lock();
+    bool ok = insert_locked(&info);
+    index_unlock();
+
+    if (ok) {
+        ESP_LOGI(TAG_WAVIDX, "Indeks guncellendi: %s (%lu ms)", info.name, (unsigned long)info.duration_ms);
+    } else {
+        ESP_LOGW(TAG_WAVIDX, "Indeks dolu, eklenemedi: %s", info.name);
+    }
+    return ok;
+}
+
+
+
+/**
+ * @brief Removes a file from the index, if present.
+ *
+ * @param[in] file_path Full path or base name of the file.
+ */
+void WavIndex_Remove(const char *file_path)
+{
+    if (file_path == NULL) return;
+    index_lock();
+    int slot = find_slot(base_name(file_path));
+    if (slot >= 0) remove_slot_locked(slot);
+    index_unlock();
+}
+
+
+
+/**
+ * @brief Copies the index entry of a file.
+ *
+ * @param[in]  file_path Full path or base name of the file.
+ * @param[out] info      Structure receiving the entry (may be NULL to test presence only).
+ * @return true if the file is indexed, false otherwise.
+ */
+bool WavIndex_Lookup(const char *file_path, WavInfo_t *info)
+{
+    if (file_path == NULL) return false;
+    index_lock();
+    int slot = find_slot(base_name(file_path));
+    if (slot >= 0 && info != NULL) *info = s_slots[slot];
+    index_unlock();
+    return slot >= 0;
+}
+
+
+
+/**
+ * @brief Returns the duration of an indexed WAV file without touching the SD card.
+ *
+ * @param[in] file_path Full path or base name of the file.
+ * @return Duration in milliseconds, 0 if the file is not indexed.
+ */
+uint32_t WavIndex_GetDurationMs(const char *file_path)
+{
+    uint32_t duration = 0;
+    if (file_path == NULL) return 0;
+    index_lock();
+    int slot = find_slot(base_name(file_path));
+    if (slot >= 0) duration = s_slots[slot].duration_ms;
+    index_unlock();
+    return duration;
+}
+
+
+
+/**
+ * @brief Returns the number of indexed files.
+ *
+ * @return Entry count.
+ */
+size_t WavIndex_Count(void)
+{
+    return s_count;
+}
@@ -0,0 +1,46 @@
+/*
+ * WavIndex.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_WAVINDEX_H_
+#define MAIN_WAVINDEX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Indekslenebilecek en fazla WAV dosyasi
+#ifndef WAV_INDEX_MAX_FILES
+#define WAV_INDEX_MAX_FILES     64
+#endif
+
+#define WAV_INDEX_SLOTS         (WAV_INDEX_MAX_FILES * 2)  // Hash tablosu, 2'nin kuvveti olmali
+#define WAV_INDEX_NAME_LEN      64
+
+#define WAV_FORMAT_PCM          0x0001
+
+typedef struct {
+    char     name[WAV_INDEX_NAME_LEN]; // Dosya adi (yol olmadan), bos ise slot kullanilmiyor
+    uint32_t duration_ms;     // data_length'ten hesaplanan sure
+    uint32_t sample_rate;
+    uint16_t bits_per_sample;
+    uint16_t num_channels;
+    uint16_t audio_format;    // fmt chunk format etiketi (1 = PCM)
+    uint16_t block_align;
+    uint32_t data_offset;     // "data" chunk verisinin dosyadaki baslangici
+    uint32_t data_length;     // "data" chunk boyutu (byte)
+} WavInfo_t;
+
+esp_err_t WavIndex_Build(void);
+esp_err_t WavIndex_ParseFile(const char *file_path, WavInfo_t *info);
+bool WavIndex_Update(const char *file_path);
+void WavIndex_Remove(const char *file_path);
+bool WavIndex_Lookup(const char *file_path, WavInfo_t *info);
+uint32_t WavIndex_GetDurationMs(const char *file_path);
+size_t WavIndex_Count(void);
+
+#endif /* MAIN_WAVINDEX_H_ */
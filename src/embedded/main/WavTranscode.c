@@ -0,0 +1,370 @@
+/*
+ * WavTranscode.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Converts an uploaded WAV file to the native PCM layout while it is being received.
+ *
+ * The web upload hands the file over in arbitrary chunks. A small state machine walks the RIFF chunks
+ * as they arrive (the fmt chunk may come after LIST/INFO chunks and pieces may split any header), then
+ * streams the "data" chunk through AudioConvert into a 2 KB output buffer that is flushed to SD. A
+ * placeholder header is written first and replaced by a canonical 44-byte PCM header when the upload
+ * ends, so every stored clip is 16-bit mono at AUDIO_NATIVE_SAMPLE_RATE and playback never converts.
+ * IMA-ADPCM uploads are the exception: their blocks are stored as they are, behind a canonical 48-byte
+ * ADPCM header, so they keep a quarter of the size and are decoded during playback.
+ * The whole file is never held in RAM.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "WavTranscode.h"
+#include "WavIndex.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <string.h>
+
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
+#define WAV_CANONICAL_HDR_SIZE  44
+#define WAV_ADPCM_HDR_SIZE      48  // fmt govdesi 20 byte (cbSize + samplesPerBlock)
+
+static const char *TAG_TC = "WAV_TRANSCODE";
+
+
+
+static uint32_t rd_le32(const uint8_t *p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t rd_le16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static void wr_le32(uint8_t *p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24); }
+static void wr_le16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+
+static esp_err_t fail(WavTranscode_t *tc, const char *why)
+{
+    tc->state = WAV_TC_ERROR;
+    tc->error = why;
+    ESP_LOGW(TAG_TC, "Upload reddedildi: %s", why);
+    return ESP_FAIL;
+}
+
+/* Siradaki 8 byte'lik chunk basligini beklemeye gecer */
+static void expect_chunk_hdr(WavTranscode_t *tc)
+{
+    tc->state = WAV_TC_CHUNK_HDR;
+    tc->hdr_len = 0;
+    tc->need = 8;
+}
+
+/* Cikis tamponunu SD'ye yazar */
+static esp_err_t flush_out(WavTranscode_t *tc)
+{
+    if (tc->out_len == 0) return ESP_OK;
+    if (fwrite(tc->out, 1, tc->out_len, tc->fp) != tc->out_len) {
+        return fail(tc, "SD yazma hatasi");
+    }
+    tc->out_pcm_bytes += tc->out_len;
+    tc->out_len = 0;
+    return ESP_OK;
+}
+
+/* Butun frame'lerden olusan PCM'i donusturup cikis tamponuna ekler */
+static esp_err_t convert_frames(WavTranscode_t *tc, const uint8_t *p, size_t n)
+{
+    while (n > 0) {
+        size_t room = AudioConvert_InputBytesFor(&tc->conv, sizeof(tc->out) - tc->out_len);
+        if (room == 0) {
+            if (flush_out(tc) != ESP_OK) return ESP_FAIL;
+            continue;
+        }
+        size_t k = (n < room) ? n : room;
+        tc->out_len += AudioConvert_Process(&tc->conv, p, k, (int16_t *)((uint8_t *)tc->out + tc->out_len));
+        p += k;
+        n -= k;
+    }
+    return ESP_OK;
+}
+
+/* ADPCM bloklarini oldugu gibi cikis tamponuna ekler */
+static esp_err_t copy_raw(WavTranscode_t *tc, const uint8_t *p, size_t n)
+{
+    while (n > 0) {
+        size_t room = sizeof(tc->out) - tc->out_len;
+        if (room == 0) {
+            if (flush_out(tc) != ESP_OK) return ESP_FAIL;
+            continue;
+        }
+        size_t k = (n < room) ? n : room;
+        memcpy((uint8_t *)tc->out + tc->out_len, p, k);
+        tc->out_len += k;
+        p += k;
+        n -= k;
+    }
+    return ESP_OK;
+}
+
+/* data chunk'indan gelen parcayi isler, parcalar arasinda bolunen frame'i saklar */
+static esp_err_t consume_pcm(WavTranscode_t *tc, const uint8_t *p, size_t n)
+{
+    const size_t frame = tc->conv.in_frame_bytes;
+    tc->in_pcm_bytes += n;
+    if (tc->adpcm) return copy_raw(tc, p, n);
+
+    if (tc->carry_len > 0) {
+        size_t c = frame - tc->carry_len;
+        if (c > n) c = n;
+        memcpy(&tc->carry[tc->carry_len], p, c);
+        tc->carry_len += c;
+        p += c;
+        n -= c;
+        if (tc->carry_len < frame) return ESP_OK;
+        tc->carry_len = 0;
+        if (convert_frames(tc, tc->carry, frame) != ESP_OK) return ESP_FAIL;
+    }
+
+    size_t whole = n - (n % frame);
+    if (convert_frames(tc, p, whole) != ESP_OK) return ESP_FAIL;
+    memcpy(tc->carry, p + whole, n - whole);
+    tc->carry_len = (uint8_t)(n - whole);
+    return ESP_OK;
+}
+
+/* hdr'de tamamlanan baslik/govdeyi yorumlar ve bir sonraki duruma gecer */
+static esp_err_t handle_header(WavTranscode_t *tc)
+{
+    const uint8_t *h = tc->hdr;
+
+    switch (tc->state) {
+        case WAV_TC_RIFF:
+            if (memcmp(h, "RIFF", 4) != 0 || memcmp(&h[8], "WAVE", 4) != 0) {
+                return fail(tc, "WAV dosyasi degil");
+            }
+            expect_chunk_hdr(tc);
+            return ESP_OK;
+
+        case WAV_TC_CHUNK_HDR: {
+            uint32_t size = rd_le32(&h[4]);
+            if (memcmp(h, "fmt ", 4) == 0) {
+                if (size < 16) return fail(tc, "Gecersiz fmt chunk");
+                tc->need = (size < WAV_TRANSCODE_FMT_MAX) ? size : WAV_TRANSCODE_FMT_MAX;
+                tc->skip = size - tc->need + (size & 1);
+                tc->hdr_len = 0;
+                tc->state = WAV_TC_FMT;
+            } else if (memcmp(h, "data", 4) == 0) {
+                if (!tc->have_fmt) return fail(tc, "data chunk fmt'den once geldi");
+                if (tc->adpcm) {
+                    tc->data_left = size ? size : UINT32_MAX;
+                    tc->state = WAV_TC_DATA;
+                    ESP_LOGI(TAG_TC, "Kaynak: IMA-ADPCM %" PRIu32 " Hz, %u kanal, blok %u -> sikistirilmis saklaniyor",
+                             tc->in_rate, tc->in_channels, tc->in_block_align);
+                    return ESP_OK;
+                }
+                if (!AudioConvert_Init(&tc->conv, tc->in_rate, tc->in_bits, tc->in_channels)) {
+                    return fail(tc, "Desteklenmeyen ornekleme hizi/bit/kanal");
+                }
+                tc->data_left = size ? size : UINT32_MAX;  // 0: akis halinde yazilmis, dosya sonuna kadar
+                tc->state = WAV_TC_DATA;
+                ESP_LOGI(TAG_TC, "Kaynak: %" PRIu32 " Hz, %u bit, %u kanal -> %d Hz %d bit mono%s",
+                         tc->in_rate, tc->in_bits, tc->in_channels, AUDIO_NATIVE_SAMPLE_RATE, AUDIO_NATIVE_BITS,
+                         tc->conv.passthrough ? " (donusum yok)" : "");
+            } else {
+                tc->skip = size + (size & 1);  // Chunk'lar cift byte'a hizali
+                tc->state = WAV_TC_SKIP;
+                if (tc->skip == 0) expect_chunk_hdr(tc);
+            }
+            return ESP_OK;
+        }
+
+        case WAV_TC_FMT: {
+            uint16_t format = rd_le16(&h[0]);
+            if (format == WAV_FORMAT_EXTENSIBLE && tc->need >= 26) {
+                format = rd_le16(&h[24]);  // SubFormat GUID'in ilk iki byte'i
+            }
+            if (format != WAV_FORMAT_PCM && format != WAV_FORMAT_IMA_ADPCM) {
+                return fail(tc, "Sadece PCM ve IMA-ADPCM WAV destekleniyor");
+            }
+            tc->in_channels = rd_le16(&h[2]);
+            tc->in_rate = rd_le32(&h[4]);
+            tc->in_block_align = rd_le16(&h[12]);
+            tc->in_bits = rd_le16(&h[14]);
+            tc->have_fmt = true;
+            if (format == WAV_FORMAT_IMA_ADPCM && !tc->adpcm) {
+                ImaAdpcm_t probe;
+                if (tc->in_rate == 0 || tc->in_bits != 4 || !ImaAdpcm_Init(&probe, tc->in_channels, tc->in_block_align)) {
+                    return fail(tc, "Desteklenmeyen ADPCM bicimi");
+                }
+                // Baslik 4 byte uzun: yer tutucuyu veri yazilmadan once genislet
+                static const uint8_t pad[WAV_ADPCM_HDR_SIZE - WAV_CANONICAL_HDR_SIZE] = {0};
+                if (fwrite(pad, 1, sizeof(pad), tc->fp) != sizeof(pad)) return fail(tc, "SD yazma hatasi");
+                tc->adpcm = true;
+                tc->out_hdr_bytes = WAV_ADPCM_HDR_SIZE;
+            }
+            if (tc->skip > 0) {
+                tc->state = WAV_TC_SKIP;
+            } else {
+                expect_chunk_hdr(tc);
+            }
+            return ESP_OK;
+        }
+
+        default:
+            return ESP_OK;
+    }
+}
+
+
+
+/**
+ * @brief Starts transcoding an upload into an already opened file.
+ *
+ * Writes a placeholder for the canonical header; it is overwritten by WavTranscode_End().
+ *
+ * @param[out] tc Transcoder state to initialise.
+ * @param[in]  fp Destination file opened for writing.
+ * @return ESP_OK on success, ESP_FAIL if the placeholder cannot be written.
+ */
+esp_err_t WavTranscode_Begin(WavTranscode_t *tc, FILE *fp)
+{
+    static const uint8_t zero[WAV_CANONICAL_HDR_SIZE] = {0};
+
+    memset(tc, 0, sizeof(*tc));
+    tc->fp = fp;
+    tc->state = WAV_TC_RIFF;
+    tc->need = 12;
+    tc->out_hdr_bytes = WAV_CANONICAL_HDR_SIZE;
+    if (fwrite(zero, 1, sizeof(zero), fp) != sizeof(zero)) {
+        return fail(tc, "SD yazma hatasi");
+    }
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief Feeds the next piece of the uploaded file.
+ *
+ * Pieces may have any size and split any header or sample frame. Bytes after the data chunk are ignored.
+ *
+ * @param[in,out] tc  Transcoder state.
+ * @param[in]     buf Received bytes.
+ * @param[in]     len Number of bytes.
+ * @return ESP_OK on success, ESP_FAIL if the file is rejected (see tc->error).
+ */
+esp_err_t WavTranscode_Write(WavTranscode_t *tc, const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        size_t n;
+        switch (tc->state) {
+            case WAV_TC_RIFF:
+            case WAV_TC_CHUNK_HDR:
+            case WAV_TC_FMT:
+                n = tc->need - tc->hdr_len;
+                if (n > len) n = len;
+                memcpy(&tc->hdr[tc->hdr_len], buf, n);
+                tc->hdr_len += n;
+                if (tc->hdr_len == tc->need && handle_header(tc) != ESP_OK) return ESP_FAIL;
+                break;
+
+            case WAV_TC_SKIP:
+                n = (tc->skip < len) ? tc->skip : len;
+                tc->skip -= n;
+                if (tc->skip == 0) expect_chunk_hdr(tc);
+                break;
+
+            case WAV_TC_DATA:
+                n = (tc->data_left < len) ? tc->data_left : len;
+                if (consume_pcm(tc, buf, n) != ESP_OK) return ESP_FAIL;
+                if (tc->data_left != UINT32_MAX) {
+                    tc->data_left -= n;
+                    if (tc->data_left == 0) tc->state = WAV_TC_DONE;
+                }
+                break;
+
+            case WAV_TC_DONE:
+                return ESP_OK;
+
+            default:
+                return ESP_FAIL;
+        }
+        buf += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+
+
+/* Sikistirilmis veri icin 48 byte IMA-ADPCM basligi */
+static size_t build_adpcm_header(const WavTranscode_t *tc, uint8_t *h)
+{
+    ImaAdpcm_t dec;
+    ImaAdpcm_Init(&dec, tc->in_channels, tc->in_block_align);
+    uint32_t data_len = tc->out_pcm_bytes;
+    uint32_t byte_rate = (uint32_t)(((uint64_t)tc->in_rate * tc->in_block_align) / dec.samples_per_block);
+
+    memcpy(&h[0], "RIFF", 4);
+    wr_le32(&h[4], WAV_ADPCM_HDR_SIZE - 8 + data_len);
+    memcpy(&h[8], "WAVE", 4);
+    memcpy(&h[12], "fmt ", 4);
+    wr_le32(&h[16], 20);
+    wr_le16(&h[20], WAV_FORMAT_IMA_ADPCM);
+    wr_le16(&h[22], tc->in_channels);
+    wr_le32(&h[24], tc->in_rate);
+    wr_le32(&h[28], byte_rate);
+    wr_le16(&h[32], tc->in_block_align);
+    wr_le16(&h[34], 4);
+    wr_le16(&h[36], 2);  // cbSize
+    wr_le16(&h[38], dec.samples_per_block);
+    memcpy(&h[40], "data", 4);
+    wr_le32(&h[44], data_len);
+    return WAV_ADPCM_HDR_SIZE;
+}
+
+/* Yerel PCM icin kanonik 44 byte baslik */
+static size_t build_pcm_header(const WavTranscode_t *tc, uint8_t *h)
+{
+    uint32_t data_len = tc->out_pcm_bytes;
+    memcpy(&h[0], "RIFF", 4);
+    wr_le32(&h[4], 36 + data_len);
+    memcpy(&h[8], "WAVE", 4);
+    memcpy(&h[12], "fmt ", 4);
+    wr_le32(&h[16], 16);
+    wr_le16(&h[20], WAV_FORMAT_PCM);
+    wr_le16(&h[22], AUDIO_NATIVE_CHANNELS);
+    wr_le32(&h[24], AUDIO_NATIVE_SAMPLE_RATE);
+    wr_le32(&h[28], AUDIO_NATIVE_SAMPLE_RATE * AUDIO_NATIVE_FRAME_BYTES);
+    wr_le16(&h[32], AUDIO_NATIVE_FRAME_BYTES);
+    wr_le16(&h[34], AUDIO_NATIVE_BITS);
+    memcpy(&h[36], "data", 4);
+    wr_le32(&h[40], data_len);
+    return WAV_CANONICAL_HDR_SIZE;
+}
+
+
+
+/**
+ * @brief Flushes the remaining data and writes the canonical header.
+ *
+ * PCM uploads get a 44-byte 16-bit mono header, IMA-ADPCM uploads a 48-byte ADPCM header.
+ *
+ * @param[in,out] tc Transcoder state.
+ * @return ESP_OK on success, ESP_FAIL if no audio was found or the header cannot be written.
+ */
+esp_err_t WavTranscode_End(WavTranscode_t *tc)
+{
+    if (tc->state == WAV_TC_ERROR) return ESP_FAIL;
+    if (tc->state != WAV_TC_DATA && tc->state != WAV_TC_DONE) {
+        return fail(tc, "data chunk bulunamadi");
+    }
+    if (flush_out(tc) != ESP_OK) return ESP_FAIL;
+
+    uint8_t h[WAV_ADPCM_HDR_SIZE];
+    size_t hdr_len = tc->adpcm ? build_adpcm_header(tc, h) : build_pcm_header(tc, h);
+
+    if (fseek(tc->fp, 0, SEEK_SET) != 0 || fwrite(h, 1, hdr_len, tc->fp) != hdr_len) {
+        return fail(tc, "WAV basligi yazilamadi");
+    }
+    ESP_LOGI(TAG_TC, "Donusum bitti: %" PRIu32 " -> %" PRIu32 " byte %s", tc->in_pcm_bytes, tc->out_pcm_bytes,
+             tc->adpcm ? "ADPCM" : "PCM");
+    return ESP_OK;
+}
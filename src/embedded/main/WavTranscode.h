@@ -0,0 +1,65 @@
+/*
+ * WavTranscode.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef MAIN_WAVTRANSCODE_H_
+#define MAIN_WAVTRANSCODE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "AudioConvert.h"
+#include "ImaAdpcm.h"
+
+// Donusturulmus PCM'in SD'ye yazilmadan once biriktirildigi tampon
+#ifndef WAV_TRANSCODE_OUT_BUF_SIZE
+#define WAV_TRANSCODE_OUT_BUF_SIZE  2048
+#endif
+
+#define WAV_TRANSCODE_FMT_MAX       40  // Okunan en uzun fmt govdesi (WAVE_FORMAT_EXTENSIBLE)
+
+typedef enum {
+    WAV_TC_RIFF = 0,    // "RIFF....WAVE" bekleniyor
+    WAV_TC_CHUNK_HDR,   // 8 byte chunk basligi okunuyor
+    WAV_TC_FMT,         // fmt govdesi okunuyor
+    WAV_TC_SKIP,        // Bilinmeyen chunk atlaniyor
+    WAV_TC_DATA,        // PCM donusturuluyor
+    WAV_TC_DONE,        // data chunk bitti, kalan byte'lar yok sayilir
+    WAV_TC_ERROR,
+} WavTranscodeState_t;
+
+typedef struct {
+    FILE               *fp;
+    WavTranscodeState_t state;
+    uint8_t             hdr[WAV_TRANSCODE_FMT_MAX];  // RIFF/chunk basligi ve fmt govdesi
+    uint32_t            hdr_len;     // hdr'de biriken byte
+    uint32_t            need;        // Bu durumda okunacak byte
+    uint32_t            skip;        // Atlanacak byte (chunk govdesi + pad)
+    uint32_t            data_left;   // data chunk'inda kalan byte
+    bool                have_fmt;
+    uint32_t            in_rate;
+    uint16_t            in_bits;
+    uint16_t            in_channels;
+    uint16_t            in_block_align;
+    bool                adpcm;       // IMA-ADPCM: donusturulmeden sikistirilmis saklanir
+    AudioConvert_t      conv;
+    uint8_t             carry[8];    // Iki parca arasinda bolunmus frame
+    uint8_t             carry_len;
+    int16_t             out[WAV_TRANSCODE_OUT_BUF_SIZE / 2];
+    size_t              out_len;     // out'ta biriken byte
+    uint32_t            in_pcm_bytes;  // Okunan kaynak PCM
+    uint32_t            out_pcm_bytes; // Yazilan yerel PCM (ADPCM ise sikistirilmis veri)
+    uint16_t            out_hdr_bytes; // Yazilan baslik (PCM 44, ADPCM 48)
+    const char         *error;
+} WavTranscode_t;
+
+esp_err_t WavTranscode_Begin(WavTranscode_t *tc, FILE *fp);
+esp_err_t WavTranscode_Write(WavTranscode_t *tc, const uint8_t *buf, size_t len);
+esp_err_t WavTranscode_End(WavTranscode_t *tc);
+
+#endif /* MAIN_WAVTRANSCODE_H_ */
@@ -27,6 +27,8 @@
 #include "mongoose_glue.h"
 #include "sdkconfig.h"
 #include "DetectTraffic.h"
+#include "CycleModel.h"
+#include "LampPcnt.h"
 #include "wifi.h"
 #include "FlashConfig.h"
 #include "SystemTime.h"
@@ -34,6 +36,11 @@
 #include "SpeakerDriver.h"
 #include "SystemTime.h"
 #include "Plan.h"
+#include "AudioPipeline.h"
+#include "ClipCache.h"
+#include "PlayQueue.h"
+#include "TraceLog.h"
+#include "NoiseHistory.h"
 #include "esp_task_wdt.h"
 
 uint8_t eth_port_cnt = 0;
@@ -50,12 +57,20 @@ void app_main(void) {
 	
     FlashInit();
     loadConfigurationsFromFlash();
+    CycleModel_Init();
 	init_sd_card();
+	TraceLog_Init();
+	AudioPipeline_Init();
+	ClipCache_Init();
+	PlayQueue_Init();
     GPIO_Init();
-    ADC_Read_Init();
+    MicADC_Init();
     ResetAllTrafficVariables();
+    GPIO_EdgeCaptureInit();
+    LampPcnt_Init();
 	i2c_master_init();  //RTC module
 	mcp7940n_get_time(&DeviceTime); 
+	NoiseHistory_Init();  // RTC epoch ve SD karti gerekir
 	
 	eth_reset_pin_init();
 	
@@ -45,14 +45,21 @@
 #include "esp_task_wdt.h"
 #include "esp_task_wdt.h"
 #include "MichADCRead.h"
+#include "WavIndex.h"
+#include "ClipCache.h"
+#include "WavTranscode.h"
+#include "TraceLog.h"
+#include "TraceReplay.h"
+#include "Loudness.h"
+#include "NoiseHistory.h"
+#include "esp_timer.h"
+#include <strings.h>
 #include "esp_task_wdt.h"
 
 
 static uint64_t s_action_timeout_reboot;  // Time when reboot ends
 extern uint32_t g_adcAverage;
 bool TestMode = false;
-#define NOISE_LEVEL_HISTORY_SIZE 15 // Re-define or include common header
-extern int noise_level_history[NOISE_LEVEL_HISTORY_SIZE];
 bool DefConfigFlashWrite = false;
 bool Alt1ConfigFlashWrite = false;
 bool Alt2ConfigFlashWrite = false;
@@ -72,7 +79,6 @@ bool NetworkSettingsPageRequest = false;
 bool isDeleteFile = false;
 
 extern volatile float volume_factor;
-extern bool StopPlayWav;
 
 char admin_name[30] = "admin"; // Admin name and password is stucked in here.
 char admin_password[30] = "!ntetrAPB_5";
@@ -106,6 +112,22 @@ struct deleteFile s_deleteFile = {""};
 struct systemInfo s_systemInfo = {"MyDevice", "MyComment", APPLICATON_VERSION};
 struct wifiSettings s_wifiSettings = {"ESP32_AP_"};
 struct audioConfig s_audioConfig;
+static char s_upload_path[128];  // Acik upload dosyasinin yolu, kapatilinca indekslenir
+
+// Tek seferde bir upload: .wav dosyalari alinirken yerel bicime donusturulur
+typedef struct {
+  FILE *fp;
+  bool transcode;       // WavTranscode uzerinden yaziliyor
+  bool failed;          // Reddedildi veya yazma hatasi, kapatilinca dosya silinir
+  bool ok;              // Son upload basariyla kapatildi
+  size_t expected;      // HTTP govde boyutu
+  size_t received;
+  uint8_t last_pct;     // Son loglanan ilerleme (%10 adim)
+  int64_t start_us;
+  uint32_t elapsed_ms;
+  WavTranscode_t tc;
+} UploadContext_t;
+static UploadContext_t s_upload;
 
 
 
@@ -196,23 +218,41 @@ void glue_start_reformat(struct mg_str params) {
  * @brief Opens a file for upload on the SD card filesystem.
  *
  * This function constructs the full path for the given file name (placing it under "/sdcard/"),
- * and opens it in binary write mode. It supports POSIX file systems. The function logs the operation
- * and returns a file pointer to be used for subsequent file operations.
+ * and opens it in binary write mode. It supports POSIX file systems. WAV files are transcoded to the
+ * native PCM layout while they are received (see WavTranscode), other files are stored as sent.
+ * The returned context is passed to the write and close callbacks. Files the device writes itself
+ * (is_device_file: trace and noise history) are refused, a synthetic trace must be uploaded under another name.
  *
  * @param[in] file_name Name of the file to be uploaded (can include path).
- * @param[in] total_size Total size of the file to be uploaded (for logging purposes).
- * @return void* File pointer (FILE*) if successful, NULL otherwise.
+ * @param[in] total_size Total size of the file to be uploaded (used for progress reporting).
+ * @return void* Upload context if successful, NULL otherwise.
  */
 void *glue_upload_open_file_upload(char *file_name, size_t total_size) {
-  char path[128], *p = NULL;
+  char *path = s_upload_path, *p = NULL;
   FILE *fp = NULL;
   if ((p = strrchr(file_name, '/')) == NULL) p = file_name;
-  mg_snprintf(path, sizeof(path), "/sdcard/%s", p);
+  if (is_device_file(*p == '/' ? p + 1 : p)) {
+    // Iz ve gurultu gecmisi dosyalari yazici gorevler acikken kesilirse FAT bozulur
+    MG_ERROR(("upload to device file [%s] refused", p));
+    return NULL;
+  }
+  mg_snprintf(path, sizeof(s_upload_path), "/sdcard/%s", p);
 #if MG_ENABLE_POSIX_FS
   fp = fopen(path, "w+b");
 #endif
   MG_DEBUG(("opening [%s] size %lu, fp %p", path, total_size, fp));
-  return fp;
+  memset(&s_upload, 0, sizeof(s_upload));  // Rapor eski upload'i gostermesin
+  if (fp == NULL) return NULL;
+
+  size_t n = strlen(path);
+  s_upload.fp = fp;
+  s_upload.expected = total_size;
+  s_upload.start_us = esp_timer_get_time();
+  s_upload.transcode = (n > 4 && strcasecmp(&path[n - 4], ".wav") == 0);
+  if (s_upload.transcode && WavTranscode_Begin(&s_upload.tc, fp) != ESP_OK) {
+    s_upload.failed = true;
+  }
+  return &s_upload;
 }
 
 
@@ -220,16 +260,32 @@ void *glue_upload_open_file_upload(char *file_name, size_t total_size) {
 /**
  * @brief Closes a file previously opened for upload.
  *
- * This function closes the given file pointer if using POSIX file system.
- * Logs the file pointer for debugging.
+ * Finalises the transcoded WAV header, closes the file and records the elapsed time.
+ * Once the file is closed, its WAV index entry is refreshed so that duration lookups never have to
+ * read the new file again. A rejected or incomplete upload is deleted instead of being kept half written.
  *
- * @param[in] fp File pointer to close.
- * @return bool True if the file was closed successfully, false otherwise.
+ * @param[in] fp Upload context returned by glue_upload_open_file_upload().
+ * @return bool True if the file was stored successfully, false otherwise.
  */
 bool glue_upload_close_file_upload(void *fp) {
+  UploadContext_t *up = (UploadContext_t *) fp;
   MG_DEBUG(("closing %p", fp));
 #if MG_ENABLE_POSIX_FS
-  return fclose((FILE *) fp) == 0;
+  if (up->fp == NULL) return up->ok;  // Zaten kapatildi
+  if (up->transcode && !up->failed && WavTranscode_End(&up->tc) != ESP_OK) up->failed = true;
+  if (up->received < up->expected) up->failed = true;  // Baglanti yarida koptu
+  bool ok = fclose(up->fp) == 0 && !up->failed;
+  up->fp = NULL;
+  up->elapsed_ms = (uint32_t) ((esp_timer_get_time() - up->start_us) / 1000);
+  ClipCache_Invalidate(s_upload_path);  // Ayni isimli eski icerik RAM'de kalmasin
+  if (ok) {
+    WavIndex_Update(s_upload_path);
+  } else {
+    remove(s_upload_path);
+    WavIndex_Remove(s_upload_path);
+  }
+  up->ok = ok;
+  return ok;
 #else
   return false;
 #endif
@@ -240,18 +296,31 @@ bool glue_upload_close_file_upload(void *fp) {
 /**
  * @brief Writes a buffer to a file during upload.
  *
- * Writes the specified number of bytes from the buffer to the file pointer, if using POSIX file system.
- * Logs the operation for debugging.
+ * Writes the specified number of bytes from the buffer to the file, through the transcoder for WAV files.
+ * Progress is logged in 10% steps.
  *
- * @param[in] fp   File pointer to write to.
+ * @param[in] fp   Upload context returned by glue_upload_open_file_upload().
  * @param[in] buf  Pointer to data buffer to write.
  * @param[in] len  Number of bytes to write from buffer.
- * @return bool True if all bytes are written successfully, false otherwise.
+ * @return bool True if the data was accepted, false if the file is rejected or cannot be written.
  */
 bool glue_upload_write_file_upload(void *fp, void *buf, size_t len) {
+  UploadContext_t *up = (UploadContext_t *) fp;
   MG_DEBUG(("writing fp %p %p %lu bytes", fp, buf, len));
 #if MG_ENABLE_POSIX_FS
-  return fwrite(buf, 1, len, (FILE *) fp) == len;
+  if (up->failed) return false;
+  if (up->transcode) {
+    up->failed = WavTranscode_Write(&up->tc, (const uint8_t *) buf, len) != ESP_OK;
+  } else {
+    up->failed = fwrite(buf, 1, len, up->fp) != len;
+  }
+  up->received += len;
+  uint8_t pct = up->expected ? (uint8_t) ((uint64_t) up->received * 100 / up->expected) : 100;
+  if (pct / 10 != up->last_pct / 10) {
+    MG_INFO(("upload %s: %%%u (%lu/%lu)", s_upload_path, pct, up->received, up->expected));
+    up->last_pct = pct;
+  }
+  return !up->failed;
 #else
   return false;
 #endif
@@ -259,6 +328,49 @@ bool glue_upload_write_file_upload(void *fp, void *buf, size_t len) {
 
 
 
+/**
+ * @brief Replies with the result of the last upload as JSON (/api/uploadReport).
+ *
+ * The generated upload handler only answers with the byte count, before the file is closed. The UI reads
+ * this endpoint once the upload request has returned: it reports the received and stored sizes, the
+ * source format, whether the file was converted, the elapsed time and the throughput, or the reason the
+ * file was rejected. Replies {"running":true} while an upload is still open and 404 before the first one.
+ *
+ * @param[in] c  Pointer to the HTTP connection.
+ * @param[in] hm Pointer to the HTTP message (unused).
+ */
+void glue_reply_uploadReport(struct mg_connection *c, struct mg_http_message *hm) {
+  const char *headers = "Cache-Control: no-cache\r\n" "Content-Type: application/json\r\n";
+  const UploadContext_t *up = &s_upload;
+  (void) hm;
+  if (s_upload_path[0] == '\0') {
+    mg_http_reply(c, 404, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("no upload"));
+    return;
+  }
+  if (up->fp != NULL) {
+    mg_http_reply(c, 200, headers, "{%m:true}\n", MG_ESC("running"));
+    return;
+  }
+  uint32_t kbps = up->elapsed_ms ? (uint32_t) ((uint64_t) up->received * 1000 / up->elapsed_ms / 1024) : 0;
+  const char *err = up->ok ? "" : (up->tc.error ? up->tc.error : "Upload error");
+  mg_http_reply(c, 200, headers,
+                "{%m:%s,%m:%m,%m:%lu,%m:%lu,%m:%lu,%m:%s,%m:%lu,%m:%u,%m:%u,%m:%lu,%m:%lu,%m:%m}\n",
+                MG_ESC("ok"), up->ok ? "true" : "false",
+                MG_ESC("file"), MG_ESC(s_upload_path),
+                MG_ESC("expected"), (unsigned long) up->expected,
+                MG_ESC("received"), (unsigned long) up->received,
+                MG_ESC("stored"), (unsigned long) (up->transcode ? up->tc.out_pcm_bytes + up->tc.out_hdr_bytes : up->received),
+                MG_ESC("converted"), (up->transcode && !up->tc.adpcm && !up->tc.conv.passthrough) ? "true" : "false",
+                MG_ESC("srcRate"), (unsigned long) up->tc.in_rate,
+                MG_ESC("srcBits"), (unsigned) up->tc.in_bits,
+                MG_ESC("srcChannels"), (unsigned) up->tc.in_channels,
+                MG_ESC("ms"), (unsigned long) up->elapsed_ms,
+                MG_ESC("kBps"), (unsigned long) kbps,
+                MG_ESC("error"), MG_ESC(err));
+}
+
+
+
 /**
  * @brief Retrieves the current deleteFile structure.
  *
@@ -434,6 +546,142 @@ void glue_reply_download(struct mg_connection *c, struct mg_http_message *hm) {
 
 
 
+/* Iz dosyasini acar; acik kaldigi surece TraceLog yazmaz ve dondurmez */
+static void *trace_fs_open(const char *path, int flags) {
+  void *fd = mg_fs_posix.op(path, flags);
+  if (fd != NULL) TraceLog_ExportBegin();
+  return fd;
+}
+
+/* Gonderim bitince ya da baglanti kapaninca mongoose cagirir */
+static void trace_fs_close(void *fd) {
+  mg_fs_posix.cl(fd);
+  TraceLog_ExportEnd();
+}
+
+
+
+/**
+ * @brief Streams the binary signal trace from the SD card.
+ *
+ * Serves TRACE_FILE_PATH, or TRACE_FILE_PREV_PATH when the query has part=prev, as an attachment of
+ * 12-byte TraceRecord_t entries. mg_http_serve_file() sends the file in chunks as the connection drains,
+ * so the trace is never loaded into RAM. The ring is flushed on each request; records from the last
+ * TRACE_FLUSH_MS may arrive with the next download. The file is opened through a POSIX filesystem wrapper
+ * that holds TraceLog off (TraceLog_ExportBegin/End) from open to close, so the writer neither appends to
+ * nor rotates the file while it is streamed.
+ *
+ * @param[in] c  Pointer to the HTTP connection.
+ * @param[in] hm Pointer to the HTTP message containing the query string.
+ */
+void glue_reply_trace(struct mg_connection *c, struct mg_http_message *hm) {
+  char part[8];
+  const char *path = TRACE_FILE_PATH;
+  const char *name = "trace.bin";
+
+  TraceLog_Flush();
+  if (mg_http_get_var(&hm->query, "part", part, sizeof(part)) > 0 && strcmp(part, "prev") == 0) {
+    path = TRACE_FILE_PREV_PATH;
+    name = "trace1.bin";
+  }
+
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    mg_http_reply(c, 404, "Content-Type: text/plain\r\n", "Trace not found\n");
+    return;
+  }
+
+  char header[128];
+  mg_snprintf(header, sizeof(header), "Content-Disposition: attachment; filename=\"%s\"\r\n", name);
+  static struct mg_fs s_trace_fs;
+  s_trace_fs = mg_fs_posix;
+  s_trace_fs.op = trace_fs_open;
+  s_trace_fs.cl = trace_fs_close;
+  struct mg_http_serve_opts opts = { .extra_headers = header, .mime_types = "bin=application/octet-stream",
+                                     .fs = &s_trace_fs };
+  mg_http_serve_file(c, hm, path, &opts);
+}
+
+
+
+
+/**
+ * @brief Starts a trace replay through the countdown logic, or reports the result of the last one.
+ *
+ * Query parameters: file (name on the SD card, default trace.bin), from and to (countdown range, default
+ * the active configuration). The replay runs in TraceReplay_Task, so the request answers 202 at once and
+ * the web server keeps serving while the file is read. With result=1 the request returns
+ * {"running":true} while the replay runs and the announcement comparison once it is done. Files larger
+ * than TRACE_REPLAY_MAX_BYTES are refused with 413, a second start while one runs with 409.
+ *
+ * @param[in] c  Pointer to the HTTP connection.
+ * @param[in] hm Pointer to the HTTP message containing the query string.
+ */
+void glue_reply_replay(struct mg_connection *c, struct mg_http_message *hm) {
+  const char *headers = "Cache-Control: no-cache\r\n"
+                        "Content-Type: application/json\r\n";
+  char file_name[32] = "trace.bin", num[8], path[64];
+  uint32_t from = ui8_greenCountFrom, to = ui8_greenCountTo;
+
+  if (mg_http_get_var(&hm->query, "result", num, sizeof(num)) >= 0) {
+    TraceReplayResult_t r;
+    esp_err_t err = ESP_OK;
+    TraceReplayState_t state = TraceReplay_GetResult(&r, &err);
+    if (state == TRACE_REPLAY_IDLE) {
+      mg_http_reply(c, 404, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("no replay"));
+    } else if (state == TRACE_REPLAY_RUNNING) {
+      mg_http_reply(c, 200, headers, "{%m:true}\n", MG_ESC("running"));
+    } else if (err == ESP_ERR_NOT_FOUND || err == ESP_ERR_INVALID_ARG) {
+      mg_http_reply(c, 200, headers, "{%m:false,%m:%m}\n", MG_ESC("running"), MG_ESC("error"),
+                    MG_ESC(err == ESP_ERR_NOT_FOUND ? "file not found" : "file too large"));
+    } else {
+      mg_http_reply(c, 200, headers,
+                    "{\"running\":false,\"records\":%lu,\"edges\":%lu,\"boots\":%lu,\"measurements\":%lu,"
+                    "\"expected\":%lu,\"announced\":%lu,\"matched\":%lu,\"missed\":%lu,\"extra\":%lu,"
+                    "\"maxSkewMs\":%lu,\"demands\":%lu,\"demandAlarms\":%lu,\"spanMs\":%lu,\"elapsedMs\":%lu,"
+                    "\"complete\":%s}\n",
+                    (unsigned long) r.records, (unsigned long) r.edges, (unsigned long) r.boots,
+                    (unsigned long) r.measurements, (unsigned long) r.expected, (unsigned long) r.announced,
+                    (unsigned long) r.matched, (unsigned long) r.missed, (unsigned long) r.extra,
+                    (unsigned long) r.max_skew_ms, (unsigned long) r.demands, (unsigned long) r.demand_alarms,
+                    (unsigned long) r.span_ms, (unsigned long) r.elapsed_ms,
+                    err == ESP_OK ? "true" : "false");
+    }
+    return;
+  }
+
+  mg_http_get_var(&hm->query, "file", file_name, sizeof(file_name));
+  if (file_name[0] == '\0' || strchr(file_name, '/') != NULL) {
+    mg_http_reply(c, 400, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("bad file"));
+    return;
+  }
+  if (mg_http_get_var(&hm->query, "from", num, sizeof(num)) > 0) from = (uint32_t)atoi(num);
+  if (mg_http_get_var(&hm->query, "to", num, sizeof(num)) > 0) to = (uint32_t)atoi(num);
+  mg_snprintf(path, sizeof(path), "%s/%s", MOUNT_POINT, file_name);
+
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    mg_http_reply(c, 404, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("file not found"));
+    return;
+  }
+  if (st.st_size > TRACE_REPLAY_MAX_BYTES) {
+    mg_http_reply(c, 413, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("file too large"));
+    return;
+  }
+
+  TraceLog_Flush();
+  esp_err_t err = TraceReplay_Start(path, from, to);
+  if (err == ESP_ERR_INVALID_STATE) {
+    mg_http_reply(c, 409, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("replay running"));
+  } else if (err != ESP_OK) {
+    mg_http_reply(c, 500, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("replay not started"));
+  } else {
+    mg_http_reply(c, 202, headers, "{%m:true}\n", MG_ESC("running"));
+  }
+}
+
+
+
 
 
 
@@ -1112,15 +1360,15 @@ void glue_get_playSound(struct playSound *data) {
 /**
  * @brief Sets the playSound structure and configures playback parameters.
  *
- * Copies the provided playSound structure to the internal variable, sets flags for stopping playback and test mode,
+ * Copies the provided playSound structure to the internal variable, sets the test mode flag,
  * calculates the volume factor, and prints file and volume information.
  *
  * @param[in] data Pointer to a playSound structure containing sound playback information.
  */
 void glue_set_playSound(struct playSound *data) {
   s_playSound = *data; // Sync with your device
-  StopPlayWav = true;
   TestMode = true;
+  ProcessThread_Notify(PROCESS_EVT_TEST);
 
   volume_factor = (float)s_playSound.soundLevel * (0.55f / 100.0f);
   printf("volume_factor degeri: %.2f\n", volume_factor);
@@ -1260,61 +1508,124 @@ void glue_set_currentTime(struct currentTime *data) {
 
 
 
+/* noise_level_history penceresini ara tampon olmadan JSON dizisi olarak yazar (%M) */
+static size_t print_noise_history(mg_pfn_t out, void *arg, va_list *ap) {
+  const RingStats_t *rs = va_arg(*ap, const RingStats_t *);
+  size_t len = 0;
+  uint16_t n = RingStats_Count(rs);
+  for (uint16_t i = 0; i < n; i++) {
+    len += mg_xprintf(out, arg, "%s\"%ld\"", i == 0 ? "" : ",", (long) RingStats_Get(rs, i));
+  }
+  return len;
+}
+
 /**
  * @brief Replies with the noise level history as a JSON array over HTTP.
  *
- * Constructs a JSON array from the noise_level_history and sends it as an HTTP response.
- * Handles buffer overflow and ensures valid JSON formatting.
+ * Streams the noise_level_history window, oldest first, straight into the connection buffer.
  *
  * @param[in] c  Pointer to the HTTP connection.
  * @param[in] hm Pointer to the HTTP message (unused).
  */
 void glue_reply_noiseLevel(struct mg_connection *c, struct mg_http_message *hm) {
   const char *headers = "Cache-Control: no-cache\r\n" "Content-Type: application/json\r\n";
-  char response_buffer[256]; // Ensure sufficient size
-  char *ptr = response_buffer;
-  size_t remaining_size = sizeof(response_buffer);
-  int written_chars; 
-      // JSON array start
-      written_chars = snprintf(ptr, remaining_size, "[");
-      if (written_chars < 0 || (size_t)written_chars >= remaining_size) {
-          mg_http_reply(c, 200, headers, "[]\n");
-           return;
-      }
-      ptr += written_chars;
-      remaining_size -= written_chars;
-
-      // Iterate through the history array and build JSON
-      for (int i = 0; i < NOISE_LEVEL_HISTORY_SIZE; i++) {
-          if (i > 0) {
-              written_chars = snprintf(ptr, remaining_size, ",");
-              if (written_chars < 0 || (size_t)written_chars >= remaining_size) break;
-              ptr += written_chars;
-              remaining_size -= written_chars;
-          }
-
-          written_chars = snprintf(ptr, remaining_size, "\"%d\"", noise_level_history[i]);
-          if (written_chars < 0 || (size_t)written_chars >= remaining_size) break;
-          ptr += written_chars;
-          remaining_size -= written_chars;
-      }
-
-      // JSON array end
-      if (remaining_size > 0) {
-          snprintf(ptr, remaining_size, "]");
-      } else {
-          // Fallback for full buffer: try to terminate correctly
-          if (sizeof(response_buffer) > 0) {
-              if (ptr > response_buffer && *(ptr - 1) == ',') {
-                  *(ptr - 1) = ']';
-                  *ptr = '\0';
-              } else {
-                  response_buffer[sizeof(response_buffer) - 1] = '\0';
-              }
-          }
-      } 
   (void) hm;
-  mg_http_reply(c, 200, headers, "%s\n", response_buffer);
+  mg_http_reply(c, 200, headers, "[%M]\n", print_noise_history, &noise_level_history);
+}
+
+
+
+/**
+ * @brief Replies with the statistics of the noise level history window.
+ *
+ * Minimum, maximum and mean are exact; the percentiles are read from NOISE_LEVEL_BUCKET_DB wide buckets.
+ * "now" is the current Slow-weighted ambient level in dB x10, which leaves out the device's own output.
+ * "confidence" is the percentage of recent microphone frames that reached it, "playback" tells whether the
+ * last frame was taken while the speaker played, and clean/compensated/gated count the frames by kind.
+ *
+ * @param[in] c  Pointer to the HTTP connection.
+ * @param[in] hm Pointer to the HTTP message (unused).
+ */
+void glue_reply_noiseStats(struct mg_connection *c, struct mg_http_message *hm) {
+  const char *headers = "Cache-Control: no-cache\r\n" "Content-Type: application/json\r\n";
+  const RingStats_t *rs = &noise_level_history;
+  LoudnessLevel_t level;
+  (void) hm;
+  Loudness_GetLevel(&level);
+  mg_http_reply(c, 200, headers,
+                "{\"count\":%u,\"min\":%ld,\"max\":%ld,\"avg\":%ld,\"p50\":%ld,\"p90\":%ld,\"now\":%d,"
+                "\"confidence\":%u,\"playback\":%s,\"clean\":%lu,\"compensated\":%lu,\"gated\":%lu}\n",
+                (unsigned) RingStats_Count(rs), (long) RingStats_Min(rs), (long) RingStats_Max(rs),
+                (long) RingStats_Mean(rs), (long) RingStats_Percentile(rs, 50), (long) RingStats_Percentile(rs, 90),
+                (int) level.slow_db10, (unsigned) level.confidence_pct, level.playback ? "true" : "false",
+                (unsigned long) level.clean_frames, (unsigned long) level.compensated_frames,
+                (unsigned long) level.gated_frames);
+}
+
+
+
+
+
+typedef struct {
+  uint32_t from, to;
+  uint16_t points;
+} NoiseQuery_t;
+
+typedef struct {
+  mg_pfn_t out;
+  void *arg;
+  size_t len;
+  bool first;
+} NoisePrint_t;
+
+/* Sorgunun her noktasini [zaman,min,ort,max] dizisi olarak yazar */
+static void print_noise_point(const NoisePoint_t *p, void *arg) {
+  NoisePrint_t *pr = (NoisePrint_t *) arg;
+  pr->len += mg_xprintf(pr->out, pr->arg, "%s[%lu,%d,%d,%d]", pr->first ? "" : ",", (unsigned long) p->time,
+                        (int) p->min_db10, (int) p->avg_db10, (int) p->max_db10);
+  pr->first = false;
+}
+
+/* Katmanli gecmis sorgusunu ara tampon olmadan yazar (%M) */
+static size_t print_noise_query(mg_pfn_t out, void *arg, va_list *ap) {
+  const NoiseQuery_t *q = va_arg(*ap, const NoiseQuery_t *);
+  NoisePrint_t pr = {out, arg, 0, true};
+  pr.len += mg_xprintf(out, arg, "\"points\":[");
+  uint32_t period = NoiseHistory_Query(q->from, q->to, q->points, print_noise_point, &pr);
+  pr.len += mg_xprintf(out, arg, "],\"period\":%lu", (unsigned long) period);
+  return pr.len;
+}
+
+/**
+ * @brief Replies with a time range of the multi-resolution noise history.
+ *
+ * Query parameters: from and to (epoch seconds, default the last span seconds up to now), span (default
+ * 300) and points (default and maximum NOISE_HISTORY_MAX_POINTS). Each point is [time, min, avg, max] with
+ * levels in dB x10 and covers "period" seconds; the tier is chosen by NoiseHistory_Query(), so long ranges
+ * are served from the minute and hour records.
+ *
+ * @param[in] c  Pointer to the HTTP connection.
+ * @param[in] hm Pointer to the HTTP message containing the query string.
+ */
+void glue_reply_noiseHistory(struct mg_connection *c, struct mg_http_message *hm) {
+  const char *headers = "Cache-Control: no-cache\r\n" "Content-Type: application/json\r\n";
+  char num[12];
+  uint32_t now = NoiseHistory_Now(), span = 300;
+  NoiseQuery_t q = {0, now, NOISE_HISTORY_MAX_POINTS};
+
+  if (mg_http_get_var(&hm->query, "span", num, sizeof(num)) > 0) span = (uint32_t) strtoul(num, NULL, 10);
+  if (mg_http_get_var(&hm->query, "to", num, sizeof(num)) > 0) q.to = (uint32_t) strtoul(num, NULL, 10);
+  q.from = q.to > span ? q.to - span : 0;
+  if (mg_http_get_var(&hm->query, "from", num, sizeof(num)) > 0) q.from = (uint32_t) strtoul(num, NULL, 10);
+  if (mg_http_get_var(&hm->query, "points", num, sizeof(num)) > 0) {
+    unsigned long points = strtoul(num, NULL, 10);
+    q.points = (uint16_t) (points == 0 ? 1 : (points > NOISE_HISTORY_MAX_POINTS ? NOISE_HISTORY_MAX_POINTS : points));
+  }
+  if (q.to < q.from) {
+    mg_http_reply(c, 400, headers, "{%m:%m}\n", MG_ESC("error"), MG_ESC("bad range"));
+    return;
+  }
+  mg_http_reply(c, 200, headers, "{\"now\":%lu,%M}\n", (unsigned long) now, print_noise_query, &q);
 }
 
 
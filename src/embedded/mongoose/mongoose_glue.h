@@ -99,6 +99,7 @@ bool glue_check_reformat(void);  // Check if action is still in progress
 void *glue_upload_open_file_upload(char *file_name, size_t total_size);
 bool glue_upload_close_file_upload(void *context);
 bool glue_upload_write_file_upload(void *context, void *buf, size_t len);
+void glue_reply_uploadReport(struct mg_connection *, struct mg_http_message *);
 
 struct deleteFile {
   char fileName[50];
@@ -121,6 +122,8 @@ void glue_get_state(struct state *);
 void glue_reply_loglevels(struct mg_connection *, struct mg_http_message *);
 void glue_reply_events(struct mg_connection *, struct mg_http_message *);
 void glue_reply_download(struct mg_connection *, struct mg_http_message *);
+void glue_reply_trace(struct mg_connection *, struct mg_http_message *);
+void glue_reply_replay(struct mg_connection *, struct mg_http_message *);
 struct sunday {
   char time[97];
 };
@@ -373,6 +376,8 @@ void glue_get_currentTime(struct currentTime *);
 void glue_set_currentTime(struct currentTime *);
 
 void glue_reply_noiseLevel(struct mg_connection *, struct mg_http_message *);
+void glue_reply_noiseStats(struct mg_connection *, struct mg_http_message *);
+void glue_reply_noiseHistory(struct mg_connection *, struct mg_http_message *);
 struct volume {
   int volume;
 };
@@ -360,11 +360,14 @@ struct attribute s_deviceStatus_attributes[] = {
 struct apihandler_action s_apihandler_reboot = {{"reboot", "action", false, 3, 7, 0UL}, glue_check_reboot, glue_start_reboot};
 struct apihandler_action s_apihandler_reformat = {{"reformat", "action", false, 3, 7, 0UL}, glue_check_reformat, glue_start_reformat};
 struct apihandler_upload s_apihandler_file_upload = {{"file_upload", "upload", false, 3, 7, 0UL}, glue_upload_open_file_upload, glue_upload_close_file_upload, glue_upload_write_file_upload};
+struct apihandler_custom s_apihandler_uploadReport = {{"uploadReport", "custom", true, 0, 0, 0UL}, glue_reply_uploadReport};
 struct apihandler_data s_apihandler_deleteFile = {{"deleteFile", "data", false, 0, 0, 0UL}, s_deleteFile_attributes, sizeof(struct deleteFile), (void (*)(void *)) glue_get_deleteFile, (void (*)(void *)) glue_set_deleteFile};
 struct apihandler_data s_apihandler_state = {{"state", "data", true, 0, 0, 0UL}, s_state_attributes, sizeof(struct state), (void (*)(void *)) glue_get_state, NULL};
 struct apihandler_custom s_apihandler_loglevels = {{"loglevels", "custom", false, 0, 0, 0UL}, glue_reply_loglevels};
 struct apihandler_custom s_apihandler_events = {{"events", "custom", false, 0, 0, 0UL}, glue_reply_events};
 struct apihandler_custom s_apihandler_download = {{"download", "custom", true, 0, 0, 0UL}, glue_reply_download};
+struct apihandler_custom s_apihandler_trace = {{"trace", "custom", true, 0, 0, 0UL}, glue_reply_trace};
+struct apihandler_custom s_apihandler_replay = {{"replay", "custom", true, 0, 0, 0UL}, glue_reply_replay};
 struct apihandler_data s_apihandler_sunday = {{"sunday", "data", false, 0, 0, 0UL}, s_sunday_attributes, sizeof(struct sunday), (void (*)(void *)) glue_get_sunday, (void (*)(void *)) glue_set_sunday};
 struct apihandler_data s_apihandler_monday = {{"monday", "data", false, 0, 0, 0UL}, s_monday_attributes, sizeof(struct monday), (void (*)(void *)) glue_get_monday, (void (*)(void *)) glue_set_monday};
 struct apihandler_data s_apihandler_tuesday = {{"tuesday", "data", false, 0, 0, 0UL}, s_tuesday_attributes, sizeof(struct tuesday), (void (*)(void *)) glue_get_tuesday, (void (*)(void *)) glue_set_tuesday};
@@ -389,6 +392,8 @@ struct apihandler_data s_apihandler_playSound = {{"playSound", "data", false, 0,
 struct apihandler_data s_apihandler_audioConfig = {{"audioConfig", "data", false, 0, 0, 0UL}, s_audioConfig_attributes, sizeof(struct audioConfig), (void (*)(void *)) glue_get_audioConfig, (void (*)(void *)) glue_set_audioConfig};
 struct apihandler_data s_apihandler_currentTime = {{"currentTime", "data", false, 0, 0, 0UL}, s_currentTime_attributes, sizeof(struct currentTime), (void (*)(void *)) glue_get_currentTime, (void (*)(void *)) glue_set_currentTime};
 struct apihandler_custom s_apihandler_noiseLevel = {{"noiseLevel", "custom", false, 0, 0, 0UL}, glue_reply_noiseLevel};
+struct apihandler_custom s_apihandler_noiseStats = {{"noiseStats", "custom", false, 0, 0, 0UL}, glue_reply_noiseStats};
+struct apihandler_custom s_apihandler_noiseHistory = {{"noiseHistory", "custom", false, 0, 0, 0UL}, glue_reply_noiseHistory};
 struct apihandler_data s_apihandler_volume = {{"volume", "data", false, 0, 0, 0UL}, s_volume_attributes, sizeof(struct volume), (void (*)(void *)) glue_get_volume, (void (*)(void *)) glue_set_volume};
 struct apihandler_data s_apihandler_deviceStatus = {{"deviceStatus", "data", false, 0, 0, 0UL}, s_deviceStatus_attributes, sizeof(struct deviceStatus), (void (*)(void *)) glue_get_deviceStatus, (void (*)(void *)) glue_set_deviceStatus};
 
@@ -396,11 +401,14 @@ static struct apihandler *s_apihandlers[] = {
   (struct apihandler *) &s_apihandler_reboot,
   (struct apihandler *) &s_apihandler_reformat,
   (struct apihandler *) &s_apihandler_file_upload,
+  (struct apihandler *) &s_apihandler_uploadReport,
   (struct apihandler *) &s_apihandler_deleteFile,
   (struct apihandler *) &s_apihandler_state,
   (struct apihandler *) &s_apihandler_loglevels,
   (struct apihandler *) &s_apihandler_events,
   (struct apihandler *) &s_apihandler_download,
+  (struct apihandler *) &s_apihandler_trace,
+  (struct apihandler *) &s_apihandler_replay,
   (struct apihandler *) &s_apihandler_sunday,
   (struct apihandler *) &s_apihandler_monday,
   (struct apihandler *) &s_apihandler_tuesday,
@@ -425,6 +433,8 @@ static struct apihandler *s_apihandlers[] = {
   (struct apihandler *) &s_apihandler_audioConfig,
   (struct apihandler *) &s_apihandler_currentTime,
   (struct apihandler *) &s_apihandler_noiseLevel,
+  (struct apihandler *) &s_apihandler_noiseStats,
+  (struct apihandler *) &s_apihandler_noiseHistory,
   (struct apihandler *) &s_apihandler_volume,
   (struct apihandler *) &s_apihandler_deviceStatus
 };
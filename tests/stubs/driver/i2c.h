@@ -0,0 +1,4 @@
+// Host testleri icin ESP-IDF taklidi
+#pragma once
+
+typedef enum { I2C_NUM_0, I2C_NUM_1 } i2c_port_t;
@@ -0,0 +1,2 @@
+// Host testleri icin ESP-IDF taklidi (bos)
+#pragma once
@@ -0,0 +1,4 @@
+// Host testleri icin ESP-IDF taklidi: yalniz tipler
+#pragma once
+
+typedef void *esp_eth_handle_t;
@@ -0,0 +1,4 @@
+// Host testleri icin ESP-IDF taklidi: yalniz tipler
+#pragma once
+
+typedef const char *esp_event_base_t;
@@ -0,0 +1,5 @@
+// Host testleri icin ESP-IDF taklidi: saat host_stubs.c'de
+#pragma once
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
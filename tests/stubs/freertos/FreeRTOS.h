@@ -0,0 +1,19 @@
+// Host testleri icin FreeRTOS taklidi: tipler ve tek cekirdekte bos kritik bolge
+#pragma once
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define portMAX_DELAY       ((TickType_t)0xffffffffu)
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
@@ -0,0 +1,5 @@
+// Host testleri icin FreeRTOS taklidi: yalniz tipler
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
@@ -0,0 +1,16 @@
+// Host testleri icin ESP-IDF taklidi: GPIO giris yazmaclari
+#pragma once
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t in;
+    union {
+        struct {
+            uint32_t data : 8;
+            uint32_t reserved8 : 24;
+        };
+        uint32_t val;
+    } in1;
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
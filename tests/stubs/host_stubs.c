@@ -0,0 +1,51 @@
+/*
+ * host_stubs.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Host implementations of the ESP-IDF calls the host-tested modules link against.
+ *
+ * esp_timer_get_time() runs on CLOCK_MONOTONIC, gpio_config() accepts any configuration and the GPIO
+ * input registers read as all low. xTaskCreate() runs the task function to its end before it returns, so a
+ * background job has finished when its start call comes back; vTaskDelete() does nothing.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "freertos/task.h"
+#include <time.h>
+
+gpio_dev_t GPIO;
+
+
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return ESP_OK;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *created)
+{
+    if (created != NULL) *created = NULL;
+    task(param);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
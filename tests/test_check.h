@@ -0,0 +1,33 @@
+/*
+ * test_check.h
+ *
+ *  Created on: 17 Eki 2026
+ *      Author: metesepetcioglu
+ */
+
+#ifndef TESTS_TEST_CHECK_H_
+#define TESTS_TEST_CHECK_H_
+
+#include <stdio.h>
+
+// Yazdirilan hata satiri siniri; dongudeki bir hata ciktiyi doldurmasin, sayac yine hepsini sayar
+#ifndef CHECK_MAX_PRINTED
+#define CHECK_MAX_PRINTED 10
+#endif
+
+// Her test tek bir .c dosyasidir, sayac o dosyaya ozeldir
+static int s_failures = 0;
+
+#define CHECK(cond, ...)                                                   \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            if (s_failures < CHECK_MAX_PRINTED) {                          \
+                printf("FAIL %s:%d: ", __FILE__, __LINE__);                \
+                printf(__VA_ARGS__);                                       \
+                printf("\n");                                              \
+            }                                                              \
+            s_failures++;                                                  \
+        }                                                                  \
+    } while (0)
+
+#endif /* TESTS_TEST_CHECK_H_ */
@@ -0,0 +1,139 @@
+/*
+ * test_ring_stats.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Host test: RingStats window against a brute-force recomputation.
+ *
+ * 100000 pseudo-random values (with plateaus and monotonic runs, which exercise the min/max deques) are
+ * pushed into a window. After every push, count, sum, mean, min, max, first and last element are
+ * compared with a plain scan of the last 'capacity' values. Every 97th push the histogram percentiles
+ * are checked to land in the bucket of the exact sorted value. Fill and Reset are checked at the end.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "RingStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_check.h"
+
+#define WINDOW      37
+#define BUCKETS     20
+#define BUCKET_MIN  0
+#define BUCKET_W    10
+#define PUSHES      100000
+
+RING_STATS_DEFINE(static, s_window, WINDOW, BUCKETS, BUCKET_MIN, BUCKET_W);
+
+static int32_t s_history[PUSHES];
+
+
+
+/* Tekrarlanabilir xorshift32 uretici */
+static uint32_t next_rand(void)
+{
+    static uint32_t x = 2463534242u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/* Araliga yayilmis degerler; sabit platolar ve monoton diziler de uretir */
+static int32_t next_value(int i)
+{
+    int phase = i % 1000;
+    if (phase < 50) return 100;                         // Plato
+    if (phase < 100) return -20 + (phase - 50) * 5;     // Artan dizi
+    if (phase < 150) return 230 - (phase - 100) * 5;    // Azalan dizi
+    return (int32_t)(next_rand() % 250) - 20;           // Kova araliginin iki yani da
+}
+
+static int cmp_i32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Son n degerin tam yuzdeligi: RingStats ile ayni yukari yuvarlanmis sira */
+static int32_t exact_percentile(const int32_t *v, int n, int percent)
+{
+    int32_t sorted[WINDOW];
+    memcpy(sorted, v, (size_t)n * sizeof(sorted[0]));
+    qsort(sorted, (size_t)n, sizeof(sorted[0]), cmp_i32);
+    int rank = (n * percent + 99) / 100;
+    return sorted[rank - 1];
+}
+
+static int bucket_index(int32_t value)
+{
+    if (value < BUCKET_MIN) return 0;
+    int b = (value - BUCKET_MIN) / BUCKET_W;
+    return b >= BUCKETS ? BUCKETS - 1 : b;
+}
+
+
+
+int main(void)
+{
+    static const int percents[] = { 10, 50, 90, 99 };
+
+    for (int i = 0; i < PUSHES; i++) {
+        int32_t value = next_value(i);
+        RingStats_Push(&s_window, value);
+        s_history[i] = value;
+
+        int n = (i + 1 < WINDOW) ? i + 1 : WINDOW;
+        const int32_t *win = &s_history[i + 1 - n];
+        int64_t sum = 0;
+        int32_t lo = win[0], hi = win[0];
+        for (int k = 0; k < n; k++) {
+            sum += win[k];
+            if (win[k] < lo) lo = win[k];
+            if (win[k] > hi) hi = win[k];
+        }
+        int64_t half = n / 2;
+        int32_t mean = (int32_t)((sum >= 0 ? sum + half : sum - half) / n);
+
+        CHECK(RingStats_Count(&s_window) == n, "push %d: count %u != %d", i, RingStats_Count(&s_window), n);
+        CHECK(RingStats_Sum(&s_window) == sum, "push %d: sum %lld != %lld", i,
+              (long long)RingStats_Sum(&s_window), (long long)sum);
+        CHECK(RingStats_Mean(&s_window) == mean, "push %d: mean %ld != %ld", i,
+              (long)RingStats_Mean(&s_window), (long)mean);
+        CHECK(RingStats_Min(&s_window) == lo, "push %d: min %ld != %ld", i, (long)RingStats_Min(&s_window), (long)lo);
+        CHECK(RingStats_Max(&s_window) == hi, "push %d: max %ld != %ld", i, (long)RingStats_Max(&s_window), (long)hi);
+        CHECK(RingStats_Get(&s_window, 0) == win[0], "push %d: oldest element", i);
+        CHECK(RingStats_Last(&s_window) == value, "push %d: last element", i);
+
+        if (i % 97 == 0) {
+            CHECK(RingStats_Percentile(&s_window, 0) == lo, "push %d: p0 is not the minimum", i);
+            CHECK(RingStats_Percentile(&s_window, 100) == hi, "push %d: p100 is not the maximum", i);
+            for (size_t p = 0; p < sizeof(percents) / sizeof(percents[0]); p++) {
+                int32_t exact = exact_percentile(win, n, percents[p]);
+                int32_t est = RingStats_Percentile(&s_window, (uint8_t)percents[p]);
+                CHECK(bucket_index(est) == bucket_index(exact) && est >= lo && est <= hi,
+                      "push %d: p%d estimate %ld, exact %ld", i, percents[p], (long)est, (long)exact);
+            }
+        }
+    }
+
+    RingStats_Fill(&s_window, 42);
+    CHECK(RingStats_Count(&s_window) == WINDOW, "fill: count %u", RingStats_Count(&s_window));
+    CHECK(RingStats_Min(&s_window) == 42 && RingStats_Max(&s_window) == 42, "fill: min/max");
+    CHECK(RingStats_Sum(&s_window) == 42 * WINDOW, "fill: sum");
+    CHECK(RingStats_Percentile(&s_window, 50) == 42, "fill: p50 %ld", (long)RingStats_Percentile(&s_window, 50));
+
+    RingStats_Reset(&s_window);
+    CHECK(RingStats_Count(&s_window) == 0 && RingStats_Sum(&s_window) == 0, "reset: window not empty");
+    RingStats_Push(&s_window, -5);
+    CHECK(RingStats_Min(&s_window) == -5 && RingStats_Max(&s_window) == -5, "reset: stale min/max");
+
+    printf("test_ring_stats: %d pushes, %d failures\n", PUSHES, s_failures);
+    return s_failures == 0 ? 0 : 1;
+}
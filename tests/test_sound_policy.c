@@ -0,0 +1,171 @@
+/*
+ * test_sound_policy.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Host test: SoundPolicy table against the hand-written flag cases it replaced.
+ *
+ * The eight plan cases that Process_Thread used before SoundPolicy are kept below as the reference.
+ * For every plan key (isIdleActive, idleContAfterReq, isReqActive), both isGreenActive values and the
+ * four runtime inputs (demand, confirmed green), the reference flags must equal the table decision.
+ *
+ * One difference is intentional: in the 000 plan the old code never assigned RequestPlayFlag, so it kept
+ * whatever the previous plan had left there. The table clears it. The reference is therefore run twice,
+ * with the previous flags all false and all true, and only that one case is allowed to differ.
+ * StopPlayWav, which the old cases also set, no longer exists and is not compared.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "SoundPolicy.h"
+#include <stdio.h>
+#include "test_check.h"
+
+static struct {
+    bool isIdleActive;
+    bool idleContAfterReq;
+    bool isReqActive;
+    bool isGreenActive;
+} CurrentConfiguration;
+
+static bool isDemandActive;
+static bool green_confirmed;
+static bool IdlePlayFlag, RequestPlayFlag, GreenCounterPlayFlag;
+
+
+
+/* Onayli yesil tum sesleri keser, yalniz geri sayim kalir (her eski durumun sonundaki blok) */
+static void old_green_override(void)
+{
+    if (CurrentConfiguration.isGreenActive == true && green_confirmed == true) {
+        IdlePlayFlag = false;
+        RequestPlayFlag = false;
+        GreenCounterPlayFlag = true;
+    }
+}
+
+/* Process_Thread'in SoundPolicy oncesi sekiz durumu, StopPlayWav satirlari disinda aynen */
+static void old_branches(void)
+{
+    const bool idle = CurrentConfiguration.isIdleActive;
+    const bool cont = CurrentConfiguration.idleContAfterReq;
+    const bool req = CurrentConfiguration.isReqActive;
+
+    if (idle && !cont && !req) {            // 100
+        RequestPlayFlag = false;
+        IdlePlayFlag = true;
+        GreenCounterPlayFlag = false;
+        if (isDemandActive) IdlePlayFlag = false;
+    } else if (idle && cont && !req) {      // 110
+        IdlePlayFlag = true;
+        RequestPlayFlag = false;
+        GreenCounterPlayFlag = false;
+        if (isDemandActive) IdlePlayFlag = true;
+    } else if (!idle && cont && !req) {     // 010
+        IdlePlayFlag = false;
+        RequestPlayFlag = false;
+        GreenCounterPlayFlag = false;
+        if (isDemandActive) IdlePlayFlag = true;
+    } else if (!idle && !cont && !req) {    // 000: RequestPlayFlag yalniz talepte yaziliyordu
+        IdlePlayFlag = false;
+        GreenCounterPlayFlag = false;
+        if (isDemandActive) {
+            IdlePlayFlag = false;
+            RequestPlayFlag = false;
+        }
+    } else if (idle && cont && req) {       // 111
+        IdlePlayFlag = true;
+        RequestPlayFlag = false;
+        GreenCounterPlayFlag = false;
+        if (isDemandActive) {
+            IdlePlayFlag = true;
+            RequestPlayFlag = true;
+        }
+    } else if (!idle && !cont && req) {     // 001
+        IdlePlayFlag = false;
+        GreenCounterPlayFlag = false;
+        RequestPlayFlag = false;
+        if (isDemandActive) {
+            IdlePlayFlag = false;
+            RequestPlayFlag = true;
+        }
+    } else if (!idle && cont && req) {      // 011
+        IdlePlayFlag = false;
+        GreenCounterPlayFlag = false;
+        RequestPlayFlag = false;
+        if (isDemandActive) {
+            IdlePlayFlag = true;
+            RequestPlayFlag = true;
+        }
+    } else {                                // 101
+        IdlePlayFlag = true;
+        GreenCounterPlayFlag = false;
+        RequestPlayFlag = false;
+        if (isDemandActive) {
+            IdlePlayFlag = false;
+            RequestPlayFlag = true;
+        }
+    }
+    old_green_override();
+}
+
+/* Eski koddan karar bitlerini uretir; onceki bayraklar 'previous' ile baslatilir */
+static uint8_t old_decision(bool previous)
+{
+    IdlePlayFlag = RequestPlayFlag = GreenCounterPlayFlag = previous;
+    old_branches();
+    return (uint8_t)((IdlePlayFlag ? SOUND_POLICY_IDLE : 0) | (RequestPlayFlag ? SOUND_POLICY_REQUEST : 0) |
+                     (GreenCounterPlayFlag ? SOUND_POLICY_GREEN_COUNTER : 0));
+}
+
+
+
+int main(void)
+{
+    int compared = 0;
+
+    for (int plan = 0; plan < 8; plan++) {
+        for (int green_active = 0; green_active < 2; green_active++) {
+            CurrentConfiguration.isIdleActive = (plan & 4) != 0;
+            CurrentConfiguration.idleContAfterReq = (plan & 2) != 0;
+            CurrentConfiguration.isReqActive = (plan & 1) != 0;
+            CurrentConfiguration.isGreenActive = green_active != 0;
+
+            SoundPolicy_t policy;
+            uint8_t key = SoundPolicy_Key(CurrentConfiguration.isIdleActive, CurrentConfiguration.idleContAfterReq,
+                                          CurrentConfiguration.isReqActive, CurrentConfiguration.isGreenActive);
+            SoundPolicy_Build(&policy, key);
+            CHECK(policy.key == key, "key %u not stored", key);
+
+            for (int in = 0; in < SOUND_POLICY_INPUTS; in++) {
+                isDemandActive = (in & 1) != 0;
+                green_confirmed = (in & 2) != 0;
+                uint8_t table = SoundPolicy_Decide(&policy, isDemandActive, green_confirmed);
+
+                for (int previous = 0; previous < 2; previous++) {
+                    uint8_t old = old_decision(previous != 0);
+                    compared++;
+
+                    // 000 planinda talep ve onayli yesil yokken eski kod onceki RequestPlayFlag'i koruyordu
+                    bool stale_request = plan == 0 && previous && !isDemandActive &&
+                                         !(green_confirmed && green_active);
+                    if (stale_request) {
+                        CHECK(old == (table | SOUND_POLICY_REQUEST) && (table & SOUND_POLICY_REQUEST) == 0,
+                              "plan 000 green=%d in=%d: old %02x table %02x", green_active, in, old, table);
+                        continue;
+                    }
+                    CHECK(old == table, "plan %d%d%d green=%d demand=%d confirmed=%d previous=%d: old %02x table %02x",
+                          (plan >> 2) & 1, (plan >> 1) & 1, plan & 1, green_active, isDemandActive,
+                          green_confirmed, previous, old, table);
+                }
+            }
+        }
+    }
+
+    printf("test_sound_policy: %d cases, %d failures\n", compared, s_failures);
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+ * test_trace_replay.c
+ *
+ *  Created on: 17 Eki 2026
+ *
+ * @file
+ * @brief Host test: TraceReplay over a synthetic trace, through the real DetectTraffic countdown code.
+ *
+ * The trace holds a boot record, green/red cycles of 20 s green and 60 s red, and the 10..1 announcements the
+ * device makes from the second green on, read on a 1 s tick of its own phase. Three short demand presses
+ * fall into red phases, and a last press is held longer than the stuck HIGH timeout. The replay must match
+ * every announcement, count the three presses plus the held one and raise one stuck alarm. A second trace
+ * with one announcement left out must report exactly that one as extra.
+ *
+ * The replay copies must stay silent: nothing may reach stdout, the trace, the alarm log, CycleModel,
+ * hasRequestPlayedOnce or the device status while TraceReplay_Run() runs. TraceReplay_Start() must hold the
+ * trace writer off for the whole run and publish the same result, and a file over TRACE_REPLAY_MAX_BYTES
+ * must be refused.
+ *
+ * @company    INTETRA
+ * @version    v.0.0.0.1
+ * @creator    Mete SEPETCIOGLU
+ * @update     Mete SEPETCIOGLU
+ */
+
+#include "main.h"
+#include "DetectTraffic.h"
+#include "TraceLog.h"
+#include "TraceReplay.h"
+#include "CycleModel.h"
+#include "GpioEdge.h"
+#include "Alarms.h"
+#include <stdio.h>
+#include <unistd.h>
+#include "test_check.h"
+
+#define TRACE_PATH      "test_trace_replay.bin"
+#define CYCLES          8
+#define GREEN_MS        20000
+#define RED_MS          60000
+#define DEVICE_PHASE_MS 437         // Cihazin 1 s zamanlayicisinin izdeki fazi
+#define COUNT_FROM      10
+#define COUNT_TO        1
+#define PRESSES         3
+#define HELD_MS         (3 * 60 * 1000)
+
+extern uint32_t PedestrianFeedback_StuckLowTimeout_min;
+extern uint32_t PedestrianFeedback_StuckHighTimeout_min;
+
+// DetectTraffic'in bagli oldugu modullerin yerine; replay kopyalari bunlara hic dokunmamali
+rtc_time_t DeviceTime;
+bool hasRequestPlayedOnce;
+struct audioConfig s_audioConfig;
+struct deviceStatus s_deviceStatus;
+
+static int s_sideEffects = 0;
+static int s_exports = 0;           // Acik TraceLog_ExportBegin sayisi
+static int s_exportCalls = 0;
+
+void Alarm_Log(const char *msg, rtc_time_t *time) { s_sideEffects++; }
+uint8_t CycleModel_CurrentSlot(void) { s_sideEffects++; return 0; }
+void CycleModel_Observe(CycleLamp_t lamp, uint8_t slot, uint32_t duration_ms) { s_sideEffects++; }
+bool CycleModel_Predict(CycleLamp_t lamp, uint8_t slot, uint32_t *countdown_s, uint8_t *confidence)
+{
+    s_sideEffects++;
+    return false;
+}
+void TraceLog_Add(TraceEvent_t type, uint8_t pin, uint8_t level, uint8_t state, uint32_t value, int64_t time_us)
+{
+    s_sideEffects++;
+}
+void TraceLog_ExportBegin(void) { s_exports++; s_exportCalls++; }
+void TraceLog_ExportEnd(void) { s_exports--; }
+esp_err_t GpioEdge_Init(uint64_t pin_mask) { return ESP_OK; }
+bool GpioEdge_Pop(GpioEdge_t *out) { return false; }
+
+
+
+/* Tek kaydi dosyaya yazar */
+static void put(FILE *fp, uint32_t time_ms, TraceEvent_t type, uint8_t pin, uint8_t level, uint8_t state, uint32_t value)
+{
+    TraceRecord_t rec = { time_ms, (uint8_t)type, pin, level, state, value };
+    fwrite(&rec, sizeof(rec), 1, fp);
+}
+
+/* Sentetik izi yazar; skip_cycle/skip_count anonsu atlanir (0: hicbiri). Izdeki anons sayisini doner */
+static uint32_t write_trace(uint32_t skip_cycle, uint32_t skip_count)
+{
+    FILE *fp = fopen(TRACE_PATH, "wb");
+    if (fp == NULL) return 0;
+
+    uint32_t announces = 0;
+    uint32_t t = 5000;
+    put(fp, 0, TRACE_EVT_CLOCK, 0, 0, 1, 1791936000);
+    for (uint32_t cycle = 0; cycle < CYCLES; cycle++) {
+        put(fp, t, TRACE_EVT_EDGE, Green_FB_Input_Pin, 1, LIGHT_ON, 0);
+        put(fp, t, TRACE_EVT_EDGE, Red_FB_Input_Pin, 0, LIGHT_OFF, 0);
+        if (cycle >= 1) {
+            // Ilk olcumden sonra her yesil 20 s'den sayar; ilk tik yesilden sonraki cihaz tikidir
+            uint32_t first_tick = t - ((t - DEVICE_PHASE_MS) % 1000) + 1000;
+            for (uint32_t k = 1; k < GREEN_MS / 1000; k++) {
+                uint32_t count = GREEN_MS / 1000 - k;
+                if (count > COUNT_FROM || count < COUNT_TO) continue;
+                if (cycle == skip_cycle && count == skip_count) continue;
+                put(fp, first_tick + (k - 1) * 1000, TRACE_EVT_ANNOUNCE, Green_FB_Input_Pin, 1, 0, count);
+                announces++;
+            }
+        }
+        t += GREEN_MS;
+        put(fp, t, TRACE_EVT_EDGE, Green_FB_Input_Pin, 0, LIGHT_OFF, 0);
+        put(fp, t, TRACE_EVT_EDGE, Red_FB_Input_Pin, 1, LIGHT_ON, 0);
+        if (cycle >= 1 && cycle <= PRESSES) {
+            put(fp, t + 10000, TRACE_EVT_EDGE, Demand_Input_Pin, 1, 0, 0);
+            put(fp, t + 12000, TRACE_EVT_EDGE, Demand_Input_Pin, 0, 1, 0);
+        }
+        t += RED_MS;
+    }
+    // Takili kalan talep: stuck HIGH suresinden uzun
+    put(fp, t, TRACE_EVT_EDGE, Demand_Input_Pin, 1, 0, 0);
+    put(fp, t + HELD_MS, TRACE_EVT_EDGE, Demand_Input_Pin, 0, 1, 0);
+    fclose(fp);
+    return announces;
+}
+
+/* Oynatmayi stdout bir dosyaya yonlendirilmis olarak calistirir; yazilan byte sayisini doner */
+static long run_silent(uint32_t from, uint32_t to, TraceReplayResult_t *res, esp_err_t *err)
+{
+    fflush(stdout);
+    FILE *capture = tmpfile();
+    int saved = dup(fileno(stdout));
+    dup2(fileno(capture), fileno(stdout));
+
+    *err = TraceReplay_Run(TRACE_PATH, from, to, res);
+
+    fflush(stdout);
+    dup2(saved, fileno(stdout));
+    close(saved);
+    long printed = ftell(capture);
+    fclose(capture);
+    return printed;
+}
+
+
+
+int main(void)
+{
+    TraceReplayResult_t res;
+    esp_err_t err;
+
+    PedestrianFeedback_StuckLowTimeout_min = 24 * 60;
+    PedestrianFeedback_StuckHighTimeout_min = 2;
+    hasRequestPlayedOnce = true;
+    s_deviceStatus.buttonStatus = 7;
+
+    // 1. Tam iz: her anons eslesmeli
+    uint32_t expected = write_trace(0, 0);
+    CHECK(expected == (CYCLES - 1) * (COUNT_FROM - COUNT_TO + 1), "trace holds %u announcements", expected);
+    long printed = run_silent(COUNT_FROM, COUNT_TO, &res, &err);
+
+    CHECK(err == ESP_OK, "replay returned %d", err);
+    CHECK(printed == 0, "replay printed %ld bytes", printed);
+    CHECK(s_sideEffects == 0, "replay reached the trace, the alarm log or CycleModel %d times", s_sideEffects);
+    CHECK(hasRequestPlayedOnce && s_deviceStatus.buttonStatus == 7, "replay touched the device state");
+    CHECK(res.boots == 1, "boots %u", res.boots);
+    CHECK(res.edges == CYCLES * 4, "edges %u", res.edges);
+    CHECK(res.measurements >= CYCLES - 1, "measurements %u", res.measurements);
+    CHECK(res.expected == expected, "expected %u != %u", res.expected, expected);
+    CHECK(res.announced == expected, "announced %u != %u", res.announced, expected);
+    CHECK(res.matched == expected && res.missed == 0 && res.extra == 0, "matched %u, missed %u, extra %u",
+          res.matched, res.missed, res.extra);
+    CHECK(res.max_skew_ms < 1000, "skew %u ms", res.max_skew_ms);
+    CHECK(res.demands == PRESSES + 1, "demands %u", res.demands);
+    CHECK(res.demand_alarms == 1, "demand alarms %u", res.demand_alarms);
+
+    // 2. Izden bir anons eksik: benzetimde fazla cikmali, gerisi eslesmeli
+    expected = write_trace(3, 5);
+    run_silent(COUNT_FROM, COUNT_TO, &res, &err);
+    CHECK(res.expected == expected, "expected %u != %u", res.expected, expected);
+    CHECK(res.matched == expected && res.missed == 0 && res.extra == 1, "gap: matched %u, missed %u, extra %u",
+          res.matched, res.missed, res.extra);
+
+    // 3. Daha dar geri sayim: izdeki 10 ve 9 benzetimde yok
+    write_trace(0, 0);
+    run_silent(8, COUNT_TO, &res, &err);
+    CHECK(res.missed == (CYCLES - 1) * 2 && res.extra == 0, "narrow: missed %u, extra %u", res.missed, res.extra);
+
+    // 4. Arka plan oynatmasi: ayni sonuc, yazici oynatma boyunca tutulur
+    TraceReplayResult_t bg;
+    esp_err_t bg_err = ESP_FAIL;
+    CHECK(TraceReplay_GetResult(&bg, &bg_err) == TRACE_REPLAY_IDLE, "result before any start");
+    CHECK(TraceReplay_Start(TRACE_PATH, COUNT_FROM, COUNT_TO) == ESP_OK, "start failed");
+    CHECK(TraceReplay_GetResult(&bg, &bg_err) == TRACE_REPLAY_DONE, "background replay not done");
+    CHECK(bg_err == ESP_OK && bg.matched == (CYCLES - 1) * (COUNT_FROM - COUNT_TO + 1) && bg.demands == PRESSES + 1,
+          "background: err %d, matched %u, demands %u", bg_err, bg.matched, bg.demands);
+    CHECK(s_exportCalls == 1 && s_exports == 0, "export calls %d, open %d", s_exportCalls, s_exports);
+
+    // 5. Buyuk dosya okunmadan reddedilir
+    FILE *fp = fopen(TRACE_PATH, "wb");
+    if (fp != NULL) {
+        fseek(fp, TRACE_REPLAY_MAX_BYTES, SEEK_SET);
+        fwrite(&bg, sizeof(TraceRecord_t), 1, fp);
+        fclose(fp);
+    }
+    TraceReplayResult_t big;
+    err = TraceReplay_Run(TRACE_PATH, COUNT_FROM, COUNT_TO, &big);
+    CHECK(err == ESP_ERR_INVALID_ARG && big.records == 0, "oversized file: err %d, %u records", err, big.records);
+
+    remove(TRACE_PATH);
+    printf("test_trace_replay: %u records, %d failures\n", res.records, s_failures);
+    return s_failures == 0 ? 0 : 1;
+}